@@ -4,10 +4,15 @@
 #include "xatu/Crystal.hpp"
 #include "xatu/CrystalDFTConfiguration.hpp"
 #include "xatu/Exciton.hpp"
+#include "xatu/ExcitonMPI.hpp"
 #include "xatu/ExcitonConfiguration.hpp"
 #include "xatu/Result.hpp"
 #include "xatu/System.hpp"
 #include "xatu/SystemConfiguration.hpp"
+#include "xatu/TiledMatrix.hpp"
+#include "xatu/BlockLowRankMatrix.hpp"
 #include "xatu/utils.hpp"
+#include "xatu/threading.hpp"
+#include "xatu/progress.hpp"
 #include "xatu/forward_declaration.hpp"
 #include "xatu/interactions.hpp"
\ No newline at end of file
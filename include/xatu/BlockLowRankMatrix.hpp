@@ -0,0 +1,58 @@
+#pragma once
+#include <armadillo>
+#include <complex>
+#include <functional>
+#include <vector>
+
+namespace xatu {
+
+/**
+ * Hermitian matrix in block-low-rank form. Rows and columns are split in clusters; blocks
+ * between well-separated (admissible) clusters are stored as low-rank factors U*V^H obtained
+ * with adaptive cross approximation, and the rest as dense blocks. Only the blocks of the
+ * upper triangle (I <= J) are stored.
+ * @details The matrix is built from a function returning single elements, so the dense
+ * matrix is never formed.
+ */
+class BlockLowRankMatrix {
+
+    public:
+        // Returns element (i, j) of the matrix
+        typedef std::function<std::complex<double>(arma::uword, arma::uword)> ElementFunction;
+
+    private:
+        struct Block {
+            arma::uword I, J;
+            bool lowRank;
+            arma::cx_mat dense, U, V;
+        };
+
+        arma::uword n_ = 0;
+        double tolerance_;
+        std::vector<arma::uvec> clusters_;
+        std::vector<Block> blocks_;
+        arma::vec diagonal_;
+        arma::uword storedElements_ = 0;
+
+    public:
+        // Returns dimension of the matrix
+        const arma::uword& n = n_;
+        // Returns diagonal of the matrix
+        const arma::vec& diagonal = diagonal_;
+
+    public:
+        BlockLowRankMatrix(const ElementFunction&, const std::vector<arma::uvec>&, const arma::umat&,
+                           double tolerance = 1E-6, int nthreads = 1);
+
+        arma::cx_mat multiply(const arma::cx_mat&) const;
+        double compressionRatio() const;
+        int lowRankBlocks() const;
+        int denseBlocks() const;
+
+    private:
+        bool crossApproximation(const ElementFunction&, const arma::uvec&, const arma::uvec&,
+                                arma::cx_mat&, arma::cx_mat&) const;
+        void recompress(arma::cx_mat&, arma::cx_mat&) const;
+};
+
+}
@@ -2,6 +2,7 @@
 #include <armadillo>
 #include <string>
 #include <iostream>
+#include <memory>
 #include "xatu/SystemConfiguration.hpp"
 
 
@@ -26,6 +27,7 @@ class Crystal {
         arma::mat reciprocalLattice_, kpoints_, meshBZ_;
         std::map<std::string, int> atomToIndex;
         arma::mat inverseReciprocalMatrix;
+        bool silent_ = false;
 
     // Const references to attributes (read-only)
     public:
@@ -64,6 +66,10 @@ class Crystal {
         Crystal(const Crystal&); // Copy constructor
         ~Crystal(){};
 
+        void setSilent(bool);
+        std::ostream& log() const;
+        virtual std::shared_ptr<void> releaseArray(const std::string&);
+
         int getDimension();
         int getNumAtoms();
         arma::mat getBravaisLattice();
@@ -79,15 +85,15 @@ class Crystal {
         void preserveC3();
         void brillouinZoneC3Mesh(int);
         arma::mat wignerSeitzSupercell(int);
-        arma::mat truncateSupercell(int, double);
-        arma::mat truncateReciprocalSupercell(int, double);
-        arma::mat generateCombinations(int n, int ndim, bool centered = false);
+        arma::mat truncateSupercell(int, double) const;
+        arma::mat truncateReciprocalSupercell(int, double) const;
+        arma::mat generateCombinations(int n, int ndim, bool centered = false) const;
         arma::mat supercellCutoff(int);
 
         /* Crystal operations */
         arma::cx_mat inversionOperator(const arma::cx_vec&);
-        arma::rowvec rotateC3(const arma::rowvec&);
-        int findEquivalentPointBZ(const arma::rowvec&, int);
+        arma::rowvec rotateC3(const arma::rowvec&) const;
+        int findEquivalentPointBZ(const arma::rowvec&, int) const;
         void calculateInverseReciprocalMatrix();
 
 
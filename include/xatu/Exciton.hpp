@@ -4,6 +4,9 @@
 #include <omp.h>
 #include <stdlib.h>
 #include <memory>
+#include <atomic>
+#include <exception>
+#include <vector>
 
 #include "System.hpp"
 #include "xatu/SystemConfiguration.hpp"
@@ -11,6 +14,10 @@
 #include "xatu/Result.hpp"
 #include "xatu/forward_declaration.hpp"
 #include "xatu/utils.hpp"
+#include "xatu/progress.hpp"
+#include "xatu/TiledMatrix.hpp"
+#include "xatu/BlockLowRankMatrix.hpp"
+#include "xatu/kernels.hpp"
 
 #ifndef constants
 #define PI 3.141592653589793
@@ -22,6 +29,9 @@ namespace xatu {
 
 class Exciton : public System {
 
+    // The distributed-memory implementation copies the stacks of other excitons
+    friend class ExcitonMPI;
+
     // ----------------------------------- Attributes -----------------------------------
     private:
         // Read-only parameters
@@ -35,6 +45,8 @@ class Exciton : public System {
         arma::cx_mat HBS_;
         std::string interactionType_;
 
+    // Flags and internal attributes are shared with the distributed-memory implementation
+    protected:
         // Flags
         std::string gauge_ = "lattice";
         std::string mode_  = "realspace";
@@ -50,6 +62,100 @@ class Exciton : public System {
         arma::mat HK_;
         int nReciprocalVectors_ = 1;
         double pairEnergy;
+
+        // Mixed precision: single precision BSE, basis used to build it and residuals
+        // of the eigenpairs refined in double precision
+        std::string precision_ = "double";
+        arma::cx_fmat HBSf_;
+        arma::imat basisBSE_;
+        arma::vec residuals_;
+        // Whether the iterative solver of the last diagonalization converged
+        bool converged_ = true;
+
+        // Out-of-core storage of the BSE matrix (empty directory for in-core)
+        std::string outOfCoreDirectory_;
+        int tileColumns_ = 0;
+        std::unique_ptr<TiledMatrix> HBSTiles_;
+
+        // Block-low-rank compression of the BSE matrix (zero tolerance for dense storage)
+        double compressionTolerance_ = 0;
+        std::unique_ptr<BlockLowRankMatrix> HBSCompressed_;
+
+        // Interpolative separable density fitting of the atom-resolved pair densities:
+        // interpolation atoms, interpolation vectors, orbitals of the interpolation atoms (and
+        // the interpolation atom of each one), and kernel projected on the interpolation atoms
+        double isdfTolerance_ = 0;
+        arma::uvec isdfAtoms_, isdfOrbitals_, isdfOrbitalPoint_;
+        arma::cx_mat isdfInterpolation_;
+        arma::cx_cube isdfKernelStack_;
+        arma::cx_mat isdfKernelQ_;
+
+        // Energy window of the electron-hole pair basis (zero to keep all pairs), and indices
+        // of the pairs kept in the BSE
+        double energyWindow_ = 0;
+        arma::uvec windowIndices_;
+
+        // Kinetic (HK), direct and exchange parts of the BSE stored separately for parameter
+        // sweeps, and dielectric factor of the potential they were computed with
+        arma::cx_mat HD_, HX_;
+        double componentsFactor_ = 0;
+
+        // Decomposition of the BSE in spin sectors for Sz-conserving models: Sz of the bands
+        // at k and k+Q, indices of the pairs of each sector and BSE block of each sector
+        bool spinSectors_ = false;
+        arma::mat spinKStack_, spinKQStack_;
+        std::vector<arma::uvec> sectorIndices_;
+        std::vector<arma::cx_mat> HBSSectors_;
+
+        // Real symmetric form of the BSE for Q = 0 and real Fock matrices: index of the mesh
+        // point -k of each k, time-reversed partner of each pair and BSE in the real basis
+        bool realArithmetic_ = false;
+        arma::uvec timeReversedK_;
+        arma::uvec pairPartner_;
+        arma::mat HBSReal_;
+
+        // Full BSE beyond the Tamm-Dancoff approximation: coupling block (complex, or in the real
+        // basis with real arithmetic) and antiresonant part of the states
+        bool fullBSE_ = false;
+        arma::cx_mat HBSCoupling_;
+        arma::mat HBSCouplingReal_;
+        arma::cx_mat antiresonant_;
+
+        // Atom of each orbital and its position, and contraction of the real-space kernel,
+        // specialized at compile time for the small motifs
+        arma::uvec orbitalAtom_;
+        arma::mat orbitalPositions_;
+        MotifKernel motifKernel_ = motifContraction;
+
+        // Phases exp(-ik·t) of each orbital for each kpoint (by columns), to change the bands
+        // from the lattice to the atomic gauge
+        arma::cx_mat atomicGaugePhases_;
+
+        // Reciprocal-space kernel: reciprocal vectors and phases exp(iG·t), exp(ik·t) and
+        // exp(iQ·t) of each orbital; potential V(k - k' + G) for each difference k - k' of the
+        // mesh (by columns, indexed with the integer mesh coordinates) and V(Q + G)
+        arma::mat reciprocalVectors_;
+        arma::cx_mat orbitalPhasesG_, orbitalPhasesK_;
+        arma::cx_vec orbitalPhasesQ_;
+        arma::imat meshCoordinates_;
+        arma::irowvec meshSpan_, meshStrides_;
+        arma::mat potentialTable_;
+        arma::vec potentialQ_;
+
+        // Initial guess for the next Davidson diagonalization (e.g. states before extending the bands)
+        arma::cx_mat warmStart_;
+
+        // Set by excitonDispersion on the excitons of each Q: BLAS threads of the solver (zero
+        // for the solver stage), and whether the stacks of the reference exciton are read in
+        // place instead of copied (it must outlive this exciton and remain unchanged)
+        int solverThreads_ = 0;
+        bool shareReferenceStacks_ = false;
+
+        // Progress report and cancellation
+        ProgressCallback progressCallback_;
+        std::atomic<bool> cancelled_{false};
+        // Exception thrown by the progress callback, rethrown outside the parallel regions
+        std::exception_ptr callbackError_;
         
 
     public:
@@ -77,6 +183,42 @@ class Exciton : public System {
         const arma::cx_mat& HBS = HBS_;
         // Returns kinetic term of BSE
         const arma::mat& HK = HK_;
+        // Returns direct part of the BSE (only after BShamiltonianComponents)
+        const arma::cx_mat& HDirect = HD_;
+        // Returns exchange part of the BSE (only after BShamiltonianComponents)
+        const arma::cx_mat& HExchange = HX_;
+        // Returns single precision BSE matrix (only in single precision mode)
+        const arma::cx_fmat& HBSsingle = HBSf_;
+        // Returns precision of the BSE matrix, either 'double' or 'single'
+        const std::string& precision = precision_;
+        // Returns residual norms of the eigenpairs refined in double precision
+        const arma::vec& refinementResiduals = residuals_;
+        // Returns false if the Davidson method of the last diagonalization did not converge
+        const bool& solverConverged = converged_;
+        // Returns out-of-core BSE matrix (null unless out-of-core storage is enabled)
+        const std::unique_ptr<TiledMatrix>& HBSTiles = HBSTiles_;
+        // Returns block-low-rank BSE matrix (null unless compression is enabled)
+        const std::unique_ptr<BlockLowRankMatrix>& HBSCompressed = HBSCompressed_;
+        // Returns ISDF interpolation atoms (empty unless density fitting is enabled)
+        const arma::uvec& isdfAtoms = isdfAtoms_;
+        // Returns maximum transition energy of the pairs used in the BSE (zero if not restricted)
+        const double& energyWindow = energyWindow_;
+        // Returns whether the BSE is split in spin sectors
+        const bool& spinSectors = spinSectors_;
+        // Returns indices of the electron-hole pairs of each spin sector (only with spin sectors)
+        const std::vector<arma::uvec>& sectorIndices = sectorIndices_;
+        // Returns BSE block of each spin sector (only with spin sectors)
+        const std::vector<arma::cx_mat>& HBSSectors = HBSSectors_;
+        // Returns whether the BSE is built and solved in real arithmetic
+        const bool& realArithmetic = realArithmetic_;
+        // Returns real BSE matrix (only with real arithmetic)
+        const arma::mat& HBSreal = HBSReal_;
+        // Returns whether the full BSE (beyond Tamm-Dancoff) is solved
+        const bool& fullBSE = fullBSE_;
+        // Returns coupling block of the full BSE (only without real arithmetic)
+        const arma::cx_mat& HBSCoupling = HBSCoupling_;
+        // Returns antiresonant part of the states of the full BSE, by columns
+        const arma::cx_mat& antiresonantStates = antiresonant_;
         // Returns dielectric constant of embedding medium
         const double& eps_m = eps_m_;
         // Returns dielectric constante of substrate
@@ -91,7 +233,7 @@ class Exciton : public System {
         const std::string& interactionType = interactionType_;
 
         // Returns gauge for Bloch states
-        const std::string gauge = gauge_;
+        const std::string& gauge = gauge_;
         // Return type of interaction matrix elements
         const std::string& mode = mode_;
         // Return number of reciprocal lattice vectors to use in summations (mode="reciprocalspace")
@@ -106,7 +248,8 @@ class Exciton : public System {
         const arma::imat& basisStates = basisStates_;
 
         // BEWARE: This dictionary had to be exposed to be able to access it,
-        // do not call outside of class methods.
+        // do not call outside of class methods. Use at() for lookups, since
+        // operator[] may insert and is not safe inside parallel regions.
         std::map<int, int> bandToIndex;
 
     // ----------------------------------- Methods -----------------------------------
@@ -139,7 +282,7 @@ class Exciton : public System {
                  const arma::rowvec& parameters = {1, 5, 1}, const arma::rowvec& Q = {0., 0., 0.},
                  const std::string& = "keldysh");
 
-        ~Exciton();
+        virtual ~Exciton();
 
         // Setters
         void setUnitCells(int);
@@ -154,19 +297,50 @@ class Exciton : public System {
         void setReciprocalVectors(int);
         void setScissor(double);
         void setExchange(bool);
+        void setProgressCallback(ProgressCallback);
+        void setOutOfCore(const std::string&, int tileColumns = 0);
+        void setPrecision(const std::string&);
+        void setCompression(double);
+        void setDensityFitting(double);
+        void setEnergyWindow(double);
+        void setSpinSectors(bool);
+        void setRealArithmetic(bool);
+        void setFullBSE(bool);
+        void copySettings(const Exciton&);
 
-    private:
+        // Cancellation of long stages (can be called from another thread)
+        void cancel();
+        bool isCancelled() const;
+
+        std::shared_ptr<void> releaseArray(const std::string&) override;
+
+    protected:
         // Methods for BSE matrix initialization
-        arma::cx_mat motifFTMatrix(const arma::rowvec&, const arma::mat&);
-        std::complex<double> blochCoherenceFactor(const arma::cx_vec&, const arma::cx_vec&,
-                                                  const arma::rowvec&, const arma::rowvec&,
-                                                  const arma::rowvec&);
+        void interactionTerms(const arma::imat&, long int, long int,
+                              std::complex<double>&, std::complex<double>&, bool) const;
+        std::complex<double> BSEMatrixElement(const arma::imat&, long int, long int) const;
+        std::complex<double> couplingMatrixElement(const arma::imat&, long int, long int) const;
+        void pairCoefficients(const arma::imat&, long int, arma::cx_vec&, arma::cx_vec&) const;
+        void pairCoefficients(const arma::imat&, long int, const std::complex<double>*&,
+                              const std::complex<double>*&, std::complex<double>*) const;
+        std::complex<double>* gaugeBuffer(int) const;
+        double dielectricFactor() const;
+        arma::cx_mat motifFTMatrix(const arma::rowvec&, const arma::mat&) const;
+        double potentialFT(const arma::rowvec&) const;
+        arma::cx_vec orbitalPhases(const arma::rowvec&) const;
+        arma::vec reciprocalPotential(int, int) const;
+        arma::cx_vec formFactors(const arma::cx_vec&, const arma::cx_vec&, const arma::cx_vec&) const;
 
-        std::complex<double> exactInteractionTermMFT(const arma::cx_vec&,
-                                                const arma::cx_vec&,
-                                                const arma::cx_vec&,
-                                                const arma::cx_vec&,
-                                                const arma::cx_mat&);
+        std::complex<double> exactInteractionTermMFT(const std::complex<double>*,
+                                                const std::complex<double>*,
+                                                const std::complex<double>*,
+                                                const std::complex<double>*,
+                                                const arma::cx_mat&) const;
+        std::complex<double> isdfInteractionTerm(const std::complex<double>*,
+                                                 const std::complex<double>*,
+                                                 const std::complex<double>*,
+                                                 const std::complex<double>*,
+                                                 const arma::cx_mat&) const;
         std::complex<double> interactionTermFT(const arma::cx_vec&, 
                                                 const arma::cx_vec&,
                                                 const arma::cx_vec&, 
@@ -174,25 +348,67 @@ class Exciton : public System {
                                                 const arma::rowvec&, 
                                                 const arma::rowvec&,
                                                 const arma::rowvec&, 
-                                                const arma::rowvec&,
-                                                int nrcells = 15);
+                                                const arma::rowvec&) const;
+        std::complex<double> interactionTermFT(const arma::cx_vec&, 
+                                                const arma::cx_vec&,
+                                                const arma::cx_vec&, 
+                                                const arma::cx_vec&,
+                                                const arma::cx_vec&,
+                                                const arma::vec&) const;
+
+        void BShamiltonianOutOfCore(const arma::imat&);
+        void BShamiltonianCompressed(const arma::imat&);
+        void BShamiltonianSectors(const arma::imat&);
+        void BShamiltonianReal(const arma::imat&);
+        arma::cx_mat fromRealBasis(const arma::cx_mat&) const;
+        std::vector<arma::uvec> kpointClusters(arma::uword) const;
+        template<typename T>
+        void assembleBSE(arma::Mat<T>&, const arma::imat&);
+        template<typename T>
+        void assembleBSEReciprocal(arma::Mat<T>&, const arma::imat&);
+        void assembleCoupling(arma::cx_mat&, const arma::imat&);
+        arma::cx_mat applyBSE(const arma::imat&, const arma::cx_mat&) const;
+        arma::cx_mat applyBSEDensities(const arma::imat&, const arma::cx_mat&) const;
+        void refineEigenpairs(arma::vec&, arma::cx_mat&, const arma::imat&, const arma::vec&,
+                              double tolerance = 1E-8, int maxIterations = 20);
 
         // Initializers
         void initializeExcitonAttributes(int, const arma::ivec&, const arma::rowvec&, const arma::rowvec&,
                                          const std::string&);
         void initializeExcitonAttributes(const ExcitonConfiguration&);
         void initializeBasis();
-        void initializeResultsH0(bool triangular = false);
+        virtual void initializeResultsH0(bool triangular = false);
+        void initializeBandStacks(bool triangular = false);
+        void initializeMotifFTStack();
+        void initializeReciprocalKernel();
+        void initializeInteractionKernel();
+        void initializeMotifKernel();
+        void initializeGaugePhases();
+        void initializeBands(int, bool triangular = false, bool computeKQ = true);
+        void initializeBandsKQ(int, bool triangular = false);
+        void initializeBandStacksKQ(bool triangular = false);
+        arma::uvec commensurateKQIndices() const;
+        arma::uvec equivalentMeshIndices(const arma::mat&) const;
+        void copyBandsKQ(const arma::uvec&, int);
         void initializeMotifFT(int, const arma::mat&);
+        void initializeDensityFitting(const arma::imat&);
         
+        // Progress report and cancellation
+        bool reportProgress(const std::string&, double);
+        void checkCancelled(const std::string&);
+
         // Utilities
         void generateBandDictionary();
+        arma::uvec pairsWithinEnergyWindow(const arma::imat&, double) const;
+        std::vector<arma::uvec> spinSectorPairs(const arma::imat&) const;
+        void enforceTimeReversalGauge(bool triangular = false);
+        arma::uvec timeReversedPairs(const arma::imat&) const;
         void createMesh();
         
         // Gauge fixing
-        arma::cx_vec latticeToAtomicGauge(const arma::cx_vec&, const arma::rowvec&);
-        arma::cx_vec atomicToLatticeGauge(const arma::cx_vec&, const arma::rowvec&);
-        arma::cx_mat fixGlobalPhase(arma::cx_mat&);
+        arma::cx_vec latticeToAtomicGauge(const arma::cx_vec&, const arma::rowvec&) const;
+        arma::cx_vec atomicToLatticeGauge(const arma::cx_vec&, const arma::rowvec&) const;
+        arma::cx_mat fixGlobalPhase(arma::cx_mat&) const;
 
         // Auxiliary routines for Fermi golden rule
         arma::rowvec findElectronHolePair(const Exciton&, double, std::string, bool);
@@ -201,16 +417,31 @@ class Exciton : public System {
     public:
         arma::imat createBasis(const arma::ivec&, const arma::ivec&);
         arma::imat specifyBasisSubset(const arma::ivec& bands);
+        arma::imat restrictToEnergyWindow(const arma::imat&, double) const;
         void useSpinfulBasis();
         void printInformation();
 
         // Symmetries
-        arma::mat C3ExcitonBasisRep();
+        arma::mat C3ExcitonBasisRep() const;
         
         // BSE initialization and energies
         void initializeHamiltonian(bool triangular = false);
-        void BShamiltonian(const arma::imat& basis = {});
-        Result diagonalize(std::string method = "diag", int nstates = 8);
+        virtual void initializeHamiltonian(const Exciton&, bool triangular = false);
+        bool hasSameBands(const Exciton&) const;
+        bool hasSameKBands(const Exciton&) const;
+        bool hasSameMotifFT(const Exciton&) const;
+        virtual void extendBands(const arma::ivec&, const arma::cx_mat& previousStates = {}, bool triangular = false);
+        virtual void BShamiltonian(const arma::imat& basis = {});
+        virtual Result diagonalize(std::string method = "diag", int nstates = 8);
+
+        // Parameter sweeps reusing the kernel
+        void BShamiltonianComponents();
+        void recombineBSE();
+        arma::mat sweepSpectra(const arma::mat&, int nstates = 8, const std::string& method = "diag");
+
+        // Exciton dispersion along a path of center-of-mass momenta
+        arma::mat excitonDispersion(const arma::mat&, int nstates = 8, const std::string& method = "davidson",
+                                    int parallelQ = 1, bool triangular = false);
 
         // Fermi golden rule       
         double pairDensityOfStates(double, double) const;
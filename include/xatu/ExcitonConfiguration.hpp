@@ -25,8 +25,8 @@ class ExcitonConfiguration : public ConfigurationBase{
         arma::rowvec Q = {0., 0., 0.};
         // Displacement vector of the center of the BZ mesh.
         arma::rowvec shift;
-        // Cutoff to be used 
-        double cutoff;
+        // Cutoff to be used (zero for the default, ncell/2.5)
+        double cutoff = 0;
         // Dielectric constants
         arma::vec eps = {};
         // Screening length
@@ -43,6 +43,14 @@ class ExcitonConfiguration : public ConfigurationBase{
         int nReciprocalVectors = 0;
         // Interaction type (Keldysh or Coulomb)
         std::string interactionType = "keldysh";
+        // Maximum transition energy of the electron-hole pairs kept in the basis (0 to keep all)
+        double energyWindow = 0.0;
+        // Flag to split the BSE in spin sectors (only for models that conserve Sz)
+        bool spinSectors = false;
+        // Flag to build and solve the BSE in real arithmetic (only for Q = 0 and real Fock matrices)
+        bool realArithmetic = false;
+        // Flag to solve the full BSE instead of the Tamm-Dancoff approximation (only for Q = 0)
+        bool fullBSE = false;
     };
 
     public:
@@ -0,0 +1,87 @@
+#pragma once
+#ifdef XATU_MPI
+#include <armadillo>
+#include <complex>
+#include <mpi.h>
+#include <vector>
+
+#include "xatu/Exciton.hpp"
+
+namespace xatu {
+
+/**
+ * Distributed-memory exciton. The Bethe-Salpeter matrix is stored in a 2D block-cyclic
+ * layout over a BLACS process grid and diagonalized with ScaLAPACK, so that its size is
+ * not limited by the memory of a single node.
+ * @details The k points of the band and motif FT stages are distributed among the ranks, and
+ * the resulting stacks are stored in MPI-3 shared-memory windows, so that all the ranks of a
+ * node read a single copy. Each rank assembles only its own blocks of HBS. The full matrices
+ * HBS and HK are never stored, so the observables of Result that use them (kinetic and
+ * potential energies) are not available, and neither is extendBands(). An exciton initialized
+ * from a previous one copies its stacks into new windows. All ranks must call the same methods in the same
+ * order (they are collective), and the object must be destroyed before MPI_Finalize().
+ */
+class ExcitonMPI : public Exciton {
+
+    private:
+        MPI_Comm comm_ = MPI_COMM_WORLD;
+        int rank_ = 0, nprocs_ = 1;
+        // BLACS grid
+        int context_ = -1, nprow_ = 1, npcol_ = 1, myrow_ = 0, mycol_ = 0;
+        int blockSize_ = 64;
+        // Ranks sharing memory (same node), and one leader rank per node
+        MPI_Comm nodeComm_ = MPI_COMM_NULL, leaderComm_ = MPI_COMM_NULL;
+        int nodeRank_ = 0, nodeSize_ = 1, nodeIndex_ = 0, nnodes_ = 1;
+        // Shared-memory windows holding the eigenvector and motif FT stacks
+        std::vector<MPI_Win> windows_;
+        // Local blocks of the Bethe-Salpeter matrix and their ScaLAPACK descriptor
+        arma::cx_mat HBSLocal_;
+        int descHBS_[9];
+        int basisDimBSE_ = 0;
+
+    public:
+        // Returns local blocks of the distributed Bethe-Salpeter matrix
+        const arma::cx_mat& HBSLocal = HBSLocal_;
+        // Returns rank of the process in the communicator
+        const int& rank = rank_;
+        // Returns number of processes in the communicator
+        const int& nprocs = nprocs_;
+
+    public:
+        using Exciton::Exciton;
+        ~ExcitonMPI();
+
+        void setCommunicator(MPI_Comm);
+        void setBlockSize(int);
+
+        using Exciton::initializeHamiltonian;
+        void initializeHamiltonian(const Exciton&, bool triangular = false) override;
+        void extendBands(const arma::ivec&, const arma::cx_mat& previousStates = {}, bool triangular = false) override;
+        void BShamiltonian(const arma::imat& basis = {}) override;
+        Result diagonalize(std::string method = "diag", int nstates = 8) override;
+
+    protected:
+        void initializeResultsH0(bool triangular = false) override;
+
+    private:
+        void initializeGrid();
+        long int localToGlobal(int, int, int) const;
+        template<typename T>
+        void broadcast(T*, arma::uword);
+
+        // Node-shared stacks
+        void initializeNodeCommunicators();
+        void freeSharedWindows();
+        void localRange(int, int&, int&) const;
+        template<typename T>
+        MPI_Win allocateShared(arma::Cube<T>&, arma::uword, arma::uword, arma::uword);
+        template<typename T>
+        void copyShared(arma::Cube<T>&, const arma::Cube<T>&, MPI_Win);
+        template<typename T>
+        void gatherSlices(arma::Cube<T>&, int, MPI_Win);
+        void gatherColumns(arma::mat&, int);
+        void checkCancelledAll(const std::string&);
+};
+
+}
+#endif
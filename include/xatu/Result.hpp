@@ -17,8 +17,9 @@ namespace xatu {
 class Result{
 
     private:
-        // Exciton object which has been diagonalized.
-        Exciton& exciton;
+        // Exciton object which has been diagonalized (read-only, so that several
+        // Result objects can be used concurrently).
+        const Exciton& exciton;
         // Exciton eigenenergies
         arma::vec m_eigval;
         // Exciton eigenstates
@@ -31,53 +32,56 @@ class Result{
         const arma::cx_mat& eigvec = m_eigvec;
 
     public:
-        Result(Exciton& exciton_, arma::vec& eigval_, arma::cx_mat& eigvec_) : 
+        Result(const Exciton& exciton_, const arma::vec& eigval_, const arma::cx_mat& eigvec_) : 
                 exciton(exciton_),
                 m_eigval(eigval_),
                 m_eigvec(eigvec_){};
 
         // Observables
-        double kineticEnergy(int);
-        double potentialEnergy(int);
-        double bindingEnergy(int, double gap = -1);
-        double determineGap();
-        arma::cx_vec spinX(int);
+        double kineticEnergy(int) const;
+        double potentialEnergy(int) const;
+        double bindingEnergy(int, double gap = -1) const;
+        double determineGap() const;
+        arma::cx_vec spinX(int) const;
 
         // Symmetries
-        arma::cx_mat diagonalizeC3(const arma::vec&);
-        arma::cx_mat symmetrizeStates(const arma::cx_vec&, const arma::cx_vec&);
+        arma::cx_mat diagonalizeC3(const arma::vec&) const;
+        arma::cx_mat symmetrizeStates(const arma::cx_vec&, const arma::cx_vec&) const;
 
         // Output and plotting
-        void writeReciprocalAmplitude(const arma::cx_vec&, FILE*);
-        void writeReciprocalAmplitude(int, FILE*);
-        void writePhase(const arma::cx_vec&, FILE*);
-        void writePhase(int, FILE*);
-        void writeExtendedReciprocalAmplitude(const arma::cx_vec&, FILE*);
-        void writeExtendedReciprocalAmplitude(int, FILE*);
-        void writeExtendedPhase(const arma::cx_vec&, FILE*);
-        void writeExtendedPhase(int, FILE*);
-        void writeRealspaceAmplitude(const arma::cx_vec&, int, const arma::rowvec&, FILE*, int ncells = 3);
-        void writeRealspaceAmplitude(int, int, const arma::rowvec&, FILE*, int ncells = 3);
-        void writeEigenvalues(FILE*, int n = 0);
-        void writeStates(FILE*, int n = 0);
-        void writeAbsorptionSpectrum();
-        void writeSpin(int, FILE*);
+        void writeReciprocalAmplitude(const arma::cx_vec&, FILE*) const;
+        void writeReciprocalAmplitude(int, FILE*) const;
+        void writePhase(const arma::cx_vec&, FILE*) const;
+        void writePhase(int, FILE*) const;
+        void writeExtendedReciprocalAmplitude(const arma::cx_vec&, FILE*) const;
+        void writeExtendedReciprocalAmplitude(int, FILE*) const;
+        void writeExtendedPhase(const arma::cx_vec&, FILE*) const;
+        void writeExtendedPhase(int, FILE*) const;
+        void writeRealspaceAmplitude(const arma::cx_vec&, int, const arma::rowvec&, FILE*, int ncells = 3) const;
+        void writeRealspaceAmplitude(int, int, const arma::rowvec&, FILE*, int ncells = 3) const;
+        void writeRealspaceAmplitude(const arma::vec&, int, const arma::rowvec&, FILE*, int ncells = 3) const;
+        arma::vec realspaceAmplitude(const arma::cx_vec&, int, const arma::rowvec&, int ncells = 3) const;
+        arma::vec realspaceAmplitude(int, int, const arma::rowvec&, int ncells = 3) const;
+        void writeEigenvalues(FILE*, int n = 0) const;
+        void writeStates(FILE*, int n = 0) const;
+        void writeAbsorptionSpectrum() const;
+        void writeSpin(int, FILE*) const;
         
 
-        double fourierTransformExciton(int, const arma::rowvec&, const arma::rowvec&);
+        double fourierTransformExciton(int, const arma::rowvec&, const arma::rowvec&) const;
 
         double realSpaceWavefunction(const arma::cx_vec&, int, int,
-                                     const arma::rowvec&, const arma::rowvec&);
+                                     const arma::rowvec&, const arma::rowvec&) const;
         
-        std::complex<double> densityMatrixElement(Exciton&, int, int, int, int);
+        std::complex<double> densityMatrixElement(const Exciton&, int, int, int, int) const;
 
-        std::complex<double> densityMatrix(Exciton&, const arma::cx_vec&, int, int);
-        std::complex<double> densityMatrixK(int, Exciton&, const arma::cx_vec&, int, int);
+        std::complex<double> densityMatrix(const Exciton&, const arma::cx_vec&, int, int) const;
+        std::complex<double> densityMatrixK(int, const Exciton&, const arma::cx_vec&, int, int) const;
 
     private:
-        int findExcitonPeak(int);
-        double boundingBoxBZ();
-        arma::cx_vec addExponential(arma::cx_vec&, const arma::rowvec&);
+        int findExcitonPeak(int) const;
+        double boundingBoxBZ() const;
+        arma::cx_vec addExponential(arma::cx_vec&, const arma::rowvec&) const;
 };
 
 }
\ No newline at end of file
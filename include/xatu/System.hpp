@@ -57,12 +57,16 @@ class System : public Crystal{
         arma::cx_mat overlap(arma::rowvec k, bool isTriangular = false) const;
         void solveBands(arma::rowvec&, arma::vec&, arma::cx_mat&, bool triangular = false) const;
         void solveBands(std::string, bool triangular = false) const;
+        void solveBandsSpinZ(const arma::rowvec&, arma::vec&, arma::cx_mat&, arma::vec&, bool triangular = false) const;
+        void solveRealBands(const arma::rowvec&, arma::vec&, arma::mat&, bool triangular = false) const;
 
         /* Expected value of spin components */
         
         double expectedSpinZValue(const arma::cx_vec&);
         double expectedSpinYValue(const arma::cx_vec&);
         double expectedSpinXValue(const arma::cx_vec&);        
+        bool conservesSpinZ(double tolerance = 1E-10) const;
+        bool hasRealMatrices(double tolerance = 1E-10) const;
     
         void initializeSystemAttributes(const SystemConfiguration&);
 
@@ -0,0 +1,54 @@
+#pragma once
+#include <armadillo>
+#include <complex>
+#include <string>
+#include <vector>
+
+namespace xatu {
+
+/**
+ * Hermitian matrix stored out of core, in a memory-mapped file split in column tiles.
+ * @details Tile t holds the columns [firstColumn(t), lastColumn(t)] and the rows up to
+ * lastColumn(t), i.e. the upper triangle plus the full (Hermitian) diagonal block, so the file
+ * takes about half of the dense matrix. The file is created in the given directory (ideally a
+ * local NVMe disk) and unlinked immediately, so it is removed when the object is destroyed.
+ * Products are computed streaming the tiles, advising the kernel to read ahead the next one.
+ */
+class TiledMatrix {
+
+    private:
+        int fd_ = -1;
+        std::complex<double>* data_ = nullptr;
+        std::size_t bytes_ = 0;
+        arma::uword n_ = 0, tileColumns_ = 0;
+        int ntiles_ = 0;
+        // Offset (in elements) of each tile in the file
+        std::vector<std::size_t> offsets_;
+        arma::vec diagonal_;
+
+    public:
+        // Returns dimension of the matrix
+        const arma::uword& n = n_;
+        // Returns number of tiles
+        const int& ntiles = ntiles_;
+        // Returns diagonal of the matrix (filled as tiles are completed)
+        const arma::vec& diagonal = diagonal_;
+
+    public:
+        TiledMatrix(const std::string&, arma::uword, arma::uword tileColumns = 0);
+        TiledMatrix(const TiledMatrix&) = delete;
+        TiledMatrix& operator=(const TiledMatrix&) = delete;
+        ~TiledMatrix();
+
+        arma::uword firstColumn(int) const;
+        arma::uword lastColumn(int) const;
+        arma::cx_mat tile(int);
+        void completeTile(int);
+        arma::cx_mat multiply(const arma::cx_mat&) const;
+
+    private:
+        std::size_t tileBytes(int) const;
+        void advise(int, int) const;
+};
+
+}
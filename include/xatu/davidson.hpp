@@ -1,5 +1,11 @@
 #include <armadillo>
+#include <functional>
 
 namespace xatu {
-    void davidson_method(arma::vec&, arma::cx_mat&, const arma::cx_mat&, int neigval = 4, double tol = 1E-8);
+    // Product of the (Hermitian) matrix with a block of vectors, for matrix-free solvers
+    typedef std::function<arma::cx_mat(const arma::cx_mat&)> BlockMatVec;
+
+    bool davidson_method(arma::vec&, arma::cx_mat&, const arma::cx_mat&, int neigval = 4, double tol = 1E-8);
+    bool davidson_method(arma::vec&, arma::cx_mat&, const BlockMatVec&, const arma::vec&, int neigval = 4,
+                         double tol = 1E-6, int maxIterations = 200, const arma::cx_mat& guess = {});
 }
@@ -0,0 +1,10 @@
+#pragma once
+#include <armadillo>
+
+namespace xatu {
+    // Structure-preserving solvers of the full BSE [[A, B], [-B*, -A*]], returning the positive
+    // excitation energies with their resonant (X) and antiresonant (Y) parts
+    void product_form_method(arma::vec&, arma::mat&, arma::mat&, const arma::mat&, const arma::mat&, int nstates = 0);
+    void complex_product_form_method(arma::vec&, arma::cx_mat&, arma::cx_mat&, const arma::cx_mat&, const arma::cx_mat&,
+                                     int nstates = 0);
+}
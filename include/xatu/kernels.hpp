@@ -0,0 +1,17 @@
+#pragma once
+#include <armadillo>
+#include <complex>
+
+namespace xatu {
+    // Contraction sum_ij rho1_i M_ij rho2_j of the atom-resolved pair densities rho1 = conj(c1) c3 and
+    // rho2 = conj(c2) c4 with the motif Fourier transform M, given the atom of each orbital. The
+    // coefficients are read through pointers, e.g. to the columns of the band stacks
+    typedef std::complex<double> (*MotifKernel)(const std::complex<double>*, const std::complex<double>*,
+                                                const std::complex<double>*, const std::complex<double>*,
+                                                const arma::cx_mat&, const arma::uvec&);
+
+    std::complex<double> motifContraction(const std::complex<double>*, const std::complex<double>*,
+                                          const std::complex<double>*, const std::complex<double>*,
+                                          const arma::cx_mat&, const arma::uvec&);
+    MotifKernel motifKernel(int natoms, int basisdim);
+}
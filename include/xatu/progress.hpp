@@ -0,0 +1,27 @@
+#pragma once
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace xatu {
+
+/**
+ * Callback to follow the progress of the long stages of an exciton calculation.
+ * @details It receives the name of the stage ('bands', 'motifFT', 'bse' or 'solver') and the
+ * completed fraction of that stage, between 0 and 1. Returning false requests the cancellation
+ * of the calculation. The callback may be invoked from any of the OpenMP threads, but never
+ * concurrently.
+ */
+typedef std::function<bool(const std::string&, double)> ProgressCallback;
+
+/**
+ * Exception thrown when a calculation is cancelled, either from the progress callback
+ * or with Exciton::cancel().
+ */
+class CancelledError : public std::runtime_error {
+    public:
+        explicit CancelledError(const std::string& stage) : 
+            std::runtime_error("Calculation cancelled during stage '" + stage + "'") {};
+};
+
+}
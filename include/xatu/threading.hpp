@@ -0,0 +1,101 @@
+#pragma once
+#include <string>
+#include <algorithm>
+#include <armadillo>
+
+namespace xatu {
+
+/**
+ * Number of threads assigned to each stage of an exciton calculation.
+ * @details The band/motif FT stage and the BSE assembly are OpenMP loops whose
+ * iterations call BLAS/LAPACK, so BLAS is forced to one thread inside them. The
+ * dense diagonalization of the BSE is a single LAPACK call instead, so BLAS
+ * receives all the threads of the solver stage. A value of zero means that the stage
+ * uses the number of threads available to OpenMP (omp_get_max_threads()).
+ */
+struct ThreadingPolicy {
+    // OpenMP threads for the loops over k points (bands and motif FT)
+    int bands = 0;
+    // OpenMP threads for the assembly of the Bethe-Salpeter matrix
+    int bse = 0;
+    // BLAS threads for the eigensolver of the Bethe-Salpeter matrix
+    int solver = 0;
+    // Thread affinity, either 'none', 'close' or 'spread'
+    std::string binding = "none";
+};
+
+void setThreadingPolicy(const ThreadingPolicy&);
+const ThreadingPolicy& getThreadingPolicy();
+void setNumThreads(int);
+void setStageThreads(const std::string&);
+int stageThreads(const std::string&);
+
+void setBLASThreads(int);
+int getBLASThreads();
+void acquireBLASThreads(int);
+void releaseBLASThreads(int);
+void bindThreads(const std::string&);
+
+/**
+ * Requests a number of BLAS threads for the lifetime of the object (see acquireBLASThreads).
+ * @details The requests of all the guards alive in the process are combined, so that several
+ * calculations running concurrently do not undo each other's setting; the value previous to
+ * the first guard is restored when the last one goes out of scope (also if an exception is
+ * thrown). A non-positive number of threads makes no request.
+ */
+class BLASThreadGuard {
+    private:
+        int nthreads_;
+
+    public:
+        explicit BLASThreadGuard(int nthreads) : nthreads_(nthreads){
+            if(nthreads_ > 0){
+                acquireBLASThreads(nthreads_);
+            }
+        }
+        ~BLASThreadGuard(){
+            if(nthreads_ > 0){
+                releaseBLASThreads(nthreads_);
+            }
+        }
+        BLASThreadGuard(const BLASThreadGuard&) = delete;
+        BLASThreadGuard& operator=(const BLASThreadGuard&) = delete;
+};
+
+void printThreadingPolicy();
+
+int pageTile(arma::uword, std::size_t);
+
+/**
+ * Zeroes a matrix in parallel, so that each memory page is placed (first-touched)
+ * on the NUMA node of the thread that will later work on it.
+ * @details Columns are distributed in static chunks of 'tile' columns; loops that
+ * use the same schedule and number of threads access the pages they touched here.
+ * @param matrix Matrix allocated without initialization (arma::fill::none).
+ * @param tile Number of consecutive columns assigned to each thread chunk.
+ * @param nthreads Number of threads.
+ * @return void
+ */
+template<typename T>
+void firstTouch(arma::Mat<T>& matrix, int tile, int nthreads){
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < (long int)matrix.n_cols; j++){
+        std::fill(matrix.colptr(j), matrix.colptr(j) + matrix.n_rows, T(0));
+    }
+}
+
+/**
+ * Zeroes a cube in parallel distributing the slices statically among the threads.
+ * @param cube Cube allocated without initialization (arma::fill::none).
+ * @param nthreads Number of threads.
+ * @return void
+ */
+template<typename T>
+void firstTouch(arma::Cube<T>& cube, int nthreads){
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for(long int s = 0; s < (long int)cube.n_slices; s++){
+        std::fill(cube.slice_memptr(s), cube.slice_memptr(s) + cube.n_elem_slice, T(0));
+    }
+}
+
+}
@@ -7,6 +7,13 @@
 #include <string>
 #include <chrono>
 #include <iomanip>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <future>
+#include <functional>
+#include <stdexcept>
+#include <omp.h>
 
 #include <tclap/CmdLine.h>
 #include <xatu.hpp>
@@ -20,6 +27,117 @@
 using namespace arma;
 using namespace std::chrono;
 
+/**
+ * Single calculation of a batch: an exciton file and, optionally, one parameter
+ * overridden with a given value.
+ */
+struct Job {
+    std::string excitonfile;
+    std::string key;
+    double value;
+};
+
+/**
+ * Expands a sweep specification 'key:start:end:n' into a list of jobs over the given exciton file.
+ * @param sweep Sweep specification.
+ * @param excitonfile Exciton file used as template for all the jobs.
+ * @return List of jobs.
+ */
+std::vector<Job> parseSweep(const std::string& sweep, const std::string& excitonfile){
+    std::vector<std::string> fields;
+    std::istringstream iss(sweep);
+    std::string field;
+    while(std::getline(iss, field, ':')){
+        fields.push_back(field);
+    }
+    if(fields.size() != 4){
+        throw std::invalid_argument("--sweep expects key:start:end:n");
+    }
+    std::vector<std::string> keys = {"scissor", "ncell", "cutoff", "epsm", "epss", "r0"};
+    if(std::find(keys.begin(), keys.end(), fields[0]) == keys.end()){
+        throw std::invalid_argument("--sweep key must be either scissor, ncell, cutoff, epsm, epss or r0");
+    }
+    double start = std::stod(fields[1]);
+    double end   = std::stod(fields[2]);
+    int npoints  = std::stoi(fields[3]);
+    if(npoints < 1){
+        throw std::invalid_argument("--sweep number of points must be positive");
+    }
+
+    std::vector<Job> jobs;
+    arma::vec values = arma::linspace(start, end, npoints);
+    for(double value : values){
+        if(fields[0] == "ncell"){
+            value = std::round(value);
+        }
+        jobs.push_back({excitonfile, fields[0], value});
+    }
+
+    return jobs;
+}
+
+/**
+ * Key of the inputs of the motif FT of an exciton (see Exciton::hasSameMotifFT), used to find
+ * a previous job whose motif FT can be reused. All the jobs share the system, so it only
+ * depends on the mesh, the truncation and the potential; the reuse is still checked by the exciton.
+ * @param exciton Exciton of the job, with its parameters already set.
+ * @param config Exciton configuration of the job, which defines the mesh.
+ * @return Key of the motif FT.
+ */
+std::string motifFTKey(const xatu::Exciton& exciton, const xatu::ExcitonConfiguration& config){
+    std::ostringstream key;
+    key << std::setprecision(17) << exciton.mode << ":" << exciton.interactionType << ":" << exciton.ncell << ":"
+        << config.excitonInfo.submeshFactor << ":" << exciton.cutoff;
+    if(exciton.interactionType == "keldysh"){
+        key << ":" << exciton.r0;
+    }
+    for(double component : config.excitonInfo.shift){
+        key << ":" << component;
+    }
+    return key.str();
+}
+
+/**
+ * Launches an output task in its own thread. The task runs its OpenMP regions with a single
+ * thread, since the cores are used by the calculation of the next job.
+ * @param task Output task.
+ * @return Future of the task.
+ */
+std::future<void> launchWriter(const std::function<void()>& task){
+    return std::async(std::launch::async, [task](){
+        omp_set_num_threads(1);
+        task();
+    });
+}
+
+/**
+ * Opens an output file for writing, throwing if it can not be opened.
+ * @param filename Name of the file.
+ * @return Pointer to the open file.
+ */
+FILE* openOutput(const std::string& filename){
+    FILE* textfile = fopen(filename.c_str(), "w");
+    if(textfile == NULL){
+        throw std::runtime_error("Could not open " + filename + " for writing");
+    }
+    return textfile;
+}
+
+/**
+ * Waits for all the output tasks to finish, rethrowing any exception raised while writing.
+ * @param writers List of output tasks.
+ * @return void
+ */
+void waitWriters(std::vector<std::future<void>>& writers){
+    for(auto& writer : writers){
+        writer.get();
+    }
+    if(!writers.empty()){
+        std::cout << "Output files of the previous job written" << std::endl;
+    }
+    writers.clear();
+}
+
 int main(int argc, char* argv[]){
 
     auto start = high_resolution_clock::now();
@@ -46,9 +164,22 @@ int main(int argc, char* argv[]){
     TCLAP::ValuesConstraint<std::string> allowedMethods(methods);
     TCLAP::ValueArg<std::string> methodArg("m", "method", "Method to solve the Bethe-Salpeter equation.", false, "diag", &allowedMethods, cmd);
     TCLAP::ValueArg<std::string> bandsArg("b", "bands", "Computes the bands of the system on the specified kpoints.", false, "kpoints.txt", "Filename", cmd);
+
+    TCLAP::ValueArg<int> threadsArg("t", "threads", "Number of threads used by OpenMP and BLAS.", false, 0, "No. threads", cmd);
+    TCLAP::ValueArg<std::string> stageThreadsArg("", "stagethreads", "Threads per stage, e.g. bands=4,bse=16,solver=16.", false, "", "stage=threads,...", cmd);
+    std::vector<std::string> bindings = {"none", "close", "spread"};
+    TCLAP::ValuesConstraint<std::string> allowedBindings(bindings);
+    TCLAP::ValueArg<std::string> bindArg("", "bind", "Pin OpenMP threads to cores.", false, "none", &allowedBindings, cmd);
+    TCLAP::SwitchArg singleArg("", "single", "Build and diagonalize the BSE in single precision, refining the computed states in double precision.", cmd, false);
+    TCLAP::ValueArg<std::string> outOfCoreArg("", "outofcore", "Store the BSE matrix in a memory-mapped file in the given directory (requires -m davidson).", false, "", "Directory", cmd);
+    TCLAP::ValueArg<double> compressArg("", "compress", "Store the BSE matrix in block-low-rank form with the given tolerance (requires -m davidson).", false, 0, "Tolerance", cmd);
+    TCLAP::ValueArg<double> isdfArg("", "isdf", "Fit the pair densities on a subset of atoms selected with the given tolerance (realspace mode).", false, 0, "Tolerance", cmd);
+    TCLAP::ValueArg<std::string> qpathArg("", "qpath", "Computes the exciton dispersion on the center-of-mass momenta of the file (one per line).", false, "qpoints.txt", "Filename", cmd);
+    TCLAP::ValueArg<int> parallelQArg("", "parallelq", "Number of Q points of the dispersion computed concurrently.", false, 1, "No. Q points", cmd);
+    TCLAP::ValueArg<std::string> sweepArg("", "sweep", "Sweep one parameter of the exciton file (scissor, ncell, cutoff, epsm, epss or r0).", false, "", "key:start:end:n", cmd);
     
     TCLAP::UnlabeledValueArg<std::string> systemArg("systemfile", "System file", true, "system.txt", "filename", cmd);
-    TCLAP::UnlabeledValueArg<std::string> excitonArg("excitonfile", "Exciton file", false, "exciton.txt", "filename", cmd);
+    TCLAP::UnlabeledMultiArg<std::string> excitonArg("excitonfiles", "Exciton file(s). Several files are run as a batch.", false, "filename", cmd);
 
     cmd.parse(argc, argv);
 
@@ -71,14 +202,37 @@ int main(int argc, char* argv[]){
         throw std::invalid_argument("-r takes at most two values, holeIndex and ncells");
     }
 
+    if (outOfCoreArg.isSet() && method != "davidson"){
+        throw std::invalid_argument("--outofcore requires the davidson method (-m davidson).");
+    }
+    if (compressArg.isSet() && method != "davidson"){
+        throw std::invalid_argument("--compress requires the davidson method (-m davidson).");
+    }
+    if (compressArg.isSet() && outOfCoreArg.isSet()){
+        throw std::invalid_argument("--compress and --outofcore can not be used together.");
+    }
+
+    // Threading policy must be set before any parallel region is entered
+    if (threadsArg.isSet()){
+        xatu::setNumThreads(threadsArg.getValue());
+    }
+    xatu::ThreadingPolicy policy = xatu::getThreadingPolicy();
+    policy.binding = bindArg.getValue();
+    xatu::setThreadingPolicy(policy);
+    if (stageThreadsArg.isSet()){
+        xatu::setStageThreads(stageThreadsArg.getValue());
+    }
+    int totalThreads = omp_get_max_threads();
+
     std::string systemfile  = systemArg.getValue();
-    std::string excitonfile = excitonArg.getValue();
+    std::vector<std::string> excitonfiles = excitonArg.getValue();
     std::string kpointsfile = bandsArg.getValue();
 
     // Init. configurations
     std::unique_ptr<xatu::SystemConfiguration> systemConfig;
     std::unique_ptr<xatu::CrystalDFTConfiguration> systemDFTConfig; 
-    std::unique_ptr<xatu::ExcitonConfiguration> excitonConfig;
+    std::map<std::string, std::unique_ptr<xatu::ExcitonConfiguration>> excitonConfigs;
+    std::vector<Job> jobs;
 
     if (dftArg.isSet()){
         systemConfig.reset(new xatu::CrystalDFTConfiguration(systemfile, ncells));
@@ -102,134 +256,292 @@ int main(int argc, char* argv[]){
             throw std::invalid_argument("Must provide exciton file.");
         }
 
-        excitonConfig.reset(new xatu::ExcitonConfiguration(excitonfile));
+        if (sweepArg.isSet()){
+            if (excitonfiles.size() != 1){
+                throw std::invalid_argument("--sweep requires exactly one exciton file.");
+            }
+            jobs = parseSweep(sweepArg.getValue(), excitonfiles[0]);
+        }
+        else{
+            for (const auto& excitonfile : excitonfiles){
+                jobs.push_back({excitonfile, "", 0});
+            }
+        }
+
+        // Each exciton file is parsed only once, even if used by several jobs
+        for (const auto& excitonfile : excitonfiles){
+            if (excitonConfigs.find(excitonfile) == excitonConfigs.end()){
+                excitonConfigs[excitonfile].reset(new xatu::ExcitonConfiguration(excitonfile));
+            }
+        }
     }
 
     // -------------------------- Main body ---------------------------
 
     xatu::printHeader();
 
-    cout << "+---------------------------------------------------------------------------+" << endl;
-    cout << "|                                  Parameters                               |" << endl;
-    cout << "+---------------------------------------------------------------------------+" << endl;
-    
-    xatu::Exciton bulkExciton = xatu::Exciton(*systemConfig, *excitonConfig);
-    bulkExciton.setMode(excitonConfig->excitonInfo.mode);
-
-    cout << std::left << std::setw(30) << "System configuration file: " << std::setw(10) << systemfile << endl;
-    cout << std::left << std::setw(30) << "Exciton configuration file: " << std::setw(10) << excitonfile << "\n" << endl;
-    bulkExciton.printInformation();
+    // Jobs run one after another, each one using the whole thread pool in its parallel stages.
+    // The bands are taken from the previous job whenever they match, and the motif FT from the
+    // last job with the same inputs (see motifFTKey), which are kept for the following jobs
+    // without their BSE matrices. The stacks are copied since the output of the previous job
+    // may still be being written.
+    const size_t maxWarmExcitons = 4;
+    std::map<std::string, std::pair<unsigned int, std::shared_ptr<xatu::Exciton>>> warmExcitons;
+    std::shared_ptr<xatu::Exciton> previousExciton;
+    std::unique_ptr<xatu::Result> previousResults;
+    std::vector<std::future<void>> writers;
+    for (unsigned int jobIndex = 0; jobIndex < jobs.size(); jobIndex++){
+
+        const Job& job = jobs[jobIndex];
+        const std::string& excitonfile = job.excitonfile;
+        const xatu::ExcitonConfiguration& excitonConfig = *excitonConfigs[excitonfile];
+        int ncell = excitonConfig.excitonInfo.ncell;
+
+        cout << "+---------------------------------------------------------------------------+" << endl;
+        cout << "|                                  Parameters                               |" << endl;
+        cout << "+---------------------------------------------------------------------------+" << endl;
     
-    cout << "+---------------------------------------------------------------------------+" << endl;
-    cout << "|                                Initialization                             |" << endl;
-    cout << "+---------------------------------------------------------------------------+" << endl;
+        std::shared_ptr<xatu::Exciton> bulkExciton(new xatu::Exciton(*systemConfig, excitonConfig));
+        bulkExciton->setMode(excitonConfig.excitonInfo.mode);
+        if (outOfCoreArg.isSet()){
+            bulkExciton->setOutOfCore(outOfCoreArg.getValue());
+        }
+        if (singleArg.isSet()){
+            bulkExciton->setPrecision("single");
+        }
+        if (compressArg.isSet()){
+            bulkExciton->setCompression(compressArg.getValue());
+        }
+        if (isdfArg.isSet()){
+            bulkExciton->setDensityFitting(isdfArg.getValue());
+        }
 
-    if(excitonConfig->excitonInfo.submeshFactor != 1){
-        bulkExciton.reducedBrillouinZoneMesh(excitonConfig->excitonInfo.ncell, excitonConfig->excitonInfo.submeshFactor);   
-    }
-    else{
-        bulkExciton.brillouinZoneMesh(excitonConfig->excitonInfo.ncell);
-    }
+        std::string output = excitonConfig.excitonInfo.label;
+        if (!job.key.empty()){
+            if (job.key == "scissor"){
+                bulkExciton->setScissor(job.value);
+            }
+            else if (job.key == "ncell"){
+                if (excitonConfig.excitonInfo.submeshFactor != 1){
+                    throw std::invalid_argument("ncell sweep is not compatible with submesh.");
+                }
+                ncell = (int)job.value;
+                bulkExciton->setUnitCells(ncell);
+                // The default cutoff follows the mesh, while a configured one is kept
+                if (excitonConfig.excitonInfo.cutoff <= 0){
+                    bulkExciton->setCutoff(ncell/2.5);
+                }
+            }
+            else if (job.key == "cutoff"){
+                bulkExciton->setCutoff(job.value);
+            }
+            else if (job.key == "epsm"){
+                bulkExciton->setParameters(job.value, bulkExciton->eps_s, bulkExciton->r0);
+            }
+            else if (job.key == "epss"){
+                bulkExciton->setParameters(bulkExciton->eps_m, job.value, bulkExciton->r0);
+            }
+            else if (job.key == "r0"){
+                bulkExciton->setParameters(bulkExciton->eps_m, bulkExciton->eps_s, job.value);
+            }
+            std::ostringstream suffix;
+            suffix << "_" << job.key << "_" << job.value;
+            output += suffix.str();
+        }
 
-    if(!excitonConfig->excitonInfo.shift.is_empty()){
-        arma::cout << excitonConfig->excitonInfo.shift << arma::endl;
-        bulkExciton.shiftBZ(excitonConfig->excitonInfo.shift);
-    }
+        if (jobs.size() > 1){
+            cout << std::left << std::setw(30) << "Job: " << jobIndex + 1 << " out of " << jobs.size() << endl;
+        }
+        cout << std::left << std::setw(30) << "System configuration file: " << std::setw(10) << systemfile << endl;
+        cout << std::left << std::setw(30) << "Exciton configuration file: " << std::setw(10) << excitonfile << "\n" << endl;
+        bulkExciton->printInformation();
+        xatu::printThreadingPolicy();
     
-    bulkExciton.initializeHamiltonian(triangular);
-    bulkExciton.BShamiltonian();
-    auto results = bulkExciton.diagonalize(method, nstates);
-
-    cout << "+---------------------------------------------------------------------------+" << endl;
-    cout << "|                                    Results                                |" << endl;
-    cout << "+---------------------------------------------------------------------------+" << endl;
-
-    xatu::printEnergies(results, nstates, decimals);
-
-    cout << "+---------------------------------------------------------------------------+" << endl;
-    cout << "|                                    Output                                 |" << endl;
-    cout << "+---------------------------------------------------------------------------+" << endl;
+        cout << "+---------------------------------------------------------------------------+" << endl;
+        cout << "|                                Initialization                             |" << endl;
+        cout << "+---------------------------------------------------------------------------+" << endl;
 
-    std::string output = excitonConfig->excitonInfo.label;
-
-    // --------------------------- Output ---------------------------
-    bool writeEigvals = energyArg.isSet();
-    if(writeEigvals){
-        std::string filename_en = output + ".eigval";
-        FILE* textfile_en = fopen(filename_en.c_str(), "w");
-
-        std::cout << "Writing eigvals to file: " << filename_en << std::endl;
-        fprintf(textfile_en, "%d\n", excitonConfig->excitonInfo.ncell);
-        results.writeEigenvalues(textfile_en, nstates);
+        if(excitonConfig.excitonInfo.submeshFactor != 1){
+            bulkExciton->reducedBrillouinZoneMesh(ncell, excitonConfig.excitonInfo.submeshFactor);   
+        }
+        else{
+            bulkExciton->brillouinZoneMesh(ncell);
+        }
 
-        fclose(textfile_en);
-    }
+        if(!excitonConfig.excitonInfo.shift.is_empty()){
+            arma::cout << excitonConfig.excitonInfo.shift << arma::endl;
+            bulkExciton->shiftBZ(excitonConfig.excitonInfo.shift);
+        }
     
-    bool writeStates = eigenstatesArg.isSet();
-    if(writeStates){
-        std::string filename_st = output + ".states";
-        FILE* textfile_st = fopen(filename_st.c_str(), "w");
-
-        std::cout << "Writing states to file: " << filename_st << std::endl;
-        results.writeStates(textfile_st, nstates);
+        std::string warmKey = motifFTKey(*bulkExciton, excitonConfig);
+        auto warm = warmExcitons.find(warmKey);
+        if (warm != warmExcitons.end()){
+            bulkExciton->initializeHamiltonian(*warm->second.second, triangular);
+        }
+        else if (previousExciton){
+            bulkExciton->initializeHamiltonian(*previousExciton, triangular);
+        }
+        else{
+            bulkExciton->initializeHamiltonian(triangular);
+        }
+        bulkExciton->BShamiltonian();
+        std::unique_ptr<xatu::Result> results(new xatu::Result(bulkExciton->diagonalize(method, nstates)));
+
+        cout << "+---------------------------------------------------------------------------+" << endl;
+        cout << "|                                    Results                                |" << endl;
+        cout << "+---------------------------------------------------------------------------+" << endl;
+
+        xatu::printEnergies(*results, nstates, decimals);
+
+        cout << "+---------------------------------------------------------------------------+" << endl;
+        cout << "|                                    Output                                 |" << endl;
+        cout << "+---------------------------------------------------------------------------+" << endl;
+
+        // --------------------------- Output ---------------------------
+        // Writers of the previous job must finish before its exciton is released
+        waitWriters(writers);
+        omp_set_num_threads(totalThreads);
+        if (previousExciton){
+            previousExciton->releaseArray("HBS");
+            previousExciton->releaseArray("HK");
+        }
 
-        fclose(textfile_st);
-    }
+        // Each file is written by its own task, which overlaps with the next job. The per-state
+        // messages of the real-space w.f. are not printed, since they would be interleaved with
+        // the output of the next job; waitWriters reports when the files are complete
+        xatu::Result* res = results.get();
+        bool writeEigvals = energyArg.isSet();
+        if(writeEigvals){
+            std::string filename_en = output + ".eigval";
+            std::cout << "Writing eigvals to file: " << filename_en << std::endl;
+
+            writers.push_back(launchWriter([=](){
+                FILE* textfile_en = openOutput(filename_en);
+                fprintf(textfile_en, "%d\n", ncell);
+                res->writeEigenvalues(textfile_en, nstates);
+                fclose(textfile_en);
+            }));
+        }
     
-    bool writeWF = reciprocalArg.isSet();
-    if(writeWF){
-        std::string filename_kwf = output + ".kwf";
-        FILE* textfile_kwf = fopen(filename_kwf.c_str(), "w");
-
-        std::cout << "Writing k w.f. to file: " << filename_kwf << std::endl;
-        for(int stateindex = 0; stateindex < nstates; stateindex++){
-            if (excitonConfig->excitonInfo.submeshFactor != 1){
-                results.writeReciprocalAmplitude(stateindex, textfile_kwf);
-            }
-            else{
-                results.writeExtendedReciprocalAmplitude(stateindex, textfile_kwf);
-            }
+        bool writeStates = eigenstatesArg.isSet();
+        if(writeStates){
+            std::string filename_st = output + ".states";
+            std::cout << "Writing states to file: " << filename_st << std::endl;
+
+            writers.push_back(launchWriter([=](){
+                FILE* textfile_st = openOutput(filename_st);
+                res->writeStates(textfile_st, nstates);
+                fclose(textfile_st);
+            }));
         }
-
-        fclose(textfile_kwf);
-    }
     
-    bool writeRSWF = realspaceArg.isSet();
-    if(writeRSWF){
-        std::string filename_rswf = output + ".rswf";
-        FILE* textfile_rswf = fopen(filename_rswf.c_str(), "w");
-
-        arma::uvec statesToWrite = arma::regspace<arma::uvec>(0, nstates - 1);
-        std::cout << "Writing real space w.f. to file: " << filename_rswf << std::endl;
-        arma::rowvec holeCell = {0., 0., 0.};
-        
-        for(unsigned int i = 0; i < statesToWrite.n_elem; i++){
-            std::cout << "Writing state " << i + 1 << " out of " << statesToWrite.n_elem << std::endl;
-            results.writeRealspaceAmplitude(statesToWrite(i), holeIndex, holeCell, textfile_rswf, ncellsRSWF);
+        bool writeWF = reciprocalArg.isSet();
+        if(writeWF){
+            std::string filename_kwf = output + ".kwf";
+            bool submesh = (excitonConfig.excitonInfo.submeshFactor != 1);
+            std::cout << "Writing k w.f. to file: " << filename_kwf << std::endl;
+
+            writers.push_back(launchWriter([=](){
+                FILE* textfile_kwf = openOutput(filename_kwf);
+                for(int stateindex = 0; stateindex < nstates; stateindex++){
+                    if (submesh){
+                        res->writeReciprocalAmplitude(stateindex, textfile_kwf);
+                    }
+                    else{
+                        res->writeExtendedReciprocalAmplitude(stateindex, textfile_kwf);
+                    }
+                }
+                fclose(textfile_kwf);
+            }));
+        }
+    
+        bool writeRSWF = realspaceArg.isSet();
+        if(writeRSWF){
+            std::string filename_rswf = output + ".rswf";
+            std::cout << "Writing real space w.f. to file: " << filename_rswf << std::endl;
+
+            writers.push_back(launchWriter([=](){
+                FILE* textfile_rswf = openOutput(filename_rswf);
+                arma::rowvec holeCell = {0., 0., 0.};
+
+                // The amplitude of state i + 1 is computed while state i is being written
+                std::future<arma::vec> next = std::async(std::launch::async, [=](){
+                    omp_set_num_threads(1);
+                    return res->realspaceAmplitude(0, holeIndex, holeCell, ncellsRSWF);
+                });
+                for(int i = 0; i < nstates; i++){
+                    arma::vec amplitude = next.get();
+                    if(i + 1 < nstates){
+                        next = std::async(std::launch::async, [=](){
+                            omp_set_num_threads(1);
+                            return res->realspaceAmplitude(i + 1, holeIndex, holeCell, ncellsRSWF);
+                        });
+                    }
+                    res->writeRealspaceAmplitude(amplitude, holeIndex, holeCell, textfile_rswf, ncellsRSWF);
+                }
+                fclose(textfile_rswf);
+            }));
         }
 
-        fclose(textfile_rswf);
-    }
+        bool writeAbs = absorptionArg.isSet();
+        if(writeAbs){
+            std::cout << "Writing absorption spectrum fo file... " << std::endl;
 
-    bool writeAbs = absorptionArg.isSet();
-    if(writeAbs){
-        std::string filename_abs = output + ".abs";
-        FILE* textfile_abs = fopen(filename_abs.c_str(), "w");
+            writers.push_back(launchWriter([=](){
+                res->writeAbsorptionSpectrum();
+            }));
+        }
 
-        std::cout << "Writing absorption spectrum fo file... " << std::endl;
-        results.writeAbsorptionSpectrum();
+        bool writeSpin = spinArg.isSet();
+        if(writeSpin){
+            std::string filename_spin = output + ".spin";
+            std::cout << "Writing excitons spin fo file: " << filename_spin << std::endl;
 
-        fclose(textfile_abs);
-    }
+            writers.push_back(launchWriter([=](){
+                FILE* textfile_spin = openOutput(filename_spin);
+                res->writeSpin(nstates, textfile_spin);
+                fclose(textfile_spin);
+            }));
+        }
+
+        // While the files are written, the calculation leaves one core to each writer
+        omp_set_num_threads(std::max(1, totalThreads - (int)writers.size()));
 
-    bool writeSpin = spinArg.isSet();
-    if(writeSpin){
-        std::string filename_spin = output + ".spin";
-        FILE* textfile_spin = fopen(filename_spin.c_str(), "w");
+        if(qpathArg.isSet()){
+            arma::mat Qpath;
+            if(!Qpath.load(qpathArg.getValue(), arma::raw_ascii)){
+                throw std::invalid_argument("Could not read Q points from " + qpathArg.getValue());
+            }
+            arma::mat dispersion = bulkExciton->excitonDispersion(Qpath, nstates, method, parallelQArg.getValue(), triangular);
+
+            std::string filename_disp = output + ".dispersion";
+            std::cout << "Writing exciton dispersion to file: " << filename_disp << std::endl;
+            FILE* textfile_disp = openOutput(filename_disp);
+            for(unsigned int q = 0; q < Qpath.n_rows; q++){
+                fprintf(textfile_disp, "%11.7lf\t%11.7lf\t%11.7lf\t", Qpath(q, 0), Qpath(q, 1), Qpath(q, 2));
+                for(unsigned int n = 0; n < dispersion.n_cols; n++){
+                    fprintf(textfile_disp, "%11.7lf\t", dispersion(q, n));
+                }
+                fprintf(textfile_disp, "\n");
+            }
+            fclose(textfile_disp);
+        }
 
-        std::cout << "Writing excitons spin fo file: " << filename_spin << std::endl;
-        results.writeSpin(nstates, textfile_spin);
+        // The least recently used exciton is dropped once the limit is reached
+        warmExcitons[warmKey] = {jobIndex, bulkExciton};
+        if (warmExcitons.size() > maxWarmExcitons){
+            auto oldest = warmExcitons.begin();
+            for (auto it = warmExcitons.begin(); it != warmExcitons.end(); it++){
+                if (it->second.first < oldest->second.first){
+                    oldest = it;
+                }
+            }
+            warmExcitons.erase(oldest);
+        }
+        previousExciton = std::move(bulkExciton);
+        previousResults = std::move(results);
     }
+    waitWriters(writers);
 
     auto stop = high_resolution_clock::now();
     auto duration = duration_cast<milliseconds>(stop - start);
@@ -0,0 +1,366 @@
+#include <iostream>
+#include <armadillo>
+#include <complex>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include <tclap/CmdLine.h>
+#include <xatu.hpp>
+
+/**
+ * Resident xatu service. Keeps the parsed configurations, and the band stacks and motif FT of
+ * the last exciton solved for each system, in memory between requests.
+ *
+ * Requests are JSON objects (one per line) sent over a Unix domain socket; each one receives
+ * a JSON object (one line) as response. Supported commands:
+ *  {"command": "solve", "system": "hBN.model", "exciton": "hBN.txt", "method": "diag", "nstates": 8}
+ *      Optional keys: "dft" (no. Fock matrices), "scissor", "epsm", "epss", "r0".
+ *      Returns {"status": "ok", "handle": h, "energies": [...]}.
+ *  {"command": "states", "handle": h, "n": 4}
+ *      Returns the first n states as arrays of interleaved real and imaginary parts.
+ *  {"command": "release", "handle": h}
+ *  {"command": "shutdown"}
+ * Each handle keeps its exciton alive; at most maxHandles are kept, and the oldest one is
+ * released when a new solve would exceed the limit.
+ */
+
+// Results of one solve, kept alive until released by the client
+struct Handle {
+    std::shared_ptr<xatu::Exciton> exciton;
+    std::unique_ptr<xatu::Result> result;
+};
+
+/**
+ * Parses a flat JSON object into a dictionary of raw values. Nested objects and arrays
+ * are not supported, which is enough for the job requests.
+ * @param text JSON string.
+ * @return Dictionary with the values as strings (without quotes).
+ */
+std::map<std::string, std::string> parseRequest(const std::string& text){
+    std::map<std::string, std::string> request;
+    size_t pos = text.find('{');
+    if(pos == std::string::npos){
+        throw std::invalid_argument("request must be a JSON object");
+    }
+    pos++;
+
+    auto skipSpaces = [&](){
+        while(pos < text.size() && std::isspace((unsigned char)text[pos])){
+            pos++;
+        }
+    };
+    auto parseString = [&](){
+        if(text[pos] != '"'){
+            throw std::invalid_argument("expected string in request");
+        }
+        std::string value;
+        pos++;
+        while(pos < text.size() && text[pos] != '"'){
+            if(text[pos] == '\\' && pos + 1 < text.size()){
+                pos++;
+            }
+            value += text[pos];
+            pos++;
+        }
+        if(pos >= text.size()){
+            throw std::invalid_argument("unterminated string in request");
+        }
+        pos++;
+        return value;
+    };
+
+    skipSpaces();
+    while(pos < text.size() && text[pos] != '}'){
+        std::string key = parseString();
+        skipSpaces();
+        if(text[pos] != ':'){
+            throw std::invalid_argument("expected ':' in request");
+        }
+        pos++;
+        skipSpaces();
+        std::string value;
+        if(text[pos] == '"'){
+            value = parseString();
+        }
+        else{
+            while(pos < text.size() && text[pos] != ',' && text[pos] != '}' && !std::isspace((unsigned char)text[pos])){
+                value += text[pos];
+                pos++;
+            }
+        }
+        request[key] = value;
+        skipSpaces();
+        if(text[pos] == ','){
+            pos++;
+            skipSpaces();
+        }
+    }
+    if(pos >= text.size()){
+        throw std::invalid_argument("unterminated JSON object");
+    }
+
+    return request;
+}
+
+/**
+ * Escapes a string to be included in a JSON response.
+ * @param text String to escape.
+ * @return Escaped string, with quotes.
+ */
+std::string quote(const std::string& text){
+    std::string escaped = "\"";
+    for(char c : text){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+            escaped += c;
+        }
+        else if(c == '\n'){
+            escaped += "\\n";
+        }
+        else{
+            escaped += c;
+        }
+    }
+    return escaped + "\"";
+}
+
+class Daemon {
+
+    private:
+        std::map<std::string, std::unique_ptr<xatu::SystemConfiguration>> systems;
+        std::map<std::string, std::unique_ptr<xatu::ExcitonConfiguration>> excitons;
+        // Last exciton solved for each system, used to reuse bands and motif FT
+        std::map<std::string, std::shared_ptr<xatu::Exciton>> warm;
+        std::map<int, Handle> handles;
+        int nextHandle = 0;
+        size_t maxHandles;
+
+    public:
+        bool running = true;
+
+        explicit Daemon(int maxHandles) : maxHandles(maxHandles > 0 ? maxHandles : 0){
+            if(maxHandles <= 0){
+                throw std::invalid_argument("Daemon: the maximum number of handles must be positive");
+            }
+        }
+
+        std::string process(const std::string& line){
+            try{
+                auto request = parseRequest(line);
+                std::string command = request["command"];
+                if(command == "solve"){
+                    return solve(request);
+                }
+                else if(command == "states"){
+                    return states(request);
+                }
+                else if(command == "release"){
+                    handles.erase(std::stoi(request.at("handle")));
+                    return "{\"status\": \"ok\"}";
+                }
+                else if(command == "shutdown"){
+                    running = false;
+                    return "{\"status\": \"ok\"}";
+                }
+                throw std::invalid_argument("unknown command '" + command + "'");
+            }
+            catch(const std::exception& e){
+                return "{\"status\": \"error\", \"message\": " + quote(e.what()) + "}";
+            }
+        }
+
+    private:
+        std::string solve(std::map<std::string, std::string>& request){
+            std::string systemfile  = request.at("system");
+            std::string excitonfile = request.at("exciton");
+            std::string method = request.count("method") ? request["method"] : "diag";
+            int nstates = request.count("nstates") ? std::stoi(request["nstates"]) : 8;
+            bool triangular = request.count("dft") > 0;
+
+            std::string systemKey = systemfile + (triangular ? ":" + request["dft"] : "");
+            if(systems.find(systemKey) == systems.end()){
+                if(triangular){
+                    systems[systemKey].reset(new xatu::CrystalDFTConfiguration(systemfile, std::stoi(request["dft"])));
+                }
+                else{
+                    systems[systemKey].reset(new xatu::SystemConfiguration(systemfile));
+                }
+            }
+            if(excitons.find(excitonfile) == excitons.end()){
+                excitons[excitonfile].reset(new xatu::ExcitonConfiguration(excitonfile));
+            }
+            const xatu::ExcitonConfiguration& excitonConfig = *excitons[excitonfile];
+
+            std::shared_ptr<xatu::Exciton> exciton(new xatu::Exciton(*systems[systemKey], excitonConfig));
+            exciton->setMode(excitonConfig.excitonInfo.mode);
+            if(request.count("scissor")){
+                exciton->setScissor(std::stod(request["scissor"]));
+            }
+            if(request.count("epsm") || request.count("epss") || request.count("r0")){
+                double eps_m = request.count("epsm") ? std::stod(request["epsm"]) : exciton->eps_m;
+                double eps_s = request.count("epss") ? std::stod(request["epss"]) : exciton->eps_s;
+                double r0    = request.count("r0") ? std::stod(request["r0"]) : exciton->r0;
+                exciton->setParameters(eps_m, eps_s, r0);
+            }
+
+            if(excitonConfig.excitonInfo.submeshFactor != 1){
+                exciton->reducedBrillouinZoneMesh(excitonConfig.excitonInfo.ncell, excitonConfig.excitonInfo.submeshFactor);
+            }
+            else{
+                exciton->brillouinZoneMesh(excitonConfig.excitonInfo.ncell);
+            }
+            if(!excitonConfig.excitonInfo.shift.is_empty()){
+                exciton->shiftBZ(excitonConfig.excitonInfo.shift);
+            }
+
+            if(warm.find(systemKey) != warm.end()){
+                exciton->initializeHamiltonian(*warm[systemKey], triangular);
+            }
+            else{
+                exciton->initializeHamiltonian(triangular);
+            }
+            exciton->BShamiltonian();
+
+            Handle handle;
+            handle.exciton = exciton;
+            handle.result.reset(new xatu::Result(exciton->diagonalize(method, nstates)));
+            warm[systemKey] = exciton;
+
+            int id = nextHandle++;
+            std::ostringstream response;
+            response << std::setprecision(10);
+            response << "{\"status\": \"ok\", \"handle\": " << id << ", \"energies\": [";
+            const arma::vec& eigval = handle.result->eigval;
+            int nEnergies = std::min((int)eigval.n_elem, nstates);
+            for(int i = 0; i < nEnergies; i++){
+                response << (i ? ", " : "") << eigval(i);
+            }
+            response << "]";
+            // Handles are numbered in order, so the first one in the map is the oldest
+            while(handles.size() >= maxHandles){
+                response << ", \"released\": " << handles.begin()->first;
+                handles.erase(handles.begin());
+            }
+            response << "}";
+            handles[id] = std::move(handle);
+
+            return response.str();
+        }
+
+        std::string states(std::map<std::string, std::string>& request){
+            int id = std::stoi(request.at("handle"));
+            if(handles.find(id) == handles.end()){
+                throw std::invalid_argument("unknown handle " + std::to_string(id));
+            }
+            const arma::cx_mat& eigvec = handles[id].result->eigvec;
+            int n = request.count("n") ? std::stoi(request["n"]) : eigvec.n_cols;
+            n = std::min(n, (int)eigvec.n_cols);
+
+            std::ostringstream response;
+            response << std::setprecision(10);
+            response << "{\"status\": \"ok\", \"states\": [";
+            for(int j = 0; j < n; j++){
+                response << (j ? ", [" : "[");
+                for(unsigned int i = 0; i < eigvec.n_rows; i++){
+                    response << (i ? ", " : "") << std::real(eigvec(i, j)) << ", " << std::imag(eigvec(i, j));
+                }
+                response << "]";
+            }
+            response << "]}";
+
+            return response.str();
+        }
+};
+
+int main(int argc, char* argv[]){
+
+    TCLAP::CmdLine cmd("Resident xatu service accepting JSON job requests over a Unix domain socket.", ' ', "1.0");
+    TCLAP::ValueArg<std::string> socketArg("s", "socket", "Path of the Unix domain socket.", false, "/tmp/xatu.sock", "Path", cmd);
+    TCLAP::ValueArg<int> threadsArg("t", "threads", "Number of threads used by OpenMP and BLAS.", false, 0, "No. threads", cmd);
+    TCLAP::ValueArg<int> handlesArg("m", "maxhandles", "Maximum number of results kept (oldest released first).", false, 16, "No. handles", cmd);
+    cmd.parse(argc, argv);
+
+    // A client that disconnects before reading its response must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    if (threadsArg.isSet()){
+        xatu::setNumThreads(threadsArg.getValue());
+    }
+
+    std::string socketPath = socketArg.getValue();
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server < 0){
+        throw std::runtime_error("Could not create socket");
+    }
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(address.sun_path)){
+        throw std::invalid_argument("Socket path is too long");
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+    unlink(socketPath.c_str());
+    if(bind(server, (sockaddr*)&address, sizeof(address)) < 0 || listen(server, 4) < 0){
+        throw std::runtime_error("Could not bind socket " + socketPath);
+    }
+
+    xatu::printHeader();
+    std::cout << "Listening on " << socketPath << std::endl;
+
+    // Requests are served one at a time; each solve uses the whole thread pool
+    Daemon daemon(handlesArg.getValue());
+    while(daemon.running){
+        int client = accept(server, nullptr, nullptr);
+        if(client < 0){
+            continue;
+        }
+
+        std::string buffer;
+        char chunk[4096];
+        ssize_t nread;
+        bool connected = true;
+        while(connected && daemon.running && (nread = read(client, chunk, sizeof(chunk))) > 0){
+            buffer.append(chunk, nread);
+            size_t newline;
+            while(connected && daemon.running && (newline = buffer.find('\n')) != std::string::npos){
+                std::string line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                if(line.find_first_not_of(" \t\r") == std::string::npos){
+                    continue;
+                }
+                std::string response = daemon.process(line) + "\n";
+                size_t written = 0;
+                while(written < response.size()){
+                    ssize_t nwritten = send(client, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+                    if(nwritten < 0 && errno == EINTR){
+                        continue;
+                    }
+                    if(nwritten <= 0){
+                        // EPIPE or ECONNRESET: the client is gone, drop the connection
+                        std::cerr << "Client disconnected before reading the response" << std::endl;
+                        connected = false;
+                        break;
+                    }
+                    written += nwritten;
+                }
+            }
+        }
+        close(client);
+    }
+
+    close(server);
+    unlink(socketPath.c_str());
+
+    return 0;
+}
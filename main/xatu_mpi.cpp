@@ -0,0 +1,94 @@
+#include <iostream>
+#include <armadillo>
+#include <string>
+#include <chrono>
+#include <iomanip>
+
+#include <tclap/CmdLine.h>
+#include <xatu.hpp>
+
+#ifndef XATU_MPI
+#error "xatu_mpi requires the MPI backend, build with 'make xatu_mpi MPI=1'"
+#endif
+
+using namespace std::chrono;
+
+/**
+ * Distributed-memory driver: solves the BSE of one exciton file with the Bethe-Salpeter matrix
+ * distributed over all the MPI processes, e.g. 'mpirun -np 4 bin/xatu_mpi hBN.model hBN.txt'.
+ * Only the root process prints.
+ */
+int main(int argc, char* argv[]){
+
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int status = 0;
+    try{
+        TCLAP::CmdLine cmd("Distributed-memory solver of the Bethe-Salpeter equation (MPI + ScaLAPACK).", ' ', "1.0");
+        TCLAP::UnlabeledValueArg<std::string> systemArg("systemfile", "System file", true, "", "system filename", cmd);
+        TCLAP::UnlabeledValueArg<std::string> excitonArg("excitonfile", "Exciton file", true, "", "exciton filename", cmd);
+        TCLAP::ValueArg<int> statesArg("s", "states", "Number of states to print and gather.", false, 8, "No. states", cmd);
+        TCLAP::ValueArg<int> blockArg("b", "blocksize", "Block size of the block-cyclic distribution.", false, 64, "Block size", cmd);
+        TCLAP::ValueArg<int> threadsArg("t", "threads", "Number of OpenMP threads per process.", false, 0, "No. threads", cmd);
+        cmd.parse(argc, argv);
+
+        if (threadsArg.isSet()){
+            xatu::setNumThreads(threadsArg.getValue());
+        }
+        int nstates = statesArg.getValue();
+
+        auto start = high_resolution_clock::now();
+
+        xatu::SystemConfiguration systemConfig(systemArg.getValue());
+        xatu::ExcitonConfiguration excitonConfig(excitonArg.getValue());
+
+        if (rank == 0){
+            xatu::printHeader();
+        }
+
+        // Scoped so that the BLACS grid is released before MPI_Finalize
+        {
+            xatu::ExcitonMPI exciton(systemConfig, excitonConfig);
+            exciton.setMode(excitonConfig.excitonInfo.mode);
+            exciton.setBlockSize(blockArg.getValue());
+            exciton.setSilent(rank != 0);
+            if (rank == 0){
+                exciton.printInformation();
+            }
+
+            if(excitonConfig.excitonInfo.submeshFactor != 1){
+                exciton.reducedBrillouinZoneMesh(excitonConfig.excitonInfo.ncell, excitonConfig.excitonInfo.submeshFactor);
+            }
+            else{
+                exciton.brillouinZoneMesh(excitonConfig.excitonInfo.ncell);
+            }
+            if(!excitonConfig.excitonInfo.shift.is_empty()){
+                exciton.shiftBZ(excitonConfig.excitonInfo.shift);
+            }
+
+            exciton.initializeHamiltonian();
+            exciton.BShamiltonian();
+            auto results = exciton.diagonalize("diag", nstates);
+
+            if (rank == 0){
+                xatu::printEnergies(results, nstates);
+            }
+        }
+
+        auto stop = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(stop - start);
+        if (rank == 0){
+            std::cout << "Elapsed time: " << duration.count()/1000.0 << " s" << std::endl;
+        }
+    }
+    catch(const std::exception& e){
+        std::cerr << "Rank " << rank << ": " << e.what() << std::endl;
+        status = 1;
+        MPI_Abort(MPI_COMM_WORLD, status);
+    }
+
+    MPI_Finalize();
+    return status;
+}
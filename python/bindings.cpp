@@ -0,0 +1,267 @@
+#include <armadillo>
+#include <complex>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/complex.h>
+#include <pybind11/stl.h>
+#include <pybind11/functional.h>
+
+#include <xatu.hpp>
+
+namespace py = pybind11;
+using namespace xatu;
+
+/**
+ * Memory of an array of a System or Exciton viewed from NumPy without copy.
+ * @details While the array belongs to the object, the keeper holds a reference to the Python
+ * object, so it cannot be destroyed while a view is alive. Before a method recomputes the array,
+ * the array is moved into the keeper (see Crystal::releaseArray): the views keep reading the
+ * original memory, and the object allocates new memory for the new array.
+ */
+struct ArrayKeeper {
+    py::object owner;
+    std::shared_ptr<void> storage;
+};
+
+// Keepers of the arrays currently viewed, by object and name of the array (accessed with the GIL held)
+static std::map<const Crystal*, std::map<std::string, std::weak_ptr<ArrayKeeper>>> viewedArrays;
+
+/**
+ * Returns the handle that keeps alive the memory of an array of a System or Exciton, shared by
+ * all the views of the same array.
+ * @param self Python object owning the array.
+ * @param name Name of the array.
+ * @return Capsule holding the keeper of the array.
+ */
+py::capsule arrayKeeper(py::object self, const std::string& name){
+    const Crystal* object = &self.cast<const System&>();
+    std::shared_ptr<ArrayKeeper> keeper = viewedArrays[object][name].lock();
+    if(!keeper){
+        keeper = std::make_shared<ArrayKeeper>();
+        keeper->owner = self;
+        viewedArrays[object][name] = keeper;
+    }
+    return py::capsule(new std::shared_ptr<ArrayKeeper>(keeper), [](void* pointer){
+        delete static_cast<std::shared_ptr<ArrayKeeper>*>(pointer);
+    });
+}
+
+/**
+ * Moves the viewed arrays that a method is going to recompute into their keepers, so that the
+ * existing views remain valid. Must be called with the GIL held, before the method.
+ * @param object System or Exciton.
+ * @param names Names of the arrays recomputed by the method.
+ * @return void
+ */
+void releaseViewedArrays(Crystal& object, const std::vector<std::string>& names){
+    auto entry = viewedArrays.find(&object);
+    if(entry == viewedArrays.end()){
+        return;
+    }
+    for(const std::string& name : names){
+        auto viewed = entry->second.find(name);
+        if(viewed == entry->second.end()){
+            continue;
+        }
+        if(std::shared_ptr<ArrayKeeper> keeper = viewed->second.lock()){
+            keeper->storage = object.releaseArray(name);
+            keeper->owner = py::none();
+        }
+        entry->second.erase(viewed);
+    }
+    if(entry->second.empty()){
+        viewedArrays.erase(entry);
+    }
+}
+
+/**
+ * Returns a read-only NumPy array with the contents of an Armadillo matrix.
+ * @details If 'owner' is given, the array is a view of the C++ memory that keeps a reference
+ * to it (e.g. the object or the keeper of the array, see arrayKeeper). Small matrices are stored
+ * inside the Armadillo object instead of in their own memory, which does not move along with
+ * them, so they are always copied. Armadillo stores matrices by columns, so the array has Fortran
+ * strides and the same indexing as in C++.
+ * @param matrix Matrix to expose.
+ * @param owner Python object that keeps the memory alive (none to copy it).
+ * @return NumPy array of shape (n_rows, n_cols).
+ */
+template<typename T>
+py::array matrixArray(const arma::Mat<T>& matrix, py::handle owner = py::handle()){
+    if(matrix.n_elem <= arma::arma_config::mat_prealloc){
+        owner = py::handle();
+    }
+    py::array_t<T> array({matrix.n_rows, matrix.n_cols},
+                         {sizeof(T), sizeof(T)*matrix.n_rows},
+                         matrix.memptr(), owner);
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+/**
+ * Returns a read-only NumPy array with the contents of an Armadillo vector (see matrixArray).
+ * @param vector Vector to expose.
+ * @param owner Python object that keeps the memory alive (none to copy it).
+ * @return NumPy array of shape (n_elem,).
+ */
+template<typename T>
+py::array vectorArray(const arma::Col<T>& vector, py::handle owner = py::handle()){
+    if(vector.n_elem <= arma::arma_config::mat_prealloc){
+        owner = py::handle();
+    }
+    py::array_t<T> array({vector.n_elem}, {sizeof(T)}, vector.memptr(), owner);
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+/**
+ * Returns a read-only NumPy array with the contents of an Armadillo cube (see matrixArray).
+ * @param cube Cube to expose.
+ * @param owner Python object that keeps the memory alive (none to copy it).
+ * @return NumPy array of shape (n_rows, n_cols, n_slices).
+ */
+template<typename T>
+py::array cubeArray(const arma::Cube<T>& cube, py::handle owner = py::handle()){
+    if(cube.n_elem <= arma::arma_config::cube_prealloc){
+        owner = py::handle();
+    }
+    py::array_t<T> array({cube.n_rows, cube.n_cols, cube.n_slices},
+                         {sizeof(T), sizeof(T)*cube.n_rows, sizeof(T)*cube.n_rows*cube.n_cols},
+                         cube.memptr(), owner);
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+// Arrays recomputed by each method, whose views are moved to their keepers before calling it
+static const std::vector<std::string> meshArrays = {"kpoints"};
+static const std::vector<std::string> bandArrays = {"eigvalKStack", "eigvalKQStack", "eigvecKStack", "eigvecKQStack", "basisStates"};
+static const std::vector<std::string> bseArrays = {"HBS", "HK"};
+
+PYBIND11_MODULE(xatu, m){
+
+    m.doc() = "Python bindings of the xatu exciton library";
+
+    py::register_exception<CancelledError>(m, "CancelledError");
+
+    py::class_<SystemConfiguration>(m, "SystemConfiguration")
+        .def(py::init<std::string>(), py::arg("filename"));
+
+    py::class_<ExcitonConfiguration>(m, "ExcitonConfiguration")
+        .def(py::init<std::string>(), py::arg("filename"));
+
+    py::class_<System>(m, "System")
+        .def(py::init<const SystemConfiguration&>(), py::arg("config"))
+        .def_property_readonly("basisdim", [](const System& s){ return s.basisdim; })
+        .def_property_readonly("fermiLevel", [](const System& s){ return s.fermiLevel; })
+        .def_property_readonly("natoms", [](const System& s){ return s.natoms; })
+        .def_property_readonly("nk", [](const System& s){ return s.nk; })
+        .def_property_readonly("kpoints", [](py::object self){
+            return matrixArray(self.cast<const System&>().kpoints, arrayKeeper(self, "kpoints"));
+        })
+        .def("setSilent", &Crystal::setSilent, py::arg("silent") = true)
+        .def("brillouinZoneMesh", [](System& system, int ncell){
+                releaseViewedArrays(system, meshArrays);
+                system.brillouinZoneMesh(ncell);
+             }, py::arg("ncell"))
+        .def("reducedBrillouinZoneMesh", [](System& system, int ncell, int factor){
+                releaseViewedArrays(system, meshArrays);
+                system.reducedBrillouinZoneMesh(ncell, factor);
+             }, py::arg("ncell"), py::arg("factor"));
+
+    py::class_<Exciton, System>(m, "Exciton")
+        .def(py::init([](const SystemConfiguration& config, int ncell, int nbands, int nrmbands,
+                         const std::vector<double>& parameters, const std::vector<double>& Q,
+                         const std::string& interactionType){
+                return new Exciton(config, ncell, nbands, nrmbands, arma::rowvec(parameters),
+                                   arma::rowvec(Q), interactionType);
+             }),
+             py::arg("config"), py::arg("ncell") = 20, py::arg("nbands") = 1, py::arg("nrmbands") = 0,
+             py::arg("parameters") = std::vector<double>{1, 5, 1}, py::arg("Q") = std::vector<double>{0., 0., 0.},
+             py::arg("interactionType") = "keldysh")
+        .def(py::init<const SystemConfiguration&, const ExcitonConfiguration&>(),
+             py::arg("config"), py::arg("excitonConfig"))
+        .def("setMode", &Exciton::setMode)
+        .def("setGauge", &Exciton::setGauge)
+        .def("setScissor", &Exciton::setScissor)
+        .def("setExchange", &Exciton::setExchange)
+        .def("setCutoff", &Exciton::setCutoff)
+        .def("setParameters", py::overload_cast<double, double, double>(&Exciton::setParameters))
+        // The progress callback is invoked from the OpenMP threads, so the long stages release the GIL
+        .def("setProgressCallback", &Exciton::setProgressCallback)
+        .def("cancel", &Exciton::cancel)
+        // The viewed arrays are released with the GIL held, and then the long stages run without it
+        .def("initializeHamiltonian", [](Exciton& exciton, bool triangular){
+                releaseViewedArrays(exciton, bandArrays);
+                py::gil_scoped_release release;
+                exciton.initializeHamiltonian(triangular);
+             }, py::arg("triangular") = false)
+        .def("BShamiltonian", [](Exciton& exciton){
+                releaseViewedArrays(exciton, bseArrays);
+                py::gil_scoped_release release;
+                exciton.BShamiltonian();
+             })
+        // Result holds a reference to the exciton, which must outlive it
+        .def("diagonalize", [](Exciton& exciton, std::string method, int nstates){
+                return std::unique_ptr<Result>(new Result(exciton.diagonalize(method, nstates)));
+             }, py::arg("method") = "diag", py::arg("nstates") = 8, py::keep_alive<0, 1>(),
+             py::call_guard<py::gil_scoped_release>())
+        // Each row of the grid is {eps_m, eps_s, scissor, exchange} (Keldysh) or {eps_r, scissor, exchange},
+        // optionally with r0 and cutoff after the dielectric constants (see Exciton::sweepSpectra)
+        .def("sweepSpectra", [](Exciton& exciton, const std::vector<std::vector<double>>& grid, int nstates, std::string method){
+                arma::mat parameters(grid.size(), grid.empty() ? 0 : grid[0].size());
+                for(arma::uword p = 0; p < parameters.n_rows; p++){
+                    if(grid[p].size() != parameters.n_cols){
+                        throw std::invalid_argument("sweepSpectra(): all rows of the grid must have the same length");
+                    }
+                    parameters.row(p) = arma::rowvec(grid[p]);
+                }
+                releaseViewedArrays(exciton, bseArrays);
+                arma::mat energies;
+                {
+                    py::gil_scoped_release release;
+                    energies = exciton.sweepSpectra(parameters, nstates, method);
+                }
+                std::vector<std::vector<double>> spectra(energies.n_rows);
+                for(arma::uword p = 0; p < energies.n_rows; p++){
+                    spectra[p] = arma::conv_to<std::vector<double>>::from(energies.row(p));
+                }
+                return spectra;
+             }, py::arg("grid"), py::arg("nstates") = 8, py::arg("method") = "diag")
+        .def_property_readonly("excitonbasisdim", [](const Exciton& e){ return e.excitonbasisdim; })
+        .def_property_readonly("eigvalKStack", [](py::object self){
+            return matrixArray(self.cast<const Exciton&>().eigvalKStack, arrayKeeper(self, "eigvalKStack"));
+        })
+        .def_property_readonly("eigvalKQStack", [](py::object self){
+            return matrixArray(self.cast<const Exciton&>().eigvalKQStack, arrayKeeper(self, "eigvalKQStack"));
+        })
+        .def_property_readonly("eigvecKStack", [](py::object self){
+            return cubeArray(self.cast<const Exciton&>().eigvecKStack, arrayKeeper(self, "eigvecKStack"));
+        })
+        .def_property_readonly("eigvecKQStack", [](py::object self){
+            return cubeArray(self.cast<const Exciton&>().eigvecKQStack, arrayKeeper(self, "eigvecKQStack"));
+        })
+        .def_property_readonly("HBS", [](py::object self){
+            return matrixArray(self.cast<const Exciton&>().HBS, arrayKeeper(self, "HBS"));
+        })
+        .def_property_readonly("HK", [](py::object self){
+            return matrixArray(self.cast<const Exciton&>().HK, arrayKeeper(self, "HK"));
+        })
+        .def_property_readonly("basisStates", [](py::object self){
+            return matrixArray(self.cast<const Exciton&>().basisStates, arrayKeeper(self, "basisStates"));
+        });
+
+    py::class_<Result>(m, "Result")
+        .def_property_readonly("eigval", [](py::object self){
+            return vectorArray(self.cast<const Result&>().eigval, self);
+        })
+        .def_property_readonly("eigvec", [](py::object self){
+            return matrixArray(self.cast<const Result&>().eigvec, self);
+        })
+        .def("kineticEnergy", &Result::kineticEnergy)
+        .def("potentialEnergy", &Result::potentialEnergy)
+        .def("bindingEnergy", &Result::bindingEnergy, py::arg("index"), py::arg("gap") = -1);
+}
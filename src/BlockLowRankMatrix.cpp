@@ -0,0 +1,261 @@
+#include <armadillo>
+#include <complex>
+#include <stdexcept>
+#include <algorithm>
+
+#include "xatu/BlockLowRankMatrix.hpp"
+
+namespace xatu {
+
+/**
+ * Builds the block-low-rank representation of a Hermitian matrix.
+ * @details Each block of the upper triangle is computed independently (in parallel). Admissible
+ * blocks are approximated with adaptive cross approximation and then recompressed with a
+ * truncated SVD; if the approximation does not reach the tolerance with a rank below half the
+ * block size, the block is stored dense instead.
+ * @param element Function returning the elements of the matrix.
+ * @param clusters Indices of the rows (and columns) of each cluster. Together they must cover
+ * all the indices once.
+ * @param admissible Matrix with non-zero entries for the pairs of clusters that can be compressed.
+ * @param tolerance Relative tolerance of the low-rank approximation of each block.
+ * @param nthreads Number of OpenMP threads used to build the blocks.
+ */
+BlockLowRankMatrix::BlockLowRankMatrix(const ElementFunction& element, const std::vector<arma::uvec>& clusters,
+                                       const arma::umat& admissible, double tolerance, int nthreads) :
+                                       tolerance_(tolerance), clusters_(clusters){
+
+    int nclusters = clusters.size();
+    if(admissible.n_rows != (arma::uword)nclusters || admissible.n_cols != (arma::uword)nclusters){
+        throw std::invalid_argument("BlockLowRankMatrix: admissibility matrix must be nclusters x nclusters");
+    }
+    if(tolerance <= 0){
+        throw std::invalid_argument("BlockLowRankMatrix: tolerance must be positive");
+    }
+    for(const auto& cluster : clusters){
+        n_ += cluster.n_elem;
+    }
+    diagonal_ = arma::zeros(n_);
+
+    for(int I = 0; I < nclusters; I++){
+        for(int J = I; J < nclusters; J++){
+            blocks_.push_back({(arma::uword)I, (arma::uword)J, false, {}, {}, {}});
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    for(unsigned int b = 0; b < blocks_.size(); b++){
+        Block& block = blocks_[b];
+        const arma::uvec& rows = clusters_[block.I];
+        const arma::uvec& cols = clusters_[block.J];
+
+        if(block.I != block.J && admissible(block.I, block.J)){
+            if(crossApproximation(element, rows, cols, block.U, block.V)){
+                recompress(block.U, block.V);
+                block.lowRank = true;
+                continue;
+            }
+        }
+
+        block.dense.set_size(rows.n_elem, cols.n_elem);
+        if(block.I == block.J){
+            for(arma::uword b2 = 0; b2 < cols.n_elem; b2++){
+                for(arma::uword a = 0; a <= b2; a++){
+                    block.dense(a, b2) = element(rows(a), cols(b2));
+                    block.dense(b2, a) = std::conj(block.dense(a, b2));
+                }
+            }
+        }
+        else{
+            for(arma::uword b2 = 0; b2 < cols.n_elem; b2++){
+                for(arma::uword a = 0; a < rows.n_elem; a++){
+                    block.dense(a, b2) = element(rows(a), cols(b2));
+                }
+            }
+        }
+    }
+
+    for(const Block& block : blocks_){
+        if(block.lowRank){
+            storedElements_ += block.U.n_elem + block.V.n_elem;
+        }
+        else{
+            storedElements_ += block.dense.n_elem;
+        }
+        if(block.I == block.J){
+            diagonal_(clusters_[block.I]) = arma::real(block.dense.diag());
+        }
+    }
+}
+
+/**
+ * Adaptive cross approximation with partial pivoting of a block, as U*V^H.
+ * @details The residual rows and columns are evaluated on the fly, so only O(rank*(m + n))
+ * elements are computed. Iterations stop when the norm of the last rank-one term falls below
+ * the tolerance relative to the (estimated) norm of the approximation.
+ * @param element Function returning the elements of the matrix.
+ * @param rows Row indices of the block.
+ * @param cols Column indices of the block.
+ * @param U Returns left factor.
+ * @param V Returns right factor.
+ * @return False if the tolerance was not reached with a rank below half of the block size.
+ */
+bool BlockLowRankMatrix::crossApproximation(const ElementFunction& element, const arma::uvec& rows,
+                                            const arma::uvec& cols, arma::cx_mat& U, arma::cx_mat& V) const {
+
+    arma::uword m = rows.n_elem, ncols = cols.n_elem;
+    arma::uword maxRank = std::max<arma::uword>(1, std::min(m, ncols)/2);
+    std::vector<arma::cx_vec> us, vs;
+    arma::uvec usedRows = arma::zeros<arma::uvec>(m);
+    arma::uword pivotRow = 0;
+    double normSquared = 0;
+    bool converged = false;
+
+    for(arma::uword attempt = 0; attempt < m && us.size() < maxRank; attempt++){
+        usedRows(pivotRow) = 1;
+
+        // Residual of the pivot row
+        arma::cx_rowvec row(ncols);
+        for(arma::uword j = 0; j < ncols; j++){
+            row(j) = element(rows(pivotRow), cols(j));
+        }
+        for(unsigned int l = 0; l < us.size(); l++){
+            row -= us[l](pivotRow)*vs[l].t();
+        }
+        arma::uword pivotCol = arma::index_max(arma::abs(row));
+        std::complex<double> pivot = row(pivotCol);
+
+        if(std::abs(pivot) < 1E-14){
+            // Row already reproduced, try the next unused one
+            arma::uvec unused = arma::find(usedRows == 0);
+            if(unused.is_empty()){
+                converged = true;
+                break;
+            }
+            pivotRow = unused(0);
+            continue;
+        }
+
+        // Residual of the pivot column
+        arma::cx_vec column(m);
+        for(arma::uword i = 0; i < m; i++){
+            column(i) = element(rows(i), cols(pivotCol));
+        }
+        for(unsigned int l = 0; l < us.size(); l++){
+            column -= us[l]*std::conj(vs[l](pivotCol));
+        }
+
+        arma::cx_vec u = column;
+        arma::cx_vec v = (row/pivot).t();
+        double termNorm = arma::norm(u)*arma::norm(v);
+        for(unsigned int l = 0; l < us.size(); l++){
+            normSquared += 2*std::real(arma::cdot(us[l], u)*arma::cdot(v, vs[l]));
+        }
+        normSquared += termNorm*termNorm;
+        us.push_back(u);
+        vs.push_back(v);
+
+        if(termNorm <= tolerance_*std::sqrt(std::abs(normSquared))){
+            converged = true;
+            break;
+        }
+
+        arma::vec weights = arma::abs(u);
+        weights(arma::find(usedRows)).fill(-1);
+        pivotRow = weights.index_max();
+        if(weights(pivotRow) < 0){
+            converged = true;
+            break;
+        }
+    }
+
+    if(!converged){
+        return false;
+    }
+    U.set_size(m, us.size());
+    V.set_size(ncols, vs.size());
+    for(unsigned int l = 0; l < us.size(); l++){
+        U.col(l) = us[l];
+        V.col(l) = vs[l];
+    }
+    return true;
+}
+
+/**
+ * Reduces the rank of a factorization U*V^H truncating its singular values with the tolerance.
+ * @param U Left factor, overwritten.
+ * @param V Right factor, overwritten.
+ * @return void
+ */
+void BlockLowRankMatrix::recompress(arma::cx_mat& U, arma::cx_mat& V) const {
+    if(U.n_cols == 0){
+        return;
+    }
+    arma::cx_mat QU, RU, QV, RV;
+    arma::qr_econ(QU, RU, U);
+    arma::qr_econ(QV, RV, V);
+
+    arma::cx_mat left, right;
+    arma::vec sigma;
+    arma::svd(left, sigma, right, RU*RV.t());
+    arma::uword rank = arma::accu(sigma > tolerance_*sigma(0));
+    rank = std::max<arma::uword>(1, rank);
+
+    U = QU*left.cols(0, rank - 1)*arma::diagmat(arma::conv_to<arma::cx_vec>::from(sigma.subvec(0, rank - 1)));
+    V = QV*right.cols(0, rank - 1);
+}
+
+/**
+ * Computes the product of the matrix with a block of vectors.
+ * @details Each stored block B_IJ (I < J) also contributes its Hermitian counterpart B_IJ^H.
+ * @param X Block of vectors by columns.
+ * @return Product of the matrix with X.
+ */
+arma::cx_mat BlockLowRankMatrix::multiply(const arma::cx_mat& X) const {
+    if(X.n_rows != n_){
+        throw std::invalid_argument("BlockLowRankMatrix::multiply(): dimension mismatch");
+    }
+    arma::cx_mat Y(n_, X.n_cols, arma::fill::zeros);
+    for(const Block& block : blocks_){
+        const arma::uvec& rows = clusters_[block.I];
+        const arma::uvec& cols = clusters_[block.J];
+        arma::cx_mat XI = X.rows(rows);
+        arma::cx_mat XJ = X.rows(cols);
+        if(block.lowRank){
+            Y.rows(rows) += block.U*(block.V.t()*XJ);
+            Y.rows(cols) += block.V*(block.U.t()*XI);
+        }
+        else{
+            Y.rows(rows) += block.dense*XJ;
+            if(block.I != block.J){
+                Y.rows(cols) += block.dense.t()*XI;
+            }
+        }
+    }
+    return Y;
+}
+
+/**
+ * Returns the number of stored elements relative to the dense matrix.
+ * @return Compression ratio.
+ */
+double BlockLowRankMatrix::compressionRatio() const {
+    return (double)storedElements_/((double)n_*n_);
+}
+
+/**
+ * Returns the number of blocks stored in low-rank form.
+ * @return Number of low-rank blocks.
+ */
+int BlockLowRankMatrix::lowRankBlocks() const {
+    return std::count_if(blocks_.begin(), blocks_.end(), [](const Block& b){ return b.lowRank; });
+}
+
+/**
+ * Returns the number of blocks stored dense.
+ * @return Number of dense blocks.
+ */
+int BlockLowRankMatrix::denseBlocks() const {
+    return blocks_.size() - lowRankBlocks();
+}
+
+}
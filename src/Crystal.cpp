@@ -1,5 +1,6 @@
 #include "xatu/Crystal.hpp"
 #include <numeric>
+#include <stdexcept>
 
 namespace xatu {
 
@@ -15,6 +16,7 @@ Crystal::Crystal(const Crystal& crystal){
 	bravaisLattice_ = crystal.bravaisLattice;
 	motif_          = crystal.motif;
 	unitCellList_   = crystal.unitCellList;
+	silent_         = crystal.silent_;
     
     natoms_ = motif.n_rows;
 	ncells_ = unitCellList.n_rows;
@@ -23,6 +25,45 @@ Crystal::Crystal(const Crystal& crystal){
 	extractLatticeParameters();
 }
 
+/**
+ * Enables or disables the silent mode, where no progress messages are printed.
+ * @param silent True to suppress the messages.
+ * @return void
+ */
+void Crystal::setSilent(bool silent){
+	silent_ = silent;
+}
+
+/**
+ * Moves an array out of the object, leaving it empty, and returns the ownership of its memory.
+ * @details Used to keep alive the memory of an array viewed without copy (e.g. from NumPy) when
+ * it is going to be recomputed: the memory moves along with the array, so the view remains valid.
+ * The array must be recomputed (e.g. by brillouinZoneMesh()) before it is used again.
+ * @param name Name of the array, 'kpoints'.
+ * @return Array holding the original memory.
+ */
+std::shared_ptr<void> Crystal::releaseArray(const std::string& name){
+	if (name == "kpoints"){
+		return std::make_shared<arma::mat>(std::move(kpoints_));
+	}
+	throw std::invalid_argument("releaseArray(): unknown array " + name);
+}
+
+/**
+ * Returns the stream where progress messages are written: std::cout, or a stream
+ * that discards everything if the silent mode is enabled.
+ * @return Output stream for progress messages.
+ */
+std::ostream& Crystal::log() const {
+	// One null stream per thread, since writing to it still modifies its state flags
+	thread_local std::ostream nullStream(nullptr);
+	if (silent_){
+		nullStream.clear();
+		return nullStream;
+	}
+	return std::cout;
+}
+
 /**
  * Method to initialize Crystal attributes from SystemConfiguration object.
  * 
@@ -71,12 +112,14 @@ void Crystal::calculateReciprocalLattice(){
 				reciprocal_vector.rows(0, ndim - 1) = arma::solve(coefficient_matrix, coefficient_vector);
 			}
 			catch (std::runtime_error e) {
-				std::cout << "Failed to obtain reciprocal lattice vectors" << std::endl;
+				log() << "Failed to obtain reciprocal lattice vectors" << std::endl;
 				throw;
 			};
 			reciprocalLattice_.row(i) = reciprocal_vector.t();
 		};
 	};
+
+	calculateInverseReciprocalMatrix();
 };
 
 /**
@@ -86,7 +129,7 @@ void Crystal::calculateReciprocalLattice(){
  */
 void Crystal::brillouinZoneMesh(int n){
 
-	std::cout << "Creating BZ mesh... " << std::flush;
+	log() << "Creating BZ mesh... " << std::flush;
 
 	int nk = pow(n, ndim);
 	arma::mat kpoints(pow(n, ndim), 3);
@@ -105,7 +148,7 @@ void Crystal::brillouinZoneMesh(int n){
 	kpoints_ = kpoints;
 	meshBZ_ = kpoints;
 	nk_ = kpoints.n_rows;
-	std::cout << "Done. Number of k points in BZ mesh: " << nk << std::endl;
+	log() << "Done. Number of k points in BZ mesh: " << nk << std::endl;
 }
 
 /**
@@ -157,7 +200,7 @@ void Crystal::reducedBrillouinZoneMesh(int n, int factor){
 	kpoints_ = kpoints;
 	nk_ = nk;
 	factor_ = factor;
-	std::cout << "Number of k points in submesh: " << nk << std::endl;
+	log() << "Number of k points in submesh: " << nk << std::endl;
 }
 
 /**
@@ -165,13 +208,13 @@ void Crystal::reducedBrillouinZoneMesh(int n, int factor){
  * @param shift Vector to shift center of BZ mesh. 
  */
 void Crystal::shiftBZ(const arma::rowvec& shift){
-	arma::cout << "Shifting BZ mesh by vector: " << shift << arma::endl;
+	log() << "Shifting BZ mesh by vector: " << shift << std::endl;
 	if(shift.n_elem != 3){
-		std::cout << "shift vector must be 3d" << std::endl;
+		log() << "shift vector must be 3d" << std::endl;
 		return; 
 	}
 	if(kpoints.empty()){
-		std::cout << "To call this method kpoints must be initiallized first" << std::endl;
+		log() << "To call this method kpoints must be initiallized first" << std::endl;
 		return;
 	}
 	for(int i = 0; i < kpoints.n_rows; i++){
@@ -373,8 +416,8 @@ arma::mat Crystal::wignerSeitzSupercell(int ncell){
 		planes.row(i) = arma::rowvec{A, B, d};
 	}
 
-	std::cout << midpoints << std::endl;
-	std::cout << planes << std::endl;
+	log() << midpoints << std::endl;
+	log() << planes << std::endl;
 	// Generate standard supercell
 	arma::mat standard_supercell_coefs = generateCombinations(ncell, ndim);
 	arma::mat cells = arma::zeros(standard_supercell_coefs.n_rows, 3);
@@ -391,10 +434,10 @@ arma::mat Crystal::wignerSeitzSupercell(int ncell){
             for (int m = 0; m < ndim; m++){
                 translation += combinations.row(n)(m) * bravaisLattice.row(m) * ncell;
             }
-            std::cout << lattice_vector << std::endl;
-            std::cout << translation << std::endl;
+            log() << lattice_vector << std::endl;
+            log() << translation << std::endl;
             arma::rowvec translated_vector = lattice_vector + translation;
-            std::cout << translated_vector << std::endl;
+            log() << translated_vector << std::endl;
             if (isInsideWsCell(translated_vector, planes, angles)){
                 cells.row(i) = translated_vector;
                 break;
@@ -420,9 +463,9 @@ bool Crystal::isInsideWsCell(const arma::rowvec& point,
 		double angle = angles(i);
 		arma::rowvec plane = planes.row(i);
 		double side = plane(0)*point(0) + plane(1)*point(1) + plane(2);
-		std::cout << angle << std::endl;
-		std::cout << side << std::endl;
-		std::cout << "---------" << std::endl;
+		log() << angle << std::endl;
+		log() << side << std::endl;
+		log() << "---------" << std::endl;
 		if (side <= 0){
 			checks(i) = 1;
 		}
@@ -448,7 +491,7 @@ bool Crystal::isInsideWsCell(const arma::rowvec& point,
  * 				   If false, all combinations have positive coefficients.
  * @returns List of cell combinations.
 */
-arma::mat Crystal::generateCombinations(int nvalues, int ndim, bool centered){
+arma::mat Crystal::generateCombinations(int nvalues, int ndim, bool centered) const {
 	int ncombinations = pow(nvalues, ndim);
 	arma::vec ones = arma::ones(nvalues);
 	arma::mat combinations(ncombinations, ndim);
@@ -495,7 +538,7 @@ arma::mat Crystal::supercellCutoff(int cutoff){
  * @param radius Cutoff radius of the sphere.
  * @returns List of cells within the sphere.
 */
-arma::mat Crystal::truncateSupercell(int ncell, double radius){
+arma::mat Crystal::truncateSupercell(int ncell, double radius) const {
 
 	arma::mat combinations = generateCombinations(ncell, ndim, true);
 	std::vector<arma::rowvec> cells_vector;
@@ -524,7 +567,7 @@ arma::mat Crystal::truncateSupercell(int ncell, double radius){
  * @param radius Radius of the cutoff sphere.
  * @returns List of reciprocal cells in cartesian coordinates.
 */
-arma::mat Crystal::truncateReciprocalSupercell(int ncell, double radius){
+arma::mat Crystal::truncateReciprocalSupercell(int ncell, double radius) const {
 
 	arma::mat combinations = generateCombinations(ncell, ndim, true);
 	std::vector<arma::rowvec> cells_vector;
@@ -553,7 +596,7 @@ arma::mat Crystal::truncateReciprocalSupercell(int ncell, double radius){
  * @param position Vector to rotate.
  * @returns Rotated vector.
  */
-arma::rowvec Crystal::rotateC3(const arma::rowvec& position){
+arma::rowvec Crystal::rotateC3(const arma::rowvec& position) const {
 	double theta = 2*PI/3;
 	arma::mat C3rotation = {{cos(theta), -sin(theta), 0},
 							{sin(theta),  cos(theta), 0},
@@ -578,7 +621,7 @@ void Crystal::calculateInverseReciprocalMatrix(){
 		inverse = arma::inv(coefs);	
 	}
 	catch(std::runtime_error e){
-		std::cout << "Unable to compute inverse reciprocal coefficients" << std::endl;
+		log() << "Unable to compute inverse reciprocal coefficients" << std::endl;
 		throw;
 	}
 	this->inverseReciprocalMatrix = inverse;
@@ -593,9 +636,11 @@ void Crystal::calculateInverseReciprocalMatrix(){
  * @param ncell Number of points used in the original BZ mesh, usually equivalent to the number of cells.
  * @returns Index (row) of the equivalent kpoint from the BZ mesh matrix.
  */ 
-int Crystal::findEquivalentPointBZ(const arma::rowvec& kpoint, int ncell){
+int Crystal::findEquivalentPointBZ(const arma::rowvec& kpoint, int ncell) const {
+	// The inverse matrix is computed together with the reciprocal lattice, so that this
+	// method does not modify the object and can be called concurrently
 	if(inverseReciprocalMatrix.empty()){
-		calculateInverseReciprocalMatrix();
+		throw std::logic_error("findEquivalentPointBZ(): reciprocal lattice must be initialized first");
 	}
 	ncell = ncell * factor_;
 	arma::vec independentTerm = reciprocalLattice * kpoint.t();
@@ -615,7 +660,7 @@ int Crystal::findEquivalentPointBZ(const arma::rowvec& kpoint, int ncell){
 	}
 	int index = 0;
 	
-	std::vector<int> cells_array = {1, ncell, ncell*ncell}; // Auxiliar array to avoid using std::pow
+	const int cells_array[3] = {1, ncell, ncell*ncell}; // Auxiliar array to avoid using std::pow
 	for(int i = 0; i < coefs.n_elem; i++){
 		index += coefs(i)*cells_array[i];
 	}
@@ -3,12 +3,15 @@
 #include <math.h>
 #include <stdlib.h>
 #include <iomanip>
+#include <exception>
 
 #include "xatu/System.hpp"
 #include "xatu/Exciton.hpp"
 #include "xatu/utils.hpp"
 #include "xatu/davidson.hpp"
+#include "xatu/fullbse.hpp"
 #include "xatu/interactions.hpp"
+#include "xatu/threading.hpp"
 
 using namespace arma;
 using namespace std::chrono;
@@ -71,6 +74,9 @@ void Exciton::initializeExcitonAttributes(const ExcitonConfiguration& cfg){
     }
 
     initializeExcitonAttributes(ncell, bands, parameters, Q, cfg.excitonInfo.interactionType);
+    if(cfg.excitonInfo.cutoff > 0){
+        this->cutoff_ = cfg.excitonInfo.cutoff;
+    }
 
     if(cfg.excitonInfo.submeshFactor != 1){
         this->totalCells_ = pow(ncell * cfg.excitonInfo.submeshFactor, ndim);
@@ -95,6 +101,10 @@ void Exciton::initializeExcitonAttributes(const ExcitonConfiguration& cfg){
     this->scissor_ = cfg.excitonInfo.scissor;
     this->mode_    = cfg.excitonInfo.mode;
     this->nReciprocalVectors_ = cfg.excitonInfo.nReciprocalVectors;
+    this->energyWindow_ = cfg.excitonInfo.energyWindow;
+    setSpinSectors(cfg.excitonInfo.spinSectors);
+    setRealArithmetic(cfg.excitonInfo.realArithmetic);
+    setFullBSE(cfg.excitonInfo.fullBSE);
 }
 
 /**
@@ -114,7 +124,7 @@ Exciton::Exciton(const SystemConfiguration& config, int ncell, const arma::ivec&
     initializeExcitonAttributes(ncell, bands, parameters, Q, interactionType);
 
     if (bands.n_elem > basisdim){
-        cout << "Error: Number of bands cannot be higher than actual material bands" << endl;
+        log() << "Error: Number of bands cannot be higher than actual material bands" << endl;
         exit(1);
     }
 
@@ -148,7 +158,7 @@ Exciton::Exciton(const SystemConfiguration& config, int ncell, int nbands, int n
           Exciton(config, ncell, {}, parameters, Q, interactionType) {
     
     if (2*nbands > basisdim){
-        cout << "Error: Number of bands cannot be higher than actual material bands" << endl;
+        log() << "Error: Number of bands cannot be higher than actual material bands" << endl;
         exit(1);
     }
     this->valenceBands_ = arma::regspace<arma::ivec>(fermiLevel - nbands - nrmbands + 1, 
@@ -177,7 +187,7 @@ Exciton::Exciton(const System& system, int ncell, const arma::ivec& bands,
     initializeExcitonAttributes(ncell, bands, parameters, Q, interactionType);
 
     if (bands.n_elem > basisdim){
-        cout << "Error: Number of bands cannot be higher than actual material bands" << endl;
+        log() << "Error: Number of bands cannot be higher than actual material bands" << endl;
         exit(1);
     }
 
@@ -211,7 +221,7 @@ Exciton::Exciton(const System& system, int ncell, int nbands, int nrmbands,
           Exciton(system, ncell, {}, parameters, Q, interactionType) {
     
     if (2*nbands > basisdim){
-        cout << "Error: Number of bands cannot be higher than actual material bands" << endl;
+        log() << "Error: Number of bands cannot be higher than actual material bands" << endl;
         exit(1);
     }
 
@@ -233,16 +243,17 @@ Exciton::~Exciton(){};
 /* ------------------------------ Setters ------------------------------ */
 
 /**
- * Sets the number of unit cells along each axis.
+ * Sets the number of unit cells along each axis, updating the total number of cells accordingly.
  * @param ncell Number of unit cells per axis.
  * @return void
  */
 void Exciton::setUnitCells(int ncell){
     if(ncell > 0){
         ncell_ = ncell;
+        totalCells_ = pow(ncell, ndim);
     }
     else{
-        std::cout << "ncell must be a positive number" << std::endl;
+        log() << "ncell must be a positive number" << std::endl;
     }
 }
 
@@ -279,7 +290,7 @@ void Exciton::setBands(int nbands, int nrmbands){
         this->bands_ = arma::join_rows(valenceBands, conductionBands);
     }
     else{
-        std::cout << "Included bands and removed bands must be positive numbers" << std::endl;
+        log() << "Included bands and removed bands must be positive numbers" << std::endl;
     }
 }
 
@@ -293,7 +304,7 @@ void Exciton::setQ(const arma::rowvec& Q){
         Q_ = Q;
     }
     else{
-        std::cout << "Q vector must be 3d" << std::endl;
+        log() << "Q vector must be 3d" << std::endl;
     }
     
 }
@@ -311,7 +322,7 @@ void Exciton::setParameters(const arma::rowvec& parameters){
         r0_    = parameters(2);
     }
     else{
-        std::cout << "parameters array must be 3d (eps_m, eps_s, r0)" << std::endl;
+        log() << "parameters array must be 3d (eps_m, eps_s, r0)" << std::endl;
     }
 }
 
@@ -339,11 +350,11 @@ void Exciton::setCutoff(double cutoff){
     if(cutoff > 0){
         cutoff_ = cutoff;
         if(cutoff > ncell){
-            std::cout << "Warning: cutoff is higher than number of unit cells" << std::endl;
+            log() << "Warning: cutoff is higher than number of unit cells" << std::endl;
         }
     }
     else{
-        std::cout << "cutoff must be a positive number" << std::endl;
+        log() << "cutoff must be a positive number" << std::endl;
     }
 }
 
@@ -402,6 +413,293 @@ void Exciton::setExchange(bool exchange){
     this->exchange = exchange;
 }
 
+/**
+ * Sets a callback to report the progress of the long stages of the calculation (bands,
+ * motif FT, BSE assembly and solver), which can also request its cancellation.
+ * @param callback Progress callback, see ProgressCallback.
+ * @return void
+ */
+void Exciton::setProgressCallback(ProgressCallback callback){
+    this->progressCallback_ = callback;
+}
+
+/**
+ * Sets the precision used to store and diagonalize the BSE matrix.
+ * @details In 'single' precision the matrix elements are computed in double precision but
+ * stored as single-precision complex, which halves the memory and roughly doubles the speed
+ * of the dense solver. The requested eigenpairs are then refined iteratively against the double
+ * precision operator, applied without storing it (see refineEigenpairs), and the kinetic matrix HK
+ * is not stored.
+ * @param precision Either 'double' (default) or 'single'.
+ * @return void
+ */
+void Exciton::setPrecision(const std::string& precision){
+    if(precision != "double" && precision != "single"){
+        throw std::invalid_argument("setPrecision(): precision must be either 'double' or 'single'");
+    }
+    this->precision_ = precision;
+}
+
+/**
+ * Enables the out-of-core storage of the BSE matrix, which is then written by tiles to a
+ * memory-mapped file and diagonalized with the matrix-free Davidson method.
+ * @details Intended for matrices that do not fit in memory; the kinetic matrix HK is not stored
+ * either, so the energy decomposition of Result is not available in this mode.
+ * @param directory Directory for the temporary file (preferably a local fast disk). If empty,
+ * the matrix is stored in memory.
+ * @param tileColumns Number of columns per tile. If zero, chosen automatically.
+ * @return void
+ */
+void Exciton::setOutOfCore(const std::string& directory, int tileColumns){
+    if(tileColumns < 0){
+        throw std::invalid_argument("setOutOfCore(): number of tile columns must be non-negative");
+    }
+    this->outOfCoreDirectory_ = directory;
+    this->tileColumns_ = tileColumns;
+}
+
+/**
+ * Enables the block-low-rank compression of the BSE matrix, which is then diagonalized with
+ * the matrix-free Davidson method.
+ * @details The electron-hole pairs are grouped in clusters of nearby k points; the interaction
+ * blocks between distant clusters are smooth in k - k' and are stored as low-rank factors
+ * computed directly from the matrix elements, without forming the dense matrix. The kinetic
+ * matrix HK is not stored, so the energy decomposition of Result is not available in this mode.
+ * @param tolerance Relative tolerance of the low-rank blocks. If zero, the matrix is stored dense.
+ * @return void
+ */
+void Exciton::setCompression(double tolerance){
+    if(tolerance < 0){
+        throw std::invalid_argument("setCompression(): tolerance must be non-negative");
+    }
+    this->compressionTolerance_ = tolerance;
+}
+
+/**
+ * Enables the interpolative separable density fitting (ISDF) of the pair densities in the
+ * real space mode.
+ * @details The atom-resolved pair densities of all k points and band pairs are interpolated
+ * from their values on a small set of atoms, so the interaction kernel is only needed between
+ * those atoms. Intended for models with many atoms in the motif, where the cost of each BSE
+ * element drops from natoms^2 to the square of the number of interpolation atoms.
+ * @param tolerance Relative tolerance of the pivoted Gram-Schmidt selection of the interpolation
+ * atoms. If zero, the exact kernel is used.
+ * @return void
+ */
+void Exciton::setDensityFitting(double tolerance){
+    if(tolerance < 0){
+        throw std::invalid_argument("setDensityFitting(): tolerance must be non-negative");
+    }
+    this->isdfTolerance_ = tolerance;
+}
+
+/**
+ * Restricts the BSE to the electron-hole pairs with transition energy below a cutoff.
+ * @details The pruned pairs are not included in the BSE, and their coefficients are set to zero
+ * in the eigenvectors returned by diagonalize(), so Result still works on the full basis.
+ * The kinetic and potential energies of Result are not available in this case.
+ * @param window Maximum transition energy (including the scissor) of the pairs kept. If zero,
+ * all pairs are used.
+ * @return void
+ */
+void Exciton::setEnergyWindow(double window){
+    if(window < 0){
+        throw std::invalid_argument("setEnergyWindow(): energy window must be non-negative");
+    }
+    this->energyWindow_ = window;
+}
+
+/**
+ * Splits the BSE in spin sectors, which are built and diagonalized separately.
+ * @details Only for models that conserve Sz (e.g. spinful models without spin-orbit coupling).
+ * The bands are then computed with definite spin, and the direct term only couples pairs with
+ * the same spins of electron and hole, while the exchange term only couples pairs where both
+ * have the same spin. This gives four independent blocks without exchange (three with it, since
+ * the up-up and down-down pairs are coupled), each solved on its own. The BSE is stored by
+ * blocks (HBSSectors), so HBS, HK and the energy decomposition of Result are not available.
+ * @param enable Whether to use the spin sectors.
+ * @return void
+ */
+void Exciton::setSpinSectors(bool enable){
+    if(enable && !conservesSpinZ()){
+        throw std::invalid_argument("setSpinSectors(): the model does not conserve Sz");
+    }
+    this->spinSectors_ = enable;
+}
+
+/**
+ * Builds and solves the BSE in real arithmetic.
+ * @details For Q = 0 and real Fock matrices (time reversal invariance), the states at -k are chosen
+ * as the complex conjugates of those at k, and real at the time-reversal invariant momenta. Then
+ * H(-p,-q) = H(p,q)*, with -p the pair with -k, and the BSE is real symmetric in the basis
+ * (|p> + |-p>)/sqrt(2), i(|p> - |-p>)/sqrt(2). It is assembled directly in that basis (HBSreal)
+ * and solved with real LAPACK routines, and the eigenvectors are transformed back to the pair basis.
+ * HBS, HK and the energy decomposition of Result are not available. Must be set before initializeHamiltonian.
+ * @param enable Whether to use real arithmetic.
+ * @return void
+ */
+void Exciton::setRealArithmetic(bool enable){
+    if(enable && !hasRealMatrices()){
+        throw std::invalid_argument("setRealArithmetic(): the Fock and overlap matrices must be real");
+    }
+    this->realArithmetic_ = enable;
+}
+
+/**
+ * Solves the full BSE, including the coupling between excitations and deexcitations, instead
+ * of the Tamm-Dancoff approximation.
+ * @details Requires Q = 0 and the dense solver ('diag'). The coupling block B is built together
+ * with the resonant one, and the full problem [[A, B], [-B*, -A*]] is solved with a structure-
+ * preserving method that only returns the positive excitation energies: when A and B are real
+ * (always with real arithmetic) the product form reduces it to a symmetric problem of the size
+ * of A; otherwise the product form is applied to its real representation, a symmetric problem of
+ * twice the size. The resonant part of the states is returned by diagonalize() and the
+ * antiresonant one is stored in antiresonantStates. Must be set after Q and the storage modes.
+ * @param enable Whether to solve the full BSE.
+ * @return void
+ */
+void Exciton::setFullBSE(bool enable){
+    if(enable && arma::norm(Q) != 0){
+        throw std::invalid_argument("setFullBSE(): full BSE is only implemented for Q = 0");
+    }
+    if(enable && (!outOfCoreDirectory_.empty() || compressionTolerance_ > 0 || precision_ == "single" || spinSectors_)){
+        throw std::invalid_argument("setFullBSE(): full BSE requires in-core, uncompressed and double precision storage without spin sectors");
+    }
+    this->fullBSE_ = enable;
+}
+
+/**
+ * Copies the calculation settings of another exciton: truncation, gauge, mode, exchange, scissor,
+ * storage and solver modes, energy window, verbosity and progress callback.
+ * @details The system, bands, Q, potential parameters, mesh and results are not copied. Used
+ * to derive the excitons of other Q from a reference one, so the settings that require Q = 0
+ * (real arithmetic and full BSE) are rejected if this exciton has finite Q.
+ * @param other Exciton whose settings are copied.
+ * @return void
+ */
+void Exciton::copySettings(const Exciton& other){
+    if(arma::norm(Q) != 0 && (other.realArithmetic_ || other.fullBSE_)){
+        throw std::invalid_argument("copySettings(): real arithmetic and full BSE require Q = 0");
+    }
+    this->cutoff_ = other.cutoff_;
+    this->gauge_ = other.gauge_;
+    this->mode_ = other.mode_;
+    this->exchange = other.exchange;
+    this->scissor_ = other.scissor_;
+    this->nReciprocalVectors_ = other.nReciprocalVectors_;
+    this->energyWindow_ = other.energyWindow_;
+    this->isdfTolerance_ = other.isdfTolerance_;
+    this->precision_ = other.precision_;
+    this->outOfCoreDirectory_ = other.outOfCoreDirectory_;
+    this->tileColumns_ = other.tileColumns_;
+    this->compressionTolerance_ = other.compressionTolerance_;
+    this->spinSectors_ = other.spinSectors_;
+    this->realArithmetic_ = other.realArithmetic_;
+    this->fullBSE_ = other.fullBSE_;
+    this->progressCallback_ = other.progressCallback_;
+    setSilent(other.silent_);
+}
+
+/**
+ * Requests the cancellation of the running (or next) stage of the calculation. 
+ * @details Safe to call from another thread. The stage stops as soon as the
+ * iterations in course finish, throwing a CancelledError.
+ * @return void
+ */
+void Exciton::cancel(){
+    this->cancelled_ = true;
+}
+
+/**
+ * Moves an array out of the exciton, leaving it empty, and returns the ownership of its memory
+ * (see Crystal::releaseArray).
+ * @details The band stacks and the basis are recomputed by initializeHamiltonian(), and HBS and
+ * HK by BShamiltonian().
+ * @param name Name of the array: 'eigvalKStack', 'eigvalKQStack', 'eigvecKStack', 'eigvecKQStack',
+ * 'HBS', 'HK', 'basisStates' or 'kpoints'.
+ * @return Array holding the original memory.
+ */
+std::shared_ptr<void> Exciton::releaseArray(const std::string& name){
+    if (name == "eigvalKStack"){
+        return std::make_shared<arma::mat>(std::move(eigvalKStack_));
+    }
+    else if (name == "eigvalKQStack"){
+        return std::make_shared<arma::mat>(std::move(eigvalKQStack_));
+    }
+    else if (name == "eigvecKStack"){
+        return std::make_shared<arma::cx_cube>(std::move(eigvecKStack_));
+    }
+    else if (name == "eigvecKQStack"){
+        return std::make_shared<arma::cx_cube>(std::move(eigvecKQStack_));
+    }
+    else if (name == "HBS"){
+        return std::make_shared<arma::cx_mat>(std::move(HBS_));
+    }
+    else if (name == "HK"){
+        return std::make_shared<arma::mat>(std::move(HK_));
+    }
+    else if (name == "basisStates"){
+        return std::make_shared<arma::imat>(std::move(basisStates_));
+    }
+    return System::releaseArray(name);
+}
+
+/**
+ * Returns whether the cancellation of the calculation has been requested.
+ * @return True if cancelled.
+ */
+bool Exciton::isCancelled() const {
+    return this->cancelled_;
+}
+
+/**
+ * Reports the progress of a stage to the progress callback, if any.
+ * @details Calls are serialized, so the callback does not need to be thread-safe. An exception
+ * thrown by the callback cannot leave a parallel region: it cancels the calculation and is
+ * rethrown by the next checkCancelled, which every stage calls outside its parallel regions.
+ * @param stage Name of the stage.
+ * @param fraction Completed fraction of the stage.
+ * @return False if the calculation has been cancelled.
+ */
+bool Exciton::reportProgress(const std::string& stage, double fraction){
+    if (progressCallback_){
+        bool proceed = true;
+        #pragma omp critical(excitonProgressCallback)
+        {
+            try{
+                proceed = progressCallback_(stage, fraction);
+            }
+            catch(...){
+                if (!callbackError_){
+                    callbackError_ = std::current_exception();
+                }
+                proceed = false;
+            }
+        }
+        if (!proceed){
+            cancelled_ = true;
+        }
+    }
+    return !cancelled_;
+}
+
+/**
+ * Throws a CancelledError if the cancellation has been requested, resetting the
+ * request so that the object can be used again.
+ * @param stage Name of the stage being cancelled.
+ * @return void
+ */
+void Exciton::checkCancelled(const std::string& stage){
+    if (cancelled_.exchange(false)){
+        if (callbackError_){
+            std::exception_ptr error = callbackError_;
+            callbackError_ = nullptr;
+            std::rethrow_exception(error);
+        }
+        throw CancelledError(stage);
+    }
+}
+
 
 /*------------------------------------ Interaction matrix elements ------------------------------------*/
 
@@ -409,6 +707,8 @@ void Exciton::setExchange(bool exchange){
  * Real space implementation of interaction term, valid for both direct and exchange.
  * To compute the direct term, the expected order is (ck,v'k',c'k',vk).
  * For the exchange term, the order is (ck,v'k',vk,c'k').
+ * @details The pair densities are reduced per atom and contracted with the motif FT by the
+ * kernel selected in initializeMotifKernel().
  * @param coefsK1 First eigenstate vector.
  * @param coefsK2 Second eigenstate vector.
  * @param coefsK3 Third eigenstate vector.
@@ -416,22 +716,103 @@ void Exciton::setExchange(bool exchange){
  * @param motifFT Motif Fourier transform.
  * @return Interaction term.
  */
-std::complex<double> Exciton::exactInteractionTermMFT(const arma::cx_vec& coefsK1, 
-                                     const arma::cx_vec& coefsK2,
-                                     const arma::cx_vec& coefsK3, 
-                                     const arma::cx_vec& coefsK4,
-                                     const arma::cx_mat& motifFT){
+std::complex<double> Exciton::exactInteractionTermMFT(const std::complex<double>* coefsK1, 
+                                     const std::complex<double>* coefsK2,
+                                     const std::complex<double>* coefsK3, 
+                                     const std::complex<double>* coefsK4,
+                                     const arma::cx_mat& motifFT) const {
     
-    arma::cx_vec firstCoefArray = arma::conj(coefsK1) % coefsK3;
-    arma::cx_vec secondCoefArray = arma::conj(coefsK2) % coefsK4;
-    std::complex<double> term = arma::dot(firstCoefArray, extendMotifFT(motifFT, this->basisdim,
-                                                                        this->motif, this->orbitals) * secondCoefArray);
-        
-    return term;
+    return motifKernel_(coefsK1, coefsK2, coefsK3, coefsK4, motifFT, orbitalAtom_);
+};
+
+/**
+ * Density-fitted version of exactInteractionTermMFT. Only the pair densities on the ISDF
+ * interpolation atoms are computed, and contracted with the projected kernel.
+ * @param coefsK1 First eigenstate vector.
+ * @param coefsK2 Second eigenstate vector.
+ * @param coefsK3 Third eigenstate vector.
+ * @param coefsK4 Fourth eigenstate vector.
+ * @param kernel Kernel between interpolation atoms.
+ * @return Interaction term.
+ */
+std::complex<double> Exciton::isdfInteractionTerm(const std::complex<double>* coefsK1,
+                                                  const std::complex<double>* coefsK2,
+                                                  const std::complex<double>* coefsK3,
+                                                  const std::complex<double>* coefsK4,
+                                                  const arma::cx_mat& kernel) const {
+
+    arma::cx_vec firstDensity = arma::zeros<arma::cx_vec>(kernel.n_rows);
+    arma::cx_vec secondDensity = arma::zeros<arma::cx_vec>(kernel.n_rows);
+    for(arma::uword o = 0; o < isdfOrbitals_.n_elem; o++){
+        arma::uword alpha = isdfOrbitals_(o);
+        firstDensity(isdfOrbitalPoint_(o)) += std::conj(coefsK1[alpha])*coefsK3[alpha];
+        secondDensity(isdfOrbitalPoint_(o)) += std::conj(coefsK2[alpha])*coefsK4[alpha];
+    }
+
+    return arma::dot(firstDensity, kernel*secondDensity);
 };
 
+/**
+ * Fourier transform of the interaction potential (Keldysh or Coulomb).
+ * @param q Momentum.
+ * @return Potential evaluated at q.
+ */
+double Exciton::potentialFT(const arma::rowvec& q) const {
+    double regularization = arma::norm(reciprocalLattice.row(0)) / totalCells;
+    if (this->interactionType == "keldysh") {
+        return keldyshFT(q, r0, eps_s, eps_m, unitCellArea, totalCells, regularization);
+    }
+    return coulombFT(q, eps_r, unitCellArea, totalCells, regularization);
+}
+
+/**
+ * Computes the phases exp(iq·t) of each orbital, with t the position of its atom.
+ * @param q Momentum.
+ * @return Vector with the phase of each orbital.
+ */
+arma::cx_vec Exciton::orbitalPhases(const arma::rowvec& q) const {
+    arma::vec argument = orbitalPositions_*q.t();
+    return arma::cx_vec(arma::cos(argument), arma::sin(argument));
+}
+
+/**
+ * Returns the potential V(k - k' + G) for all the reciprocal vectors G of the kernel.
+ * @details Taken from the table computed in initializeReciprocalKernel() if the kpoints
+ * lie on a regular mesh, otherwise evaluated.
+ * @param k_index Index of k.
+ * @param k2_index Index of k'.
+ * @return Vector with the potential for each reciprocal vector.
+ */
+arma::vec Exciton::reciprocalPotential(int k_index, int k2_index) const {
+    if (!potentialTable_.is_empty()){
+        arma::irowvec delta = meshCoordinates_.row(k_index) - meshCoordinates_.row(k2_index) + meshSpan_;
+        return potentialTable_.col(arma::accu(delta % meshStrides_));
+    }
+    arma::rowvec q = kpoints.row(k_index) - kpoints.row(k2_index);
+    arma::vec potential(reciprocalVectors_.n_rows);
+    for(arma::uword g = 0; g < reciprocalVectors_.n_rows; g++){
+        potential(g) = potentialFT(q + reciprocalVectors_.row(g));
+    }
+    return potential;
+}
+
+/**
+ * Calculation of the Bloch coherence factors for all the reciprocal vectors of the kernel,
+ * I(G) = sum_a conj(coefs1_a) coefs2_a exp(i(k - k' + G)·t_a).
+ * @param coefs1 Vector of eigenstate |n,k>.
+ * @param coefs2 Vector of eigenstate |n',k'>.
+ * @param phases Phases exp(i(k - k')·t) of each orbital.
+ * @return Vector with the coherence factor for each reciprocal vector.
+ */
+arma::cx_vec Exciton::formFactors(const arma::cx_vec& coefs1, const arma::cx_vec& coefs2,
+                                  const arma::cx_vec& phases) const {
+    return orbitalPhasesG_.st()*(arma::conj(coefs1) % coefs2 % phases);
+}
+
 /**
  * Reciprocal space implementation of interaction term, valid for both direct and exchange.
+ * @details Evaluates the phases and the potential; in the construction of the BSE the
+ * tabulated ones are used instead (see the overload below).
  * @param coefsK Vector of eigenstate |v,k>.
  * @param coefsK2 Vector of eigenstate |v',k'>.
  * @param coefsKQ Vector of eigenstate |c,k+Q>.
@@ -449,62 +830,40 @@ std::complex<double> Exciton::interactionTermFT(const arma::cx_vec& coefsK,
                                      const arma::rowvec& k, 
                                      const arma::rowvec& k2,
                                      const arma::rowvec& kQ, 
-                                     const arma::rowvec& k2Q,
-                                     int nrcells){
+                                     const arma::rowvec& k2Q) const {
     
-    std::complex<double> Ic, Iv;
-    std::complex<double> term = 0;
-    double radius = cutoff * arma::norm(reciprocalLattice.row(0));
-    arma::mat reciprocalVectors = truncateReciprocalSupercell(nrcells, radius);
-
-    for(int i = 0; i < reciprocalVectors.n_rows; i++){
-        auto G = reciprocalVectors.row(i);
-
-        Ic = blochCoherenceFactor(coefsKQ, coefsK2Q, kQ, k2Q, G);
-        Iv = blochCoherenceFactor(coefsK, coefsK2, k, k2, G);
-
-        if (this->interactionType == "keldysh") {
-            // if Keldysh interaction
-            term += Ic * conj(Iv) * keldyshFT(k - k2 + G, r0, eps_s, eps_m, unitCellArea, totalCells,
-                                              arma::norm(reciprocalLattice.row(0)) / totalCells);
-        } else {
-            // if Coulomb interaction
-            term += Ic * conj(Iv) * coulombFT(k - k2 + G, eps_r, unitCellArea, totalCells,
-                                              arma::norm(reciprocalLattice.row(0)) / totalCells);
-        }
+    arma::vec potential(reciprocalVectors_.n_rows);
+    for(arma::uword g = 0; g < reciprocalVectors_.n_rows; g++){
+        potential(g) = potentialFT(k - k2 + reciprocalVectors_.row(g));
     }
+    arma::cx_vec Ic = formFactors(coefsKQ, coefsK2Q, orbitalPhases(kQ - k2Q));
+    arma::cx_vec Iv = formFactors(coefsK, coefsK2, orbitalPhases(k - k2));
 
-    return term;
+    return arma::cdot(Iv, Ic % potential);
 };
 
 /**
- * Calculation of Bloch coherence factors, required to compute the interaction terms in reciprocal space.
- * @param coefs1 Vector of eigenstate |n,k>.
- * @param coefs2 Vector of eigenstate |n',k'>.
- * @param k1 kpoint k.
- * @param k2 kpoint k'.
- * @param G Reciprocal lattice vector used to compute the coherence factor.
- * @return Bloch coherence factor I evaluated at G for states |nk>, |n'k'>.
+ * Reciprocal space implementation of interaction term with tabulated phases and potential,
+ * sum_G I_c(G) conj(I_v(G)) V(G).
+ * @param coefsK Vector of eigenstate |v,k>.
+ * @param coefsK2 Vector of eigenstate |v',k'>.
+ * @param coefsKQ Vector of eigenstate |c,k+Q>.
+ * @param coefsK2Q Vector of eigenstate |c',k'+Q>.
+ * @param phases Phases exp(i(k - k')·t) of each orbital.
+ * @param potential Potential V(k - k' + G) for each reciprocal vector.
+ * @return Interaction term.
  */
-std::complex<double> Exciton::blochCoherenceFactor(const arma::cx_vec& coefs1, const arma::cx_vec& coefs2,
-                                                    const arma::rowvec& k1, const arma::rowvec& k2,
-                                                    const arma::rowvec& G){
-
-    std::complex<double> imag(0, 1);
-    arma::cx_vec coefs = arma::conj(coefs1) % coefs2;
-    arma::cx_vec phases = arma::ones<arma::cx_vec>(basisdim);
-    int current_phase_pos = 0;
-    for(int i = 0; i < natoms; i++){
-        int species = motif.row(i)(3);
-        arma::rowvec atomPosition = motif.row(i).subvec(0, 2);
-        phases.subvec(current_phase_pos, current_phase_pos + orbitals(species) - 1) *=
-        exp(imag*arma::dot(k1 - k2 + G, atomPosition));
-        current_phase_pos += orbitals(species);
-    }
+std::complex<double> Exciton::interactionTermFT(const arma::cx_vec& coefsK, 
+                                     const arma::cx_vec& coefsK2,
+                                     const arma::cx_vec& coefsKQ, 
+                                     const arma::cx_vec& coefsK2Q,
+                                     const arma::cx_vec& phases,
+                                     const arma::vec& potential) const {
 
-    std::complex<double> factor = arma::dot(coefs, phases);
+    arma::cx_vec Ic = formFactors(coefsKQ, coefsK2Q, phases);
+    arma::cx_vec Iv = formFactors(coefsK, coefsK2, phases);
 
-    return factor;
+    return arma::cdot(Iv, Ic % potential);
 }
 
 
@@ -589,6 +948,98 @@ arma::imat Exciton::specifyBasisSubset(const arma::ivec& bands){
 }
 
 
+/**
+ * Method to select the electron-hole pairs of a basis whose transition energy
+ * scissor + e_c(k+Q) - e_v(k) is below a cutoff. Requires the band stacks to be initialized.
+ * @param basis Electron-hole pair basis, e.g. from createBasis or specifyBasisSubset.
+ * @param window Maximum transition energy of the pairs kept.
+ * @return Matrix with the states of the basis within the energy window.
+ */
+arma::imat Exciton::restrictToEnergyWindow(const arma::imat& basis, double window) const {
+    return basis.rows(pairsWithinEnergyWindow(basis, window));
+}
+
+/**
+ * Returns the indices of the pairs of a basis with transition energy below a cutoff.
+ * @param basis Electron-hole pair basis.
+ * @param window Maximum transition energy of the pairs kept.
+ * @return Row indices of the pairs within the energy window.
+ */
+arma::uvec Exciton::pairsWithinEnergyWindow(const arma::imat& basis, double window) const {
+    if(eigvalKStack.is_empty()){
+        throw std::logic_error("restrictToEnergyWindow(): band stacks must be initialized first");
+    }
+    std::vector<arma::uword> kept;
+    for(arma::uword i = 0; i < basis.n_rows; i++){
+        int k_index = basis(i, 2);
+        int v = bandToIndex.at(basis(i, 0));
+        int c = bandToIndex.at(basis(i, 1));
+        double energy = scissor + eigvalKQStack(c, k_index) - eigvalKStack(v, k_index);
+        if(energy <= window){
+            kept.push_back(i);
+        }
+    }
+
+    return arma::uvec(kept);
+}
+
+/**
+ * Groups the electron-hole pairs of a basis in spin sectors, according to the Sz of the valence
+ * band at k and of the conduction band at k+Q (see setSpinSectors).
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @return Indices of the pairs of each (non-empty) sector.
+ */
+std::vector<arma::uvec> Exciton::spinSectorPairs(const arma::imat& basis) const {
+    // Sectors (up, up), (up, down), (down, up), (down, down) of (hole, electron); with
+    // exchange, (up, up) and (down, down) are coupled and form a single sector
+    arma::uvec labels(basis.n_rows);
+    for(arma::uword i = 0; i < basis.n_rows; i++){
+        int k_index = basis(i, 2);
+        int v = bandToIndex.at(basis(i, 0));
+        int c = bandToIndex.at(basis(i, 1));
+        int label = 2*(spinKStack_(v, k_index) < 0) + (spinKQStack_(c, k_index) < 0);
+        labels(i) = (exchange && label == 3) ? 0 : label;
+    }
+
+    std::vector<arma::uvec> sectors;
+    for(arma::uword label = 0; label < 4; label++){
+        arma::uvec pairs = arma::find(labels == label);
+        if(!pairs.is_empty()){
+            sectors.push_back(pairs);
+        }
+    }
+    return sectors;
+}
+
+/**
+ * Finds the time-reversed partner {v, c, -k} of each electron-hole pair of a basis.
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @return Index of the partner of each pair.
+ */
+arma::uvec Exciton::timeReversedPairs(const arma::imat& basis) const {
+    if(timeReversedK_.n_elem != (arma::uword)nk){
+        throw std::logic_error("Real arithmetic must be enabled before initializing the Hamiltonian");
+    }
+    long int nTotalBands = bandList.n_elem;
+    auto pairKey = [&](arma::uword i, long int k_index){
+        return (k_index*nTotalBands + bandToIndex.at(basis(i, 0)))*nTotalBands + bandToIndex.at(basis(i, 1));
+    };
+
+    std::vector<long int> pairIndex(nk*nTotalBands*nTotalBands, -1);
+    for(arma::uword i = 0; i < basis.n_rows; i++){
+        pairIndex[pairKey(i, basis(i, 2))] = i;
+    }
+    arma::uvec partners(basis.n_rows);
+    for(arma::uword i = 0; i < basis.n_rows; i++){
+        long int j = pairIndex[pairKey(i, timeReversedK_(basis(i, 2)))];
+        if(j < 0){
+            throw std::invalid_argument("Real arithmetic requires a basis closed under k -> -k");
+        }
+        partners(i) = j;
+    }
+    return partners;
+}
+
 /**
  * Compute the basis elements for the spinful exciton problem. Reorders basis
  * in blocks of defined spin (so that they are diagonal for later calculation of eigenstates of BSE).
@@ -621,22 +1072,8 @@ void Exciton::useSpinfulBasis(){
  * @param k kpoint required to perform the transformation.
  * @return Atomic gauge state coefficients.
  */
-arma::cx_vec Exciton::latticeToAtomicGauge(const arma::cx_vec& coefs, const arma::rowvec& k){
-
-    arma::cx_vec phases(basisdim);
-    std::complex<double> imag(0, 1);
-    int it = 0;
-    for(int atomIndex = 0; atomIndex < natoms; atomIndex++){
-        int species = motif.row(atomIndex)(3);
-        for(int orbIndex = 0; orbIndex < orbitals(species); orbIndex++){
-            arma::rowvec atomPosition = motif.row(atomIndex).subvec(0, 2);
-            phases(it) = exp(-imag*arma::dot(k, atomPosition));
-            it++;
-        }
-    }
-
-    arma::cx_vec atomicCoefs = coefs % phases;
-    return atomicCoefs;
+arma::cx_vec Exciton::latticeToAtomicGauge(const arma::cx_vec& coefs, const arma::rowvec& k) const {
+    return coefs % orbitalPhases(-k);
 }
 
 /**
@@ -645,22 +1082,8 @@ arma::cx_vec Exciton::latticeToAtomicGauge(const arma::cx_vec& coefs, const arma
  * @param k kpoint used in the transformation.
  * @return Lattice gauge coefficients.
  */
-arma::cx_vec Exciton::atomicToLatticeGauge(const arma::cx_vec& coefs, const arma::rowvec& k){
-
-    arma::cx_vec phases(basisdim);
-    std::complex<double> imag(0, 1);
-    int it = 0;
-    for(int atomIndex = 0; atomIndex < natoms; atomIndex++){
-        int species = motif.row(atomIndex)(3);
-        for(int orbIndex = 0; orbIndex < orbitals(species); orbIndex++){
-            arma::rowvec atomPosition = motif.row(atomIndex).subvec(0, 2);
-            phases(it) = exp(-imag*arma::dot(k, atomPosition));
-            it++;
-        }
-    }
-
-    arma::cx_vec atomicCoefs = coefs % phases;
-    return atomicCoefs;
+arma::cx_vec Exciton::atomicToLatticeGauge(const arma::cx_vec& coefs, const arma::rowvec& k) const {
+    return coefs % orbitalPhases(k);
 }
 
 /**
@@ -668,7 +1091,7 @@ arma::cx_vec Exciton::atomicToLatticeGauge(const arma::cx_vec& coefs, const arma
  * @details The prescription we take here is to impose that the sum of all the coefficients is real.
  * @return Fixed coefficients. 
  */
-arma::cx_mat Exciton::fixGlobalPhase(arma::cx_mat& coefs){
+arma::cx_mat Exciton::fixGlobalPhase(arma::cx_mat& coefs) const {
 
     arma::cx_rowvec sums = arma::sum(coefs);
     std::complex<double> imag(0, 1);
@@ -700,7 +1123,7 @@ void Exciton::generateBandDictionary(){
  * @param cells Matrix of unit cells over which the motif FT is computed.
  * @return void
  */
-arma::cx_mat Exciton::motifFTMatrix(const arma::rowvec& k, const arma::mat& cells){
+arma::cx_mat Exciton::motifFTMatrix(const arma::rowvec& k, const arma::mat& cells) const {
     // Uses hermiticity of V
     arma::cx_mat motifFT = arma::zeros<arma::cx_mat>(natoms, natoms);
 
@@ -745,104 +1168,1105 @@ void Exciton::initializeMotifFT(int i, const arma::mat& cells){
  * @return void
  */ 
 void Exciton::initializeResultsH0(bool triangular){
+    initializeBandStacks(triangular);
+    initializeMotifFTStack();
+}
 
-    int nTotalBands = bandList.n_elem;
-    double radius = arma::norm(bravaisLattice.row(0)) * cutoff_;
-    arma::mat cells = truncateSupercell(ncell, radius);
+/**
+ * Method to diagonalize the Bloch Hamiltonian at all k (and k+Q) points, storing the energies
+ * and eigenstates of the bands that form the exciton.
+ * @param triangular Boolean to specify whether the Hamiltonian matrices are triangular.
+ * @return void
+ */
+void Exciton::initializeBandStacks(bool triangular){
 
-    this->eigvecKStack_  = arma::cx_cube(basisdim, nTotalBands, nk);
-    this->eigvecKQStack_ = arma::cx_cube(basisdim, nTotalBands, nk);
-    this->eigvalKStack_  = arma::mat(nTotalBands, nk);
-    this->eigvalKQStack_ = arma::mat(nTotalBands, nk);
-    this->ftMotifStack   = arma::cx_cube(natoms, natoms, meshBZ_.n_rows);
-    this->ftMotifQ       = arma::cx_mat(natoms, natoms);
+    int nTotalBands = bandList.n_elem;
 
-    vec auxEigVal(basisdim);
-    cx_mat auxEigvec(basisdim, basisdim);
-    cx_mat h;
+    // Stacks are allocated uninitialized and first-touched in parallel, so their pages
+    // are spread over the NUMA nodes of the threads that fill and later read them
+    int nthreads = stageThreads("bands");
+    this->eigvecKStack_  = arma::cx_cube(basisdim, nTotalBands, nk, arma::fill::none);
+    this->eigvecKQStack_ = arma::cx_cube(basisdim, nTotalBands, nk, arma::fill::none);
+    this->eigvalKStack_  = arma::mat(nTotalBands, nk, arma::fill::none);
+    this->eigvalKQStack_ = arma::mat(nTotalBands, nk, arma::fill::none);
+    firstTouch(eigvecKStack_, nthreads);
+    firstTouch(eigvecKQStack_, nthreads);
+    firstTouch(eigvalKStack_, 1, nthreads);
+    firstTouch(eigvalKQStack_, 1, nthreads);
+    if (spinSectors_){
+        this->spinKStack_  = arma::mat(nTotalBands, nk);
+        this->spinKQStack_ = arma::mat(nTotalBands, nk);
+    }
+    else{
+        spinKStack_.reset();
+        spinKQStack_.reset();
+    }
 
-    // Progress bar variables
-    int step = 1;
-	int displayNext = step;
-	int percent = 0;
+    // Each iteration runs its own diagonalization, so BLAS must not spawn more threads
+    BLASThreadGuard blasThreads(1);
 
-    calculateInverseReciprocalMatrix();
-    std::complex<double> imag(0, 1);
+    // If every k+Q is a point of the mesh, its bands are looked up instead of recomputed
+    arma::uvec kQIndices = commensurateKQIndices();
+    bool commensurate = !kQIndices.is_empty();
 
-    std::cout << "Diagonalizing H0 for all k points... " << std::flush;
+    int completed = 0;
+    log() << "Diagonalizing H0 for all k points... " << std::flush;
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
     for (int i = 0; i < nk; i++){
-        arma::rowvec k = kpoints.row(i);
-        solveBands(k, auxEigVal, auxEigvec, triangular);
-
-        auxEigvec = fixGlobalPhase(auxEigvec);
-        eigvalKStack_.col(i) = auxEigVal(bandList);
-        eigvecKStack_.slice(i) = auxEigvec.cols(bandList);
-
-        if(arma::norm(Q) != 0){
-            arma::rowvec kQ = kpoints.row(i) + Q;
-            solveBands(kQ, auxEigVal, auxEigvec, triangular);
+        // OpenMP loops cannot be exited, so once cancelled the remaining iterations are skipped
+        if (cancelled_){
+            continue;
+        }
+        initializeBands(i, triangular, !commensurate);
 
-            auxEigvec = fixGlobalPhase(auxEigvec);
-            eigvalKQStack_.col(i) = auxEigVal(bandList);
-            eigvecKQStack_.slice(i) = auxEigvec.cols(bandList);
+        int done;
+        #pragma omp atomic capture
+        done = ++completed;
+        if ((100*done)/nk != (100*(done - 1))/nk){
+            reportProgress("bands", (double)done/nk);
         }
-        else{
-            eigvecKQStack_.slice(i) = eigvecKStack.slice(i);
-            eigvalKQStack_.col(i) = eigvalKStack.col(i);
-        };
-        
     };
-    std::cout << "Done" << std::endl;
-
-    if(this->mode == "realspace"){
-        std::cout << "Computing lattice Fourier transform..." << std::endl;
-        for (unsigned int i = 0; i < meshBZ_.n_rows; i++){
-            // BIGGEST BOTTLENECK OF THE CODE
-            initializeMotifFT(i, cells);     
+    checkCancelled("bands");
+    log() << "Done" << std::endl;
 
-		    percent = (100 * (i + 1)) / meshBZ_.n_rows ;
-		    if (percent >= displayNext){
-                cout << "\r" << "[" << std::string(percent / 5, '|') << std::string(100 / 5 - percent / 5, ' ') << "]";
-                cout << percent << "%";
-                std::cout.flush();
-                displayNext += step;
-            }
-        }
-        std::cout << "\nDone" << std::endl;
+    if(commensurate){
+        log() << "Q is commensurate with the mesh, reusing bands at k for k+Q" << std::endl;
+        copyBandsKQ(kQIndices, nthreads);
     }
-
-    if(this->exchange){
-        this->ftMotifQ = motifFTMatrix(this->Q, cells);
+    timeReversedK_.reset();
+    if(realArithmetic_){
+        enforceTimeReversalGauge(triangular);
     }
-};
+}
 
 /**
- * Routine to initialize the required variables to construct the Bethe-Salpeter Hamiltonian.
- * @param triangular Boolean to specify whether the single-particle Hamiltonian matrices are triangular.
- * @return void.
+ * Method to diagonalize the Bloch Hamiltonian at one k point (and k+Q), storing the energies
+ * and eigenstates of the bands that form the exciton in the stacks.
+ * @param i Index of the k point.
+ * @param triangular Boolean to specify whether the Hamiltonian matrices are triangular.
+ * @param computeKQ Boolean to specify whether the bands at k+Q are also computed (default = true).
+ * @return void
  */
-void Exciton::initializeHamiltonian(bool triangular){
-
-    if(bands.empty()){
-        throw std::invalid_argument("Error: Exciton object must have some bands");
+void Exciton::initializeBands(int i, bool triangular, bool computeKQ){
+    arma::vec auxEigVal(basisdim);
+    arma::cx_mat auxEigvec(basisdim, basisdim);
+
+    arma::rowvec k = kpoints.row(i);
+    if (spinSectors_){
+        arma::vec auxSpin;
+        solveBandsSpinZ(k, auxEigVal, auxEigvec, auxSpin, triangular);
+        spinKStack_.col(i) = auxSpin(bandList);
     }
-    if(nk == 0){
-        throw std::invalid_argument("Error: BZ mesh must be initialized first");
+    else{
+        solveBands(k, auxEigVal, auxEigvec, triangular);
     }
 
-    this->excitonbasisdim_ = nk*valenceBands.n_elem*conductionBands.n_elem;
-
-    std::cout << "Initializing basis for BSE... " << std::flush;
-    initializeBasis();
-    //useSpinfulBasis();
-    generateBandDictionary();
+    auxEigvec = fixGlobalPhase(auxEigvec);
+    eigvalKStack_.col(i) = auxEigVal(bandList);
+    eigvecKStack_.slice(i) = auxEigvec.cols(bandList);
 
-    initializeResultsH0(triangular);
+    if(computeKQ){
+        initializeBandsKQ(i, triangular);
+    }
 }
 
-
 /**
- * Initialize BSE hamiltonian matrix and kinetic matrix.
+ * Computes the bands at k+Q for one k point of the mesh. For Q = 0 they are copied from
+ * the bands at k, which must be computed first.
+ * @param i Index of the k point.
+ * @param triangular Boolean to specify whether the Hamiltonian matrices are triangular.
+ * @return void
+ */
+void Exciton::initializeBandsKQ(int i, bool triangular){
+    if(arma::norm(Q) != 0){
+        arma::vec auxEigVal(basisdim);
+        arma::cx_mat auxEigvec(basisdim, basisdim);
+
+        arma::rowvec kQ = kpoints.row(i) + Q;
+        if (spinSectors_){
+            arma::vec auxSpin;
+            solveBandsSpinZ(kQ, auxEigVal, auxEigvec, auxSpin, triangular);
+            spinKQStack_.col(i) = auxSpin(bandList);
+        }
+        else{
+            solveBands(kQ, auxEigVal, auxEigvec, triangular);
+        }
+
+        auxEigvec = fixGlobalPhase(auxEigvec);
+        eigvalKQStack_.col(i) = auxEigVal(bandList);
+        eigvecKQStack_.slice(i) = auxEigvec.cols(bandList);
+    }
+    else{
+        eigvecKQStack_.slice(i) = eigvecKStack.slice(i);
+        eigvalKQStack_.col(i) = eigvalKStack.col(i);
+        if (spinSectors_){
+            spinKQStack_.col(i) = spinKStack_.col(i);
+        }
+    };
+}
+
+/**
+ * Method to diagonalize the Bloch Hamiltonian only at the k+Q points, when the bands at k
+ * are already stored (e.g. reused from an exciton with different Q).
+ * @param triangular Boolean to specify whether the Hamiltonian matrices are triangular.
+ * @return void
+ */
+void Exciton::initializeBandStacksKQ(bool triangular){
+
+    int nTotalBands = bandList.n_elem;
+    int nthreads = stageThreads("bands");
+    this->eigvecKQStack_ = arma::cx_cube(basisdim, nTotalBands, nk, arma::fill::none);
+    this->eigvalKQStack_ = arma::mat(nTotalBands, nk, arma::fill::none);
+    firstTouch(eigvecKQStack_, nthreads);
+    firstTouch(eigvalKQStack_, 1, nthreads);
+    spinKQStack_.reset();
+    if (spinSectors_){
+        this->spinKQStack_ = arma::mat(nTotalBands, nk);
+    }
+
+    arma::uvec kQIndices = commensurateKQIndices();
+    if(!kQIndices.is_empty()){
+        log() << "Q is commensurate with the mesh, reusing bands at k for k+Q" << std::endl;
+        copyBandsKQ(kQIndices, nthreads);
+        return;
+    }
+    BLASThreadGuard blasThreads(1);
+
+    int completed = 0;
+    log() << "Diagonalizing H0 for all k+Q points... " << std::flush;
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int i = 0; i < nk; i++){
+        if (cancelled_){
+            continue;
+        }
+        initializeBandsKQ(i, triangular);
+
+        int done;
+        #pragma omp atomic capture
+        done = ++completed;
+        if ((100*done)/nk != (100*(done - 1))/nk){
+            reportProgress("bands", (double)done/nk);
+        }
+    };
+    checkCancelled("bands");
+    log() << "Done" << std::endl;
+}
+
+/**
+ * Determines whether the center-of-mass momentum is commensurate with the mesh, i.e. whether
+ * every k+Q equals some point k' of the mesh up to a reciprocal lattice vector G.
+ * @details The Bloch Hamiltonian is built in the lattice gauge, H(k) = sum_R H(R)exp(ikR),
+ * which is periodic in reciprocal space, H(k+G) = H(k). The eigenstates at k+Q are then exactly
+ * those at k' and no G-dependent phase has to be applied; the change to the atomic gauge is
+ * done later with the actual momenta.
+ * @return Index k' of the mesh point equivalent to each k+Q, or empty if Q = 0 or Q is not
+ * commensurate.
+ */
+arma::uvec Exciton::commensurateKQIndices() const {
+    if(arma::norm(Q) == 0){
+        return {};
+    }
+    arma::mat kQpoints = kpoints;
+    kQpoints.each_row() += Q;
+    return equivalentMeshIndices(kQpoints);
+}
+
+/**
+ * Finds the points of the mesh equivalent (up to a reciprocal lattice vector) to a set of points.
+ * @param points Matrix with one point per row.
+ * @return Index of the equivalent mesh point of each one, or empty if some point is not on the mesh.
+ */
+arma::uvec Exciton::equivalentMeshIndices(const arma::mat& points) const {
+    arma::mat toReciprocalBasis = arma::pinv(reciprocalLattice);
+    double tolerance = 1E-6*arma::norm(reciprocalLattice.row(0));
+    
+    arma::uvec indices(points.n_rows);
+    for(arma::uword i = 0; i < points.n_rows; i++){
+        arma::rowvec point = points.row(i);
+        int j = findEquivalentPointBZ(point, ncell);
+        if(j < 0 || j >= nk){
+            return {};
+        }
+        // The mesh may be shifted or reduced, so check that the difference is indeed some G
+        arma::rowvec G = point - kpoints.row(j);
+        arma::rowvec coefs = arma::round(G*toReciprocalBasis);
+        if(arma::norm(G - coefs*reciprocalLattice) > tolerance){
+            return {};
+        }
+        indices(i) = j;
+    }
+    return indices;
+}
+
+/**
+ * Fills the stacks at k+Q by copying the bands at the equivalent mesh points, which must be
+ * computed first.
+ * @param kQIndices Index of the mesh point equivalent to each k+Q.
+ * @param nthreads Number of OpenMP threads used in the copy.
+ * @return void
+ */
+void Exciton::copyBandsKQ(const arma::uvec& kQIndices, int nthreads){
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int i = 0; i < nk; i++){
+        eigvecKQStack_.slice(i) = eigvecKStack_.slice(kQIndices(i));
+        eigvalKQStack_.col(i) = eigvalKStack_.col(kQIndices(i));
+        if (spinSectors_){
+            spinKQStack_.col(i) = spinKStack_.col(kQIndices(i));
+        }
+    }
+}
+
+/**
+ * Fixes the gauge of the bands so that the states at -k are the complex conjugates of those at k,
+ * and the states at the time-reversal invariant momenta are real (see setRealArithmetic).
+ * @param triangular Boolean to specify whether the Hamiltonian matrices are triangular.
+ * @return void
+ */
+void Exciton::enforceTimeReversalGauge(bool triangular){
+    if(arma::norm(Q) != 0){
+        throw std::invalid_argument("Real arithmetic requires Q = 0");
+    }
+    arma::mat minusK = -kpoints;
+    timeReversedK_ = equivalentMeshIndices(minusK);
+    if(timeReversedK_.is_empty()){
+        throw std::invalid_argument("Real arithmetic requires a mesh symmetric under k -> -k");
+    }
+
+    for(int i = 0; i < nk; i++){
+        int j = timeReversedK_(i);
+        if(j > i){
+            eigvecKStack_.slice(j) = arma::conj(eigvecKStack_.slice(i));
+            eigvalKStack_.col(j) = eigvalKStack_.col(i);
+        }
+        else if(j == i){
+            // H(k) and S(k) are real at these momenta, so the bands have real eigenstates
+            arma::vec eigval;
+            arma::mat realEigvec;
+            solveRealBands(kpoints.row(i), eigval, realEigvec, triangular);
+            eigvecKStack_.slice(i) = arma::conv_to<arma::cx_mat>::from(arma::mat(realEigvec.cols(bandList)));
+            eigvalKStack_.col(i) = eigval(bandList);
+        }
+    }
+    eigvecKQStack_ = eigvecKStack_;
+    eigvalKQStack_ = eigvalKStack_;
+}
+
+/**
+ * Selects the ISDF interpolation atoms and projects the motif Fourier transforms on them.
+ * @details A sample of atom-resolved pair densities (those entering the direct and exchange
+ * terms, and the coupling block of the full BSE, for all the band pairs of the basis on a subset
+ * of k points) is stored by columns in
+ * Z. The interpolation atoms are the rows chosen by pivoted Gram-Schmidt until the residual
+ * falls below the tolerance, and the interpolation vectors Theta = Z Z_S^H (Z_S Z_S^H)^-1 give
+ * every density from its values on them. The kernel is then W(q) = Theta^T V(q) Theta.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+void Exciton::initializeDensityFitting(const arma::imat& basisStates){
+
+    log() << "Selecting ISDF interpolation atoms... " << std::flush;
+
+    auto coefficients = [this](const arma::cx_cube& stack, int band, int k){
+        arma::cx_vec coefs = stack.slice(k).col(bandToIndex.at(band));
+        if(gauge == "atomic"){
+            coefs %= atomicGaugePhases_.col(k);
+        }
+        return coefs;
+    };
+    std::vector<arma::cx_vec> densities;
+    auto addDensity = [&](const arma::cx_vec& coefs1, const arma::cx_vec& coefs2){
+        arma::cx_vec product = arma::conj(coefs1) % coefs2;
+        arma::cx_vec density = arma::zeros<arma::cx_vec>(natoms);
+        for(arma::uword o = 0; o < product.n_elem; o++){
+            density(orbitalAtom_(o)) += product(o);
+        }
+        densities.push_back(density);
+    };
+
+    // Sample of pair densities over a subset of k points
+    arma::ivec valence = arma::unique(basisStates.col(0));
+    arma::ivec conduction = arma::unique(basisStates.col(1));
+    arma::uword nk = kpoints.n_rows;
+    arma::uword nsampled = std::min<arma::uword>(nk, std::max<arma::uword>(4, std::ceil(std::sqrt(4.*natoms))));
+    arma::uvec sampled = arma::regspace<arma::uvec>(0, nk/nsampled, nk - 1);
+    for(arma::uword k : sampled){
+        for(arma::uword k2 : sampled){
+            for(int c : conduction){
+                for(int c2 : conduction){
+                    addDensity(coefficients(eigvecKQStack, c, k), coefficients(eigvecKQStack, c2, k2));
+                }
+            }
+            for(int v : valence){
+                for(int v2 : valence){
+                    addDensity(coefficients(eigvecKStack, v2, k2), coefficients(eigvecKStack, v, k));
+                }
+            }
+            // The direct term of the coupling block contracts conduction and valence states at different k
+            if(fullBSE_){
+                for(int c : conduction){
+                    for(int v : valence){
+                        addDensity(coefficients(eigvecKQStack, c, k), coefficients(eigvecKStack, v, k2));
+                    }
+                }
+            }
+        }
+        if(exchange){
+            for(int v : valence){
+                for(int c : conduction){
+                    addDensity(coefficients(eigvecKQStack, c, k), coefficients(eigvecKStack, v, k));
+                    addDensity(coefficients(eigvecKStack, v, k), coefficients(eigvecKQStack, c, k));
+                }
+            }
+        }
+    }
+    arma::cx_mat Z(natoms, densities.size());
+    for(unsigned int s = 0; s < densities.size(); s++){
+        Z.col(s) = densities[s];
+    }
+
+    // Pivoted Gram-Schmidt on the rows (atoms) of Z
+    arma::cx_mat residual = Z;
+    arma::vec norms = arma::sum(arma::square(arma::abs(residual)), 1);
+    double largestNorm = std::sqrt(norms.max());
+    std::vector<arma::uword> selected;
+    while((int)selected.size() < natoms){
+        arma::uword pivot = norms.index_max();
+        if(std::sqrt(norms(pivot)) <= isdfTolerance_*largestNorm){
+            break;
+        }
+        selected.push_back(pivot);
+        arma::cx_rowvec direction = residual.row(pivot)/std::sqrt(norms(pivot));
+        residual -= (residual*direction.t())*direction;
+        norms = arma::sum(arma::square(arma::abs(residual)), 1);
+        norms(arma::uvec(selected)).zeros();
+    }
+    if(selected.empty()){
+        selected.push_back(0);
+    }
+    isdfAtoms_ = arma::sort(arma::uvec(selected));
+
+    arma::cx_mat ZS = Z.rows(isdfAtoms_);
+    arma::cx_mat gram = ZS*ZS.t();
+    isdfInterpolation_ = arma::solve(gram, arma::cx_mat(Z*ZS.t()).t()).t();
+
+    std::vector<arma::uword> fittedOrbitals, orbitalPoint;
+    for(arma::uword o = 0; o < orbitalAtom_.n_elem; o++){
+        arma::uvec point = arma::find(isdfAtoms_ == orbitalAtom_(o));
+        if(!point.is_empty()){
+            fittedOrbitals.push_back(o);
+            orbitalPoint.push_back(point(0));
+        }
+    }
+    isdfOrbitals_ = arma::uvec(fittedOrbitals);
+    isdfOrbitalPoint_ = arma::uvec(orbitalPoint);
+
+    // Kernel between interpolation atoms
+    const arma::cx_mat& theta = isdfInterpolation_;
+    BLASThreadGuard blasThreads(1);
+    isdfKernelStack_.set_size(isdfAtoms_.n_elem, isdfAtoms_.n_elem, ftMotifStack.n_slices);
+    #pragma omp parallel for num_threads(stageThreads("bse"))
+    for(unsigned int q = 0; q < ftMotifStack.n_slices; q++){
+        isdfKernelStack_.slice(q) = theta.st()*ftMotifStack.slice(q)*theta;
+    }
+    if(exchange){
+        isdfKernelQ_ = theta.st()*ftMotifQ*theta;
+    }
+    log() << "Done" << std::endl;
+    log() << "ISDF: " << isdfAtoms_.n_elem << " of " << natoms << " atoms as interpolation points" << std::endl;
+}
+
+/**
+ * Method to compute the motif Fourier transform of the interaction over the BZ mesh
+ * (realspace mode only), and at Q if the exchange is included.
+ * @return void
+ */
+void Exciton::initializeMotifFTStack(){
+
+    double radius = arma::norm(bravaisLattice.row(0)) * cutoff_;
+    arma::mat cells = truncateSupercell(ncell, radius);
+    int nthreads = stageThreads("bands");
+
+    this->ftMotifStack   = arma::cx_cube(natoms, natoms, meshBZ_.n_rows, arma::fill::none);
+    this->ftMotifQ       = arma::cx_mat(natoms, natoms);
+    firstTouch(ftMotifStack, nthreads);
+
+    // Progress bar variables
+    int step = 1;
+	int displayNext = step;
+	int percent = 0;
+    int completed = 0;
+
+    if(this->mode == "realspace"){
+        log() << "Computing lattice Fourier transform..." << std::endl;
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for (unsigned int i = 0; i < meshBZ_.n_rows; i++){
+            if (cancelled_){
+                continue;
+            }
+            // BIGGEST BOTTLENECK OF THE CODE
+            initializeMotifFT(i, cells);     
+
+            #pragma omp critical(motifFTProgress)
+            {
+                completed++;
+                percent = (100 * completed) / meshBZ_.n_rows ;
+                if (percent >= displayNext){
+                    log() << "\r" << "[" << std::string(percent / 5, '|') << std::string(100 / 5 - percent / 5, ' ') << "]";
+                    log() << percent << "%";
+                    log().flush();
+                    displayNext += step;
+                    reportProgress("motifFT", (double)completed/meshBZ_.n_rows);
+                }
+            }
+        }
+        checkCancelled("motifFT");
+        log() << "\nDone" << std::endl;
+    }
+
+    if(this->exchange){
+        this->ftMotifQ = motifFTMatrix(this->Q, cells);
+    }
+}
+
+/**
+ * Recomputes the quantities of the interaction kernel that depend on the potential and the
+ * cutoff (motif FT, and the reciprocal-space tables in that mode), keeping the bands.
+ * @return void
+ */
+void Exciton::initializeInteractionKernel(){
+    initializeMotifFTStack();
+    if(this->mode == "reciprocalspace"){
+        initializeReciprocalKernel();
+    }
+}
+
+/**
+ * Stores the atom of each orbital and selects the contraction of the real-space kernel,
+ * using a fixed-size implementation if there is one for the size of the motif.
+ * @return void
+ */
+void Exciton::initializeMotifKernel(){
+    this->orbitalAtom_ = arma::uvec(basisdim);
+    int it = 0;
+    for(int i = 0; i < natoms; i++){
+        int species = motif.row(i)(3);
+        for(unsigned int o = 0; o < orbitals(species); o++){
+            orbitalAtom_(it) = i;
+            it++;
+        }
+    }
+    this->orbitalPositions_ = motif.submat(orbitalAtom_, arma::uvec{0, 1, 2});
+    this->motifKernel_ = motifKernel(natoms, basisdim);
+}
+
+/**
+ * Tabulates the phases exp(-ik·t) of each orbital for all the kpoints, so that the change
+ * of the bands to the atomic gauge in the interaction terms is a single product.
+ * @return void
+ */
+void Exciton::initializeGaugePhases(){
+    arma::mat argument = - orbitalPositions_*kpoints.t();
+    this->atomicGaugePhases_ = arma::cx_mat(arma::cos(argument), arma::sin(argument));
+}
+
+/**
+ * Tabulates the quantities of the reciprocal-space kernel that do not depend on the bands.
+ * @details The reciprocal vectors within the cutoff are computed once, together with the
+ * phases exp(iG·t) and exp(ik·t) of the atom of each orbital, so that the phase of the Bloch
+ * coherence factors at k - k' + G factorizes. If the kpoints lie on a regular mesh, the
+ * potential V(k - k' + G) is tabulated for each difference k - k' of the mesh, which is
+ * shared by many pairs of kpoints.
+ * @return void
+ */
+void Exciton::initializeReciprocalKernel(){
+
+    log() << "Tabulating reciprocal-space kernel... " << std::flush;
+    double radius = cutoff * arma::norm(reciprocalLattice.row(0));
+    this->reciprocalVectors_ = truncateReciprocalSupercell(nReciprocalVectors, radius);
+    int nG = reciprocalVectors_.n_rows;
+
+    arma::mat argument = orbitalPositions_*reciprocalVectors_.t();
+    this->orbitalPhasesG_ = arma::cx_mat(arma::cos(argument), arma::sin(argument));
+    argument = orbitalPositions_*kpoints.t();
+    this->orbitalPhasesK_ = arma::cx_mat(arma::cos(argument), arma::sin(argument));
+    this->orbitalPhasesQ_ = orbitalPhases(Q);
+
+    this->potentialQ_ = arma::vec(nG);
+    for(int g = 0; g < nG; g++){
+        potentialQ_(g) = potentialFT(Q + reciprocalVectors_.row(g));
+    }
+
+    // Integer coordinates of the kpoints in the mesh (relative to the first one)
+    this->potentialTable_.reset();
+    arma::mat coordinates = kpoints*bravaisLattice.t()*ncell/(2*PI);
+    coordinates.each_row() -= coordinates.row(0);
+    arma::mat rounded = arma::round(coordinates);
+    if(arma::abs(coordinates - rounded).max() > 1E-6){
+        log() << "kpoints not on a regular mesh, the potential is evaluated for each pair" << std::endl;
+        return;
+    }
+    this->meshCoordinates_ = arma::conv_to<arma::imat>::from(rounded);
+    arma::irowvec minimum = arma::min(meshCoordinates_, 0);
+    meshCoordinates_.each_row() -= minimum;
+    this->meshSpan_ = arma::max(meshCoordinates_, 0);
+
+    // Differences of coordinates range in [-span, span] along each axis
+    this->meshStrides_ = arma::irowvec(meshSpan_.n_elem);
+    long int ndifferences = 1;
+    for(arma::uword j = 0; j < meshSpan_.n_elem; j++){
+        meshStrides_(j) = ndifferences;
+        ndifferences *= 2*meshSpan_(j) + 1;
+    }
+
+    int nthreads = stageThreads("bands");
+    this->potentialTable_ = arma::mat(nG, ndifferences);
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for(long int d = 0; d < ndifferences; d++){
+        arma::rowvec q = arma::zeros<arma::rowvec>(3);
+        long int remainder = d;
+        for(arma::uword j = 0; j < meshSpan_.n_elem; j++){
+            long int delta = remainder % (2*meshSpan_(j) + 1) - meshSpan_(j);
+            remainder /= 2*meshSpan_(j) + 1;
+            q += (double)delta/ncell*reciprocalLattice.row(j);
+        }
+        for(int g = 0; g < nG; g++){
+            potentialTable_(g, d) = potentialFT(q + reciprocalVectors_.row(g));
+        }
+    }
+    log() << "Done (" << nG << " reciprocal vectors, " << ndifferences << " mesh differences)" << std::endl;
+}
+
+/**
+ * Checks whether the band stacks of another exciton can be reused by this one, i.e. whether
+ * both are defined on the same system, kpoints, bands and center-of-mass momentum.
+ * @param other Exciton whose band stacks are to be reused.
+ * @return True if the band stacks are compatible.
+ */
+bool Exciton::hasSameBands(const Exciton& other) const {
+    return hasSameKBands(other) && arma::approx_equal(Q, other.Q, "absdiff", 1E-10);
+}
+
+/**
+ * Checks whether the bands at k of another exciton can be reused by this one, i.e. whether
+ * both are defined on the same system, kpoints and bands (the center-of-mass momentum may differ).
+ * @param other Exciton whose band stacks are to be reused.
+ * @return True if the bands at k are compatible.
+ */
+bool Exciton::hasSameKBands(const Exciton& other) const {
+    if(other.eigvecKStack.is_empty()){
+        return false;
+    }
+    bool sameSystem = (basisdim == other.basisdim) && (natoms == other.natoms) &&
+                      arma::approx_equal(motif, other.motif, "absdiff", 1E-10) &&
+                      arma::approx_equal(bravaisLattice, other.bravaisLattice, "absdiff", 1E-10) &&
+                      arma::approx_equal(hamiltonianMatrices, other.hamiltonianMatrices, "absdiff", 1E-10) &&
+                      arma::approx_equal(overlapMatrices, other.overlapMatrices, "absdiff", 1E-10);
+    bool sameMesh = arma::approx_equal(kpoints, other.kpoints, "absdiff", 1E-10);
+    bool sameBands = (bandList.n_elem == other.bandList.n_elem) && arma::all(bandList == other.bandList) &&
+                     (spinSectors_ == other.spinSectors_) && (realArithmetic_ == other.realArithmetic_);
+
+    return sameSystem && sameMesh && sameBands;
+}
+
+/**
+ * Checks whether the motif Fourier transform of another exciton can be reused by this one, i.e.
+ * whether both use the same lattice, mesh, cutoff and interaction parameters. The dielectric constants
+ * may differ, since the motif FT is then only rescaled (see dielectricFactor).
+ * @param other Exciton whose motif FT is to be reused.
+ * @return True if the motif FT are compatible.
+ */
+bool Exciton::hasSameMotifFT(const Exciton& other) const {
+    if(mode != "realspace" || other.mode != "realspace" || other.ftMotifStack.is_empty()){
+        return false;
+    }
+    // The potential also depends on the lattice through the lattice constant and the cell area
+    bool sameSystem = (natoms == other.natoms) && (ndim == other.ndim) &&
+                      arma::approx_equal(motif, other.motif, "absdiff", 1E-10) &&
+                      arma::approx_equal(bravaisLattice, other.bravaisLattice, "absdiff", 1E-10) &&
+                      (std::abs(a - other.a) < 1E-10) && (std::abs(unitCellArea - other.unitCellArea) < 1E-10);
+    bool sameMesh = (meshBZ_.n_rows == other.meshBZ_.n_rows) && 
+                    arma::approx_equal(meshBZ_, other.meshBZ_, "absdiff", 1E-10);
+    bool sameTruncation = (ncell == other.ncell) && (totalCells == other.totalCells) && (cutoff == other.cutoff);
+    // The dielectric constants only enter through a global factor, so they may differ
+    bool samePotential = (interactionType == other.interactionType);
+    if(interactionType == "keldysh"){
+        samePotential = samePotential && (r0 == other.r0);
+    }
+
+    return sameSystem && sameMesh && sameTruncation && samePotential;
+}
+
+/**
+ * Routine to initialize the required variables to construct the Bethe-Salpeter Hamiltonian.
+ * @param triangular Boolean to specify whether the single-particle Hamiltonian matrices are triangular.
+ * @return void.
+ */
+void Exciton::initializeHamiltonian(bool triangular){
+
+    if(bands.empty()){
+        throw std::invalid_argument("Error: Exciton object must have some bands");
+    }
+    if(nk == 0){
+        throw std::invalid_argument("Error: BZ mesh must be initialized first");
+    }
+
+    this->excitonbasisdim_ = nk*valenceBands.n_elem*conductionBands.n_elem;
+
+    log() << "Initializing basis for BSE... " << std::flush;
+    initializeBasis();
+    //useSpinfulBasis();
+    generateBandDictionary();
+
+    initializeMotifKernel();
+    initializeGaugePhases();
+    initializeResultsH0(triangular);
+    if(this->mode == "reciprocalspace"){
+        initializeReciprocalKernel();
+    }
+}
+
+/**
+ * Extends an already built exciton with additional bands, computing only the new rows and
+ * columns of the BSE matrix.
+ * @details The band stacks are recomputed (the diagonalization of H(k) already gives all the
+ * bands), but the eigenvectors of the previous bands are kept so that the reused blocks of HBS
+ * remain consistent with them, and the new ones are orthonormalized against them. The motif FT does not depend on the bands and is reused as is.
+ * Requires the BSE to have been built in memory and in double precision on the full basis, with
+ * the exact kernel: the density fit depends on the bands, and refitting it would invalidate the
+ * reused blocks.
+ * @param bands New list of bands relative to the Fermi level. Must contain the current ones.
+ * @param previousStates Eigenvectors of the previous BSE (e.g. Result::eigvec), used as initial
+ * guess of the next diagonalization with the Davidson method.
+ * @param triangular Boolean to specify whether the single-particle Hamiltonian matrices are triangular.
+ * @return void
+ */
+void Exciton::extendBands(const arma::ivec& bands, const arma::cx_mat& previousStates, bool triangular){
+
+    if(HBS_.is_empty() || HBS_.n_rows != basisStates.n_rows || !windowIndices_.is_empty() || fullBSE_){
+        throw std::logic_error("extendBands(): BSE must be built first on the full basis, in memory and double precision (Tamm-Dancoff)");
+    }
+    if(!isdfKernelStack_.is_empty()){
+        throw std::logic_error("extendBands(): not available with density fitting, whose interpolation atoms are fitted to the current bands");
+    }
+    for(const auto& band : bands_){
+        if(arma::all(bands != band)){
+            throw std::invalid_argument("extendBands(): new band list must contain the current bands");
+        }
+    }
+    if(!previousStates.is_empty() && previousStates.n_rows != basisStates.n_rows){
+        throw std::invalid_argument("extendBands(): previous states do not match the current basis");
+    }
+
+    // Previous basis, band stacks and BSE
+    arma::imat previousBasis = basisStates_;
+    std::map<int, int> previousIndex = bandToIndex;
+    arma::cx_cube previousVecK = eigvecKStack_, previousVecKQ = eigvecKQStack_;
+    arma::mat previousValK = eigvalKStack_, previousValKQ = eigvalKQStack_;
+    arma::cx_mat previousHBS = std::move(HBS_);
+
+    setBands(bands);
+    this->bandList_ = arma::conv_to<arma::uvec>::from(arma::join_cols(valenceBands, conductionBands));
+    this->excitonbasisdim_ = nk*valenceBands.n_elem*conductionBands.n_elem;
+
+    log() << "Extending basis for BSE... " << std::flush;
+    initializeBasis();
+    generateBandDictionary();
+    log() << "Done" << std::endl;
+
+    initializeBandStacks(triangular);
+    for(const auto& entry : previousIndex){
+        int index = bandToIndex.at(entry.first);
+        eigvecKStack_.col(index)  = previousVecK.col(entry.second);
+        eigvecKQStack_.col(index) = previousVecKQ.col(entry.second);
+        eigvalKStack_.row(index)  = previousValK.row(entry.second);
+        eigvalKQStack_.row(index) = previousValKQ.row(entry.second);
+    }
+
+    // A new band degenerate with a kept one comes from a different diagonalization, so the new
+    // bands are orthonormalized against the kept ones by Gram-Schmidt; within a degenerate
+    // subspace this only rotates them, and elsewhere they are already orthogonal
+    std::vector<arma::uword> orderList;
+    for(const auto& entry : previousIndex){
+        orderList.push_back(bandToIndex.at(entry.first));
+    }
+    arma::uword nkept = orderList.size();
+    for(arma::uword b = 0; b < bandList.n_elem; b++){
+        if(std::find(orderList.begin(), orderList.begin() + nkept, b) == orderList.begin() + nkept){
+            orderList.push_back(b);
+        }
+    }
+    arma::uvec order(orderList);
+    auto orthonormalizeNewBands = [&](arma::cx_cube& stack){
+        BLASThreadGuard blasThreads(1);
+        #pragma omp parallel for num_threads(stageThreads("bands"))
+        for(int k = 0; k < (int)stack.n_slices; k++){
+            arma::cx_mat states = stack.slice(k);
+            for(arma::uword n = nkept; n < order.n_elem; n++){
+                arma::cx_mat previous = states.cols(order.head(n));
+                arma::cx_vec t = states.col(order(n));
+                for(int pass = 0; pass < 2; pass++){
+                    t -= previous*(previous.t()*t);
+                }
+                states.col(order(n)) = t/arma::norm(t);
+            }
+            stack.slice(k) = states;
+        }
+    };
+    orthonormalizeNewBands(eigvecKStack_);
+    orthonormalizeNewBands(eigvecKQStack_);
+
+    // Position of the previous pairs in the new basis (createBasis order: k, c, v)
+    long int basisDimBSE = basisStates.n_rows;
+    arma::uword nv = valenceBands.n_elem, nc = conductionBands.n_elem;
+    arma::uvec previousToNew(previousBasis.n_rows);
+    arma::uvec reused = arma::zeros<arma::uvec>(basisDimBSE);
+    for(arma::uword i = 0; i < previousBasis.n_rows; i++){
+        arma::uword vi = arma::as_scalar(arma::find(valenceBands == previousBasis(i, 0), 1));
+        arma::uword ci = arma::as_scalar(arma::find(conductionBands == previousBasis(i, 1), 1));
+        previousToNew(i) = previousBasis(i, 2)*nc*nv + ci*nv + vi;
+    }
+    reused(previousToNew).ones();
+
+    log() << "BSE dimension: " << basisDimBSE << " (reusing " << previousBasis.n_rows << ")" << std::endl;
+    log() << "Extending Bethe-Salpeter matrix... " << std::flush;
+    int nthreads = stageThreads("bse");
+    HBS_.set_size(basisDimBSE, basisDimBSE);
+    HBS_.submat(previousToNew, previousToNew) = previousHBS;
+    previousHBS.reset();
+
+    BLASThreadGuard blasThreads(1);
+    long int totalElements = basisDimBSE*(basisDimBSE + 1)/2 - (long int)previousBasis.n_rows*(previousBasis.n_rows + 1)/2;
+    long int completedElements = 0;
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        if (cancelled_){
+            continue;
+        }
+        long int computed = 0;
+        for(long int i = 0; i <= j; i++){
+            if (reused(i) && reused(j)){
+                continue;
+            }
+            HBS_(i, j) = BSEMatrixElement(basisStates, i, j);
+            computed++;
+        }
+
+        long int done;
+        #pragma omp atomic capture
+        { completedElements += computed; done = completedElements; }
+        if (totalElements > 0 && (100*done)/totalElements != (100*(done - computed))/totalElements){
+            reportProgress("bse", (double)done/totalElements);
+        }
+    }
+    checkCancelled("bse");
+
+    // Hermitian completion of the new elements of the lower triangle
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        for(long int i = j + 1; i < basisDimBSE; i++){
+            if (!(reused(i) && reused(j))){
+                HBS_(i, j) = std::conj(HBS_(j, i));
+            }
+        }
+    }
+
+    HK_ = arma::zeros(basisDimBSE, basisDimBSE);
+    for(long int i = 0; i < basisDimBSE; i++){
+        int k_index = basisStates(i, 2);
+        int v = bandToIndex.at(basisStates(i, 0));
+        int c = bandToIndex.at(basisStates(i, 1));
+        HK_(i, i) = eigvalKQStack(c, k_index) - eigvalKStack(v, k_index);
+    }
+    log() << "Done" << std::endl;
+
+    // The previous states, padded with zeros, are orthonormalized as initial block of the Davidson method
+    warmStart_.reset();
+    if(!previousStates.is_empty()){
+        arma::cx_mat embedded = arma::zeros<arma::cx_mat>(basisDimBSE, previousStates.n_cols);
+        embedded.rows(previousToNew) = previousStates;
+        arma::cx_mat R;
+        arma::qr_econ(warmStart_, R, embedded);
+    }
+}
+
+/**
+ * Overload of initializeHamiltonian that reuses the single-particle quantities of a previously
+ * initialized exciton whenever they match, instead of recomputing them.
+ * @details Band stacks are reused if both excitons share system, kpoints, bands and Q (only the bands
+ * at k if Q differs, so that only the k+Q points are diagonalized); the motif FT
+ * is reused if they share mesh, cutoff and interaction parameters, rescaling it if the dielectric constants
+ * differ (e.g. in a scissor or dielectric sweep both are reused, while in a sweep over r0 only the bands are).
+ * @param reference Already initialized exciton.
+ * @param triangular Boolean to specify whether the single-particle Hamiltonian matrices are triangular.
+ * @return void.
+ */
+void Exciton::initializeHamiltonian(const Exciton& reference, bool triangular){
+
+    if(bands.empty()){
+        throw std::invalid_argument("Error: Exciton object must have some bands");
+    }
+    if(nk == 0){
+        throw std::invalid_argument("Error: BZ mesh must be initialized first");
+    }
+
+    this->excitonbasisdim_ = nk*valenceBands.n_elem*conductionBands.n_elem;
+
+    log() << "Initializing basis for BSE... " << std::flush;
+    initializeBasis();
+    generateBandDictionary();
+    initializeMotifKernel();
+    initializeGaugePhases();
+
+    // Cube reading the memory of the reference in place (non-strict auxiliary memory, which
+    // the move assignment keeps as such), or a copy of it
+    auto reuse = [this](const arma::cx_cube& cube){
+        if(!shareReferenceStacks_){
+            return arma::cx_cube(cube);
+        }
+        return arma::cx_cube(const_cast<std::complex<double>*>(cube.memptr()),
+                             cube.n_rows, cube.n_cols, cube.n_slices, false, false);
+    };
+
+    if(hasSameBands(reference)){
+        log() << "Reusing bands of previous calculation" << std::endl;
+        this->eigvalKStack_  = reference.eigvalKStack;
+        this->eigvalKQStack_ = reference.eigvalKQStack;
+        this->eigvecKStack_  = reuse(reference.eigvecKStack);
+        this->eigvecKQStack_ = reuse(reference.eigvecKQStack);
+        this->spinKStack_    = reference.spinKStack_;
+        this->spinKQStack_   = reference.spinKQStack_;
+        this->timeReversedK_ = reference.timeReversedK_;
+    }
+    else if(hasSameKBands(reference)){
+        log() << "Reusing bands at k of previous calculation" << std::endl;
+        this->eigvalKStack_  = reference.eigvalKStack;
+        this->eigvecKStack_  = reuse(reference.eigvecKStack);
+        this->spinKStack_    = reference.spinKStack_;
+        initializeBandStacksKQ(triangular);
+    }
+    else{
+        initializeBandStacks(triangular);
+    }
+
+    if(hasSameMotifFT(reference)){
+        log() << "Reusing lattice Fourier transform of previous calculation" << std::endl;
+        double radius = arma::norm(bravaisLattice.row(0)) * cutoff_;
+        double scale = dielectricFactor()/reference.dielectricFactor();
+        if(scale != 1){
+            this->ftMotifStack = reference.ftMotifStack * scale;
+        }
+        else{
+            this->ftMotifStack = reuse(reference.ftMotifStack);
+        }
+        this->ftMotifQ = arma::cx_mat(natoms, natoms);
+        if(this->exchange){
+            this->ftMotifQ = motifFTMatrix(this->Q, truncateSupercell(ncell, radius));
+        }
+    }
+    else{
+        initializeMotifFTStack();
+    }
+    if(this->mode == "reciprocalspace"){
+        initializeReciprocalKernel();
+    }
+}
+
+
+/**
+ * Returns the coefficients of the valence state at k and the conduction state at k+Q of an
+ * electron-hole pair, in the gauge used for the interaction terms.
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @param i Index of the pair.
+ * @param coefsK Returns coefficients of the valence state.
+ * @param coefsKQ Returns coefficients of the conduction state.
+ * @return void
+ */
+void Exciton::pairCoefficients(const arma::imat& basis, long int i, arma::cx_vec& coefsK, arma::cx_vec& coefsKQ) const {
+    int k_index = basis(i, 2);
+    int v = bandToIndex.at(basis(i, 0));
+    int c = bandToIndex.at(basis(i, 1));
+
+    coefsK = eigvecKStack.slice(k_index).col(v);
+    coefsKQ = eigvecKQStack.slice(k_index).col(c);
+    if(gauge == "atomic"){
+        coefsK %= atomicGaugePhases_.col(k_index);
+        coefsKQ %= atomicGaugePhases_.col(k_index);
+    }
+}
+
+/**
+ * Version of pairCoefficients that does not copy the coefficients, for the assembly of the BSE.
+ * @details In the lattice gauge the pointers address the columns of the band stacks; in the
+ * atomic gauge the phases are applied on a copy written to the buffer.
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @param i Index of the pair.
+ * @param coefsK Returns pointer to the coefficients of the valence state.
+ * @param coefsKQ Returns pointer to the coefficients of the conduction state.
+ * @param buffer Storage for 2*basisdim coefficients, only used in the atomic gauge.
+ * @return void
+ */
+void Exciton::pairCoefficients(const arma::imat& basis, long int i, const std::complex<double>*& coefsK,
+                               const std::complex<double>*& coefsKQ, std::complex<double>* buffer) const {
+    int k_index = basis(i, 2);
+    int v = bandToIndex.at(basis(i, 0));
+    int c = bandToIndex.at(basis(i, 1));
+
+    coefsK = eigvecKStack.slice(k_index).colptr(v);
+    coefsKQ = eigvecKQStack.slice(k_index).colptr(c);
+    if(gauge == "atomic"){
+        const std::complex<double>* phases = atomicGaugePhases_.colptr(k_index);
+        for(int alpha = 0; alpha < basisdim; alpha++){
+            buffer[alpha] = coefsK[alpha]*phases[alpha];
+            buffer[basisdim + alpha] = coefsKQ[alpha]*phases[alpha];
+        }
+        coefsK = buffer;
+        coefsKQ = buffer + basisdim;
+    }
+}
+
+/**
+ * Returns the buffer of the calling thread for the coefficients of a pair in the atomic gauge
+ * (see pairCoefficients). It holds two pairs and is only allocated the first time.
+ * @param pair Index of the pair in the buffer, 0 or 1.
+ * @return Pointer to storage for 2*basisdim coefficients, or null in the lattice gauge.
+ */
+std::complex<double>* Exciton::gaugeBuffer(int pair) const {
+    if(gauge != "atomic"){
+        return nullptr;
+    }
+    thread_local std::vector<std::complex<double>> buffer;
+    if(buffer.size() < 4*(size_t)basisdim){
+        buffer.resize(4*basisdim);
+    }
+    return buffer.data() + 2*pair*basisdim;
+}
+
+/**
+ * Computes the direct and exchange interaction terms between two electron-hole pairs.
+ * @details Requires the band stacks and the motif Fourier transforms to be initialized.
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @param i Row index of the element.
+ * @param j Column index of the element.
+ * @param D Returns direct term.
+ * @param X Returns exchange term (zero if not computed).
+ * @param withExchange Whether to compute the exchange term.
+ * @return void
+ */
+void Exciton::interactionTerms(const arma::imat& basis, long int i, long int j,
+                               std::complex<double>& D, std::complex<double>& X, bool withExchange) const {
+
+    int k_index = basis(i, 2);
+    int k2_index = basis(j, 2);
+
+    D = 0.0;
+    X = 0.0;
+    if (mode == "realspace"){
+        // The coefficients are read in place, so the small motifs allocate nothing per element
+        const std::complex<double> *coefsK, *coefsKQ, *coefsK2, *coefsK2Q;
+        pairCoefficients(basis, i, coefsK, coefsKQ, gaugeBuffer(0));
+        pairCoefficients(basis, j, coefsK2, coefsK2Q, gaugeBuffer(1));
+        int effective_k_index = findEquivalentPointBZ(kpoints.row(k2_index) - kpoints.row(k_index), ncell);
+        if (!isdfKernelStack_.is_empty()){
+            D = isdfInteractionTerm(coefsKQ, coefsK2, coefsK2Q, coefsK, isdfKernelStack_.slice(effective_k_index));
+            if(withExchange){
+                X = isdfInteractionTerm(coefsKQ, coefsK2, coefsK, coefsK2Q, isdfKernelQ_);
+            }
+        }
+        else{
+            const arma::cx_mat& motifFT = ftMotifStack.slice(effective_k_index);
+            D = exactInteractionTermMFT(coefsKQ, coefsK2, coefsK2Q, coefsK, motifFT);
+            if(withExchange){
+                X = exactInteractionTermMFT(coefsKQ, coefsK2, coefsK, coefsK2Q, this->ftMotifQ);
+            }
+        }
+    }
+    else if (mode == "reciprocalspace"){
+        arma::cx_vec coefsK, coefsK2, coefsKQ, coefsK2Q;
+        pairCoefficients(basis, i, coefsK, coefsKQ);
+        pairCoefficients(basis, j, coefsK2, coefsK2Q);
+        arma::cx_vec phases = orbitalPhasesK_.col(k_index) % arma::conj(orbitalPhasesK_.col(k2_index));
+        D = interactionTermFT(coefsK, coefsK2, coefsKQ, coefsK2Q, phases, reciprocalPotential(k_index, k2_index));
+        if(withExchange){
+            X = interactionTermFT(coefsK2Q, coefsK2, coefsKQ, coefsK, orbitalPhasesQ_, potentialQ_);
+        }
+    }
+}
+
+/**
+ * Computes one matrix element of the Bethe-Salpeter Hamiltonian between two electron-hole pairs.
+ * @details Requires the band stacks and the motif Fourier transforms to be initialized. Used both
+ * by the shared-memory assembly and by the distributed one, where each rank only evaluates
+ * the elements of its own blocks.
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @param i Row index of the element.
+ * @param j Column index of the element.
+ * @return Matrix element HBS(i, j).
+ */
+std::complex<double> Exciton::BSEMatrixElement(const arma::imat& basis, long int i, long int j) const {
+
+    std::complex<double> D, X;
+    interactionTerms(basis, i, j, D, X, this->exchange);
+
+    if (i == j){
+        int k_index = basis(i, 2);
+        int v = bandToIndex.at(basis(i, 0));
+        int c = bandToIndex.at(basis(i, 1));
+        return this->scissor + eigvalKQStack(c, k_index) - eigvalKStack(v, k_index) - std::real(D - X);
+    }
+    return - (D - X);
+}
+
+/**
+ * Computes one element of the coupling block B of the full BSE (beyond the Tamm-Dancoff
+ * approximation) between two electron-hole pairs, for Q = 0.
+ * @details B couples the excitation of pair {v, c, k} with the deexcitation of pair {v', c', k'}.
+ * Its direct term involves the densities c*(k) v'(k') and c'*(k') v(k), and its exchange term
+ * the densities c*(k) v(k) and c'*(k') v'(k'). B is complex symmetric.
+ * @param basis Electron-hole pair basis, one pair {v, c, k} per row.
+ * @param i Row index of the element.
+ * @param j Column index of the element.
+ * @return Matrix element B(i, j).
+ */
+std::complex<double> Exciton::couplingMatrixElement(const arma::imat& basis, long int i, long int j) const {
+
+    int k_index = basis(i, 2);
+    int k2_index = basis(j, 2);
+
+    std::complex<double> D = 0.0, X = 0.0;
+    if (mode == "realspace"){
+        const std::complex<double> *coefsK, *coefsKQ, *coefsK2, *coefsK2Q;
+        pairCoefficients(basis, i, coefsK, coefsKQ, gaugeBuffer(0));
+        pairCoefficients(basis, j, coefsK2, coefsK2Q, gaugeBuffer(1));
+        int effective_k_index = findEquivalentPointBZ(kpoints.row(k2_index) - kpoints.row(k_index), ncell);
+        if (!isdfKernelStack_.is_empty()){
+            D = isdfInteractionTerm(coefsKQ, coefsK2Q, coefsK2, coefsK, isdfKernelStack_.slice(effective_k_index));
+            if(exchange){
+                X = isdfInteractionTerm(coefsKQ, coefsK2Q, coefsK, coefsK2, isdfKernelQ_);
+            }
+        }
+        else{
+            const arma::cx_mat& motifFT = ftMotifStack.slice(effective_k_index);
+            D = exactInteractionTermMFT(coefsKQ, coefsK2Q, coefsK2, coefsK, motifFT);
+            if(exchange){
+                X = exactInteractionTermMFT(coefsKQ, coefsK2Q, coefsK, coefsK2, this->ftMotifQ);
+            }
+        }
+    }
+    else if (mode == "reciprocalspace"){
+        arma::cx_vec coefsK, coefsK2, coefsKQ, coefsK2Q;
+        pairCoefficients(basis, i, coefsK, coefsKQ);
+        pairCoefficients(basis, j, coefsK2, coefsK2Q);
+        arma::cx_vec phases = orbitalPhasesK_.col(k_index) % arma::conj(orbitalPhasesK_.col(k2_index));
+        D = interactionTermFT(coefsK, coefsK2Q, coefsKQ, coefsK2, phases, reciprocalPotential(k_index, k2_index));
+        if(exchange){
+            X = interactionTermFT(coefsK2, coefsK2Q, coefsKQ, coefsK, orbitalPhasesQ_, potentialQ_);
+        }
+    }
+    return - (D - X);
+}
+
+/**
+ * Initialize BSE hamiltonian matrix and kinetic matrix.
  * @details Instead of calculating the energies and coeficients dinamically, which
  * is too expensive, instead we first calculate those for each k, save them
  * in the heap, and then call them consecutively as we build the matrix.
@@ -850,137 +2274,1497 @@ void Exciton::initializeHamiltonian(bool triangular){
  * saving it in the stack so that it can be later called in the matrix element
  * calculation.
  * Also note that this routine involves a omp parallelization when building the matrix.
+ * In single precision mode, the matrix is stored as single-precision complex (HBSsingle)
+ * and the kinetic matrix is not stored.
  * @param basis Subset of the exciton basis to build the BSE. If none, defaults to
- * the complete or original basis.
+ * the complete or original basis, restricted to the energy window if set. A given basis is
+ * used as is, without applying the energy window (see restrictToEnergyWindow).
+ * @return void
+ */
+void Exciton::BShamiltonian(const arma::imat& basis){
+
+    arma::imat basisStates = this->basisStates;
+    windowIndices_.reset();
+    if (!basis.is_empty()){
+        basisStates = basis;
+        if (energyWindow_ > 0){
+            log() << "Warning: energy window not applied to the given basis, use restrictToEnergyWindow" << std::endl;
+        }
+    }
+    else if (energyWindow_ > 0){
+        // Indices of the pairs kept, to embed the eigenvectors back in the full basis
+        windowIndices_ = pairsWithinEnergyWindow(this->basisStates, energyWindow_);
+        basisStates = this->basisStates.rows(windowIndices_);
+        log() << "Energy window of " << energyWindow_ << " eV: " << basisStates.n_rows << " of "
+              << this->basisStates.n_rows << " electron-hole pairs kept" << std::endl;
+        if (basisStates.is_empty()){
+            throw std::invalid_argument("BShamiltonian(): no electron-hole pairs within the energy window");
+        }
+    }
+
+    int basisDimBSE = basisStates.n_rows;
+    log() << "BSE dimension: " << basisDimBSE << std::endl;
+    if (isdfTolerance_ > 0 && mode == "realspace"){
+        initializeDensityFitting(basisStates);
+    }
+    else{
+        isdfAtoms_.reset();
+        isdfKernelStack_.reset();
+    }
+    if (!outOfCoreDirectory_.empty() && compressionTolerance_ > 0){
+        throw std::logic_error("BShamiltonian(): out-of-core storage and compression can not be used together");
+    }
+    if (spinSectors_ && (!outOfCoreDirectory_.empty() || compressionTolerance_ > 0 || precision_ == "single")){
+        throw std::logic_error("BShamiltonian(): spin sectors require in-core, uncompressed and double precision storage");
+    }
+    if (realArithmetic_ && (!outOfCoreDirectory_.empty() || compressionTolerance_ > 0 || precision_ == "single" || spinSectors_)){
+        throw std::logic_error("BShamiltonian(): real arithmetic requires in-core, uncompressed and double precision storage without spin sectors");
+    }
+    if (fullBSE_ && (!outOfCoreDirectory_.empty() || compressionTolerance_ > 0 || precision_ == "single" || spinSectors_)){
+        throw std::logic_error("BShamiltonian(): full BSE requires in-core, uncompressed and double precision storage without spin sectors");
+    }
+    if (fullBSE_ && arma::norm(Q) != 0){
+        throw std::invalid_argument("BShamiltonian(): full BSE is only implemented for Q = 0");
+    }
+    sectorIndices_.clear();
+    HBSSectors_.clear();
+    HBSReal_.reset();
+    HBSCouplingReal_.reset();
+    HBSCoupling_.reset();
+    antiresonant_.reset();
+    if (!outOfCoreDirectory_.empty()){
+        BShamiltonianOutOfCore(basisStates);
+        return;
+    }
+    HBSTiles_.reset();
+    if (compressionTolerance_ > 0){
+        BShamiltonianCompressed(basisStates);
+        return;
+    }
+    HBSCompressed_.reset();
+    if (spinSectors_){
+        BShamiltonianSectors(basisStates);
+        return;
+    }
+    if (realArithmetic_){
+        BShamiltonianReal(basisStates);
+        return;
+    }
+
+    if (precision_ == "single"){
+        log() << "Initializing Bethe-Salpeter matrix (single precision)... " << std::flush;
+        HBS_.reset();
+        HK_.reset();
+        this->basisBSE_ = basisStates;
+        assembleBSE(HBSf_, basisStates);
+        log() << "Done" << std::endl;
+        return;
+    }
+    HBSf_.reset();
+
+    log() << "Initializing Bethe-Salpeter matrix... " << std::flush;
+    assembleBSE(HBS_, basisStates);
+    if (fullBSE_){
+        assembleCoupling(HBSCoupling_, basisStates);
+    }
+
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(basisDimBSE, sizeof(double));
+    HK_.set_size(basisDimBSE, basisDimBSE);
+    firstTouch(HK_, tile, nthreads);
+    for(int i = 0; i < basisDimBSE; i++){
+        int k_index = basisStates(i, 2);
+        int v = bandToIndex.at(basisStates(i, 0));
+        int c = bandToIndex.at(basisStates(i, 1));
+        HK_(i, i) = eigvalKQStack(c, k_index) - eigvalKStack(v, k_index);
+    }
+    log() << "Done" << std::endl;
+};
+
+/**
+ * Builds the BSE by spin sectors, storing only the block of each sector (see setSpinSectors).
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+void Exciton::BShamiltonianSectors(const arma::imat& basisStates){
+    HBS_.reset();
+    HBSf_.reset();
+    HK_.reset();
+    this->basisBSE_ = basisStates;
+
+    sectorIndices_ = spinSectorPairs(basisStates);
+    HBSSectors_.resize(sectorIndices_.size());
+    for(unsigned int s = 0; s < sectorIndices_.size(); s++){
+        log() << "Initializing Bethe-Salpeter matrix of spin sector " << s + 1 << "/" << sectorIndices_.size()
+              << " (dimension " << sectorIndices_[s].n_elem << ")... " << std::flush;
+        assembleBSE(HBSSectors_[s], arma::imat(basisStates.rows(sectorIndices_[s])));
+        log() << "Done" << std::endl;
+    }
+}
+
+/**
+ * Builds the BSE in the real basis of time-reversed pairs (see setRealArithmetic).
+ * @details For each couple of pairs p, q (up to time reversal) only H(p,q) and H(p,-q) are
+ * computed, and they give the four elements between the combinations of p, -p and q, -q. The
+ * symmetric combination is stored in the row of the pair with the lower index, and the
+ * antisymmetric one in the row of its partner.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+void Exciton::BShamiltonianReal(const arma::imat& basisStates){
+    HBS_.reset();
+    HBSf_.reset();
+    HK_.reset();
+    this->basisBSE_ = basisStates;
+    this->pairPartner_ = timeReversedPairs(basisStates);
+
+    long int basisDimBSE = basisStates.n_rows;
+    arma::uvec representatives = arma::find(pairPartner_ >= arma::regspace<arma::uvec>(0, basisDimBSE - 1));
+    long int nrep = representatives.n_elem;
+
+    log() << "Initializing Bethe-Salpeter matrix (real arithmetic)... " << std::flush;
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(basisDimBSE, sizeof(double));
+    HBSReal_.set_size(basisDimBSE, basisDimBSE);
+    firstTouch(HBSReal_, tile, nthreads);
+    BLASThreadGuard blasThreads(1);
+
+    if (fullBSE_){
+        HBSCouplingReal_.set_size(basisDimBSE, basisDimBSE);
+        firstTouch(HBSCouplingReal_, tile, nthreads);
+    }
+
+    arma::mat& H = HBSReal_;
+    arma::mat& B = HBSCouplingReal_;
+    auto setSymmetric = [](arma::mat& M, arma::uword i, arma::uword j, double value){
+        M(i, j) = value;
+        M(j, i) = value;
+    };
+    const double root2 = std::sqrt(2.);
+
+    // Elements between the combinations of p, -p and q, -q from H(p,q) and H(p,-q); the sign
+    // multiplies the columns of the antisymmetric combinations
+    auto realBlock = [&setSymmetric, root2](arma::mat& M, arma::uword p, arma::uword pbar, arma::uword q, arma::uword qbar,
+                                            std::complex<double> Hpq, std::complex<double> Hpqbar, double sign){
+        if(p == pbar && q == qbar){
+            setSymmetric(M, p, q, std::real(Hpq));
+        }
+        else if(q == qbar){
+            setSymmetric(M, p, q, root2*std::real(Hpq));
+            setSymmetric(M, pbar, q, root2*std::imag(Hpq));
+        }
+        else if(p == pbar){
+            setSymmetric(M, p, q, root2*std::real(Hpq));
+            setSymmetric(M, p, qbar, -sign*root2*std::imag(Hpq));
+        }
+        else{
+            setSymmetric(M, p, q, std::real(Hpq) + std::real(Hpqbar));
+            setSymmetric(M, p, qbar, sign*(std::imag(Hpqbar) - std::imag(Hpq)));
+            setSymmetric(M, pbar, q, std::imag(Hpqbar) + std::imag(Hpq));
+            setSymmetric(M, pbar, qbar, sign*(std::real(Hpq) - std::real(Hpqbar)));
+        }
+    };
+    long int totalPairs = nrep*(nrep + 1)/2;
+    long int completedPairs = 0;
+
+    // Each couple of representatives writes a different set of elements, so there are no races
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    for(long int b = 0; b < nrep; b++){
+        if (cancelled_){
+            continue;
+        }
+        arma::uword q = representatives(b), qbar = pairPartner_(q);
+        for(long int a = 0; a <= b; a++){
+            arma::uword p = representatives(a), pbar = pairPartner_(p);
+            std::complex<double> Hpq = BSEMatrixElement(basisStates, p, q);
+            std::complex<double> Hpqbar = (q == qbar) ? Hpq : BSEMatrixElement(basisStates, p, qbar);
+            realBlock(H, p, pbar, q, qbar, Hpq, Hpqbar, 1.);
+
+            // The antiresonant states transform with the conjugate basis, which flips the
+            // sign of the antisymmetric columns
+            if (fullBSE_){
+                std::complex<double> Bpq = couplingMatrixElement(basisStates, p, q);
+                std::complex<double> Bpqbar = (q == qbar) ? Bpq : couplingMatrixElement(basisStates, p, qbar);
+                realBlock(B, p, pbar, q, qbar, Bpq, Bpqbar, -1.);
+            }
+        }
+
+        long int done;
+        #pragma omp atomic capture
+        { completedPairs += b + 1; done = completedPairs; }
+        if ((100*done)/totalPairs != (100*(done - b - 1))/totalPairs){
+            reportProgress("bse", (double)done/totalPairs);
+        }
+    }
+    checkCancelled("bse");
+    log() << "Done" << std::endl;
+}
+
+/**
+ * Transforms states from the real basis of time-reversed pairs to the electron-hole pair basis.
+ * @param Y States in the real basis, by columns.
+ * @return States in the electron-hole pair basis.
+ */
+arma::cx_mat Exciton::fromRealBasis(const arma::cx_mat& Y) const {
+    const std::complex<double> imag(0, 1);
+    const double root2 = std::sqrt(2.);
+    arma::cx_mat X(Y.n_rows, Y.n_cols);
+    for(arma::uword p = 0; p < Y.n_rows; p++){
+        arma::uword pbar = pairPartner_(p);
+        if(p == pbar){
+            X.row(p) = Y.row(p);
+        }
+        else if(p < pbar){
+            X.row(p)    = (Y.row(p) + imag*Y.row(pbar))/root2;
+            X.row(pbar) = (Y.row(p) - imag*Y.row(pbar))/root2;
+        }
+    }
+    return X;
+}
+
+/**
+ * Computes the Bethe-Salpeter matrix in a dense matrix of the given element type.
+ * @details Elements are always evaluated in double precision and then stored with the
+ * precision of the matrix. Only the upper triangle is computed; the lower one is filled
+ * by Hermitian completion.
+ * @param H Matrix where the BSE is stored.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+template<typename T>
+void Exciton::assembleBSE(arma::Mat<T>& H, const arma::imat& basisStates){
+
+    if (mode == "reciprocalspace"){
+        assembleBSEReciprocal(H, basisStates);
+        return;
+    }
+    long int basisDimBSE = basisStates.n_rows;
+
+    // Allocate without initialization and first-touch in parallel with the same column
+    // distribution used in the assembly, so that each thread writes pages on its own NUMA node
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(basisDimBSE, sizeof(T));
+    H.set_size(basisDimBSE, basisDimBSE);
+    firstTouch(H, tile, nthreads);
+
+    // Matrix elements are computed concurrently, so BLAS must run single-threaded
+    BLASThreadGuard blasThreads(1);
+
+    long int totalElements = basisDimBSE*(basisDimBSE + 1)/2;
+    long int completedElements = 0;
+
+    // Each thread computes the upper triangle (i <= j) of the columns it owns
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        if (cancelled_){
+            continue;
+        }
+        for(long int i = 0; i <= j; i++){
+            H(i, j) = (T)BSEMatrixElement(basisStates, i, j);
+        }
+
+        long int done;
+        #pragma omp atomic capture
+        { completedElements += j + 1; done = completedElements; }
+        if ((100*done)/totalElements != (100*(done - j - 1))/totalElements){
+            reportProgress("bse", (double)done/totalElements);
+        }
+    }
+    checkCancelled("bse");
+
+    // Hermitian completion of the lower triangle, with the same column distribution
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        for(long int i = j + 1; i < basisDimBSE; i++){
+            H(i, j) = std::conj(H(j, i));
+        }
+    }
+}
+
+/**
+ * Computes the Bethe-Salpeter matrix in reciprocal space by blocks of kpoints.
+ * @details The pairs are grouped by k. For each couple of groups (k, k'), the coherence factors
+ * of the conduction (and valence) bands, I(c, c', G), are obtained for all the reciprocal vectors
+ * with a single product of the band coefficients with the tabulated phases, and the direct block
+ * is then one product over G, sum_G I_c(G) V(k - k' + G) conj(I_v(G)). The exchange form factors
+ * M_vc(k, G) of all pairs are computed beforehand, and each exchange block is also a product
+ * over G. Each block is computed once and stored together with its Hermitian conjugate.
+ * @param H Matrix where the BSE is stored.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+template<typename T>
+void Exciton::assembleBSEReciprocal(arma::Mat<T>& H, const arma::imat& basisStates){
+
+    long int basisDimBSE = basisStates.n_rows;
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(basisDimBSE, sizeof(T));
+    H.set_size(basisDimBSE, basisDimBSE);
+    firstTouch(H, tile, nthreads);
+
+    // Blocks are computed concurrently, so BLAS must run single-threaded
+    BLASThreadGuard blasThreads(1);
+
+    // Pairs of each kpoint, and valence and conduction bands present in each group
+    arma::uvec order = arma::stable_sort_index(basisStates.col(2));
+    std::vector<arma::uvec> groups;
+    for(arma::uword first = 0; first < order.n_elem;){
+        arma::uword last = first;
+        while(last + 1 < order.n_elem && basisStates(order(last + 1), 2) == basisStates(order(first), 2)){
+            last++;
+        }
+        groups.push_back(order.subvec(first, last));
+        first = last + 1;
+    }
+    int ngroups = groups.size();
+    int nG = reciprocalVectors_.n_rows;
+
+    std::vector<arma::cx_mat> valenceCoefs(ngroups), conductionCoefs(ngroups), exchangeFactors(ngroups);
+    std::vector<arma::uvec> valencePosition(ngroups), conductionPosition(ngroups);
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    for(int b = 0; b < ngroups; b++){
+        const arma::uvec& pairs = groups[b];
+        arma::ivec valence = arma::unique(arma::ivec(basisStates(pairs, arma::uvec{0})));
+        arma::ivec conduction = arma::unique(arma::ivec(basisStates(pairs, arma::uvec{1})));
+        valenceCoefs[b] = arma::cx_mat(basisdim, valence.n_elem);
+        conductionCoefs[b] = arma::cx_mat(basisdim, conduction.n_elem);
+        valencePosition[b] = arma::uvec(pairs.n_elem);
+        conductionPosition[b] = arma::uvec(pairs.n_elem);
+
+        arma::cx_mat densities(basisdim, pairs.n_elem);
+        for(arma::uword p = 0; p < pairs.n_elem; p++){
+            arma::cx_vec coefsK, coefsKQ;
+            pairCoefficients(basisStates, pairs(p), coefsK, coefsKQ);
+            valencePosition[b](p) = arma::as_scalar(arma::find(valence == basisStates(pairs(p), 0), 1));
+            conductionPosition[b](p) = arma::as_scalar(arma::find(conduction == basisStates(pairs(p), 1), 1));
+            valenceCoefs[b].col(valencePosition[b](p)) = coefsK;
+            conductionCoefs[b].col(conductionPosition[b](p)) = coefsKQ;
+            densities.col(p) = arma::conj(coefsKQ) % coefsK % orbitalPhasesQ_;
+        }
+        if(exchange){
+            exchangeFactors[b] = densities.st()*orbitalPhasesG_;
+        }
+    }
+
+    // Coherence factors I(n, n', G) between the bands of two groups, by columns of G
+    auto coherenceFactors = [&](const arma::cx_mat& coefs, const arma::cx_mat& coefs2, const arma::cx_vec& phases){
+        arma::cx_mat shifted = coefs2.each_col() % phases;
+        arma::cx_mat phased(basisdim, coefs2.n_cols*nG);
+        for(int g = 0; g < nG; g++){
+            phased.cols(g*coefs2.n_cols, (g + 1)*coefs2.n_cols - 1) = shifted.each_col() % orbitalPhasesG_.col(g);
+        }
+        arma::cx_mat factors = coefs.t()*phased;
+        return arma::cx_mat(arma::reshape(factors, coefs.n_cols*coefs2.n_cols, nG));
+    };
+
+    arma::cx_mat exchangePotential = arma::diagmat(arma::cx_vec(potentialQ_, arma::zeros<arma::vec>(nG)));
+
+    std::vector<std::pair<int, int>> blocks;
+    for(int b2 = 0; b2 < ngroups; b2++){
+        for(int b = 0; b <= b2; b++){
+            blocks.push_back({b, b2});
+        }
+    }
+    long int totalBlocks = blocks.size();
+    long int completedBlocks = 0;
+
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    for(long int n = 0; n < totalBlocks; n++){
+        if (cancelled_){
+            continue;
+        }
+        int b = blocks[n].first, b2 = blocks[n].second;
+        const arma::uvec& rows = groups[b];
+        const arma::uvec& cols = groups[b2];
+        int k_index = basisStates(rows(0), 2);
+        int k2_index = basisStates(cols(0), 2);
+
+        arma::cx_vec phases = orbitalPhasesK_.col(k_index) % arma::conj(orbitalPhasesK_.col(k2_index));
+        arma::vec potential = reciprocalPotential(k_index, k2_index);
+        arma::cx_mat Ic = coherenceFactors(conductionCoefs[b], conductionCoefs[b2], phases);
+        arma::cx_mat Iv = coherenceFactors(valenceCoefs[b], valenceCoefs[b2], phases);
+        arma::cx_mat direct = Ic*arma::diagmat(arma::cx_vec(potential, arma::zeros<arma::vec>(nG)))*Iv.t();
+
+        arma::cx_mat block(rows.n_elem, cols.n_elem);
+        arma::uword nc = conductionCoefs[b].n_cols, nv = valenceCoefs[b].n_cols;
+        for(arma::uword j = 0; j < cols.n_elem; j++){
+            for(arma::uword i = 0; i < rows.n_elem; i++){
+                block(i, j) = direct(conductionPosition[b](i) + nc*conductionPosition[b2](j),
+                                     valencePosition[b](i) + nv*valencePosition[b2](j));
+            }
+        }
+        if(exchange){
+            block -= exchangeFactors[b]*exchangePotential*exchangeFactors[b2].t();
+        }
+
+        for(arma::uword j = 0; j < cols.n_elem; j++){
+            for(arma::uword i = 0; i < rows.n_elem; i++){
+                if(b == b2 && i > j){
+                    continue;
+                }
+                std::complex<double> value = - block(i, j);
+                if(b == b2 && i == j){
+                    int v = bandToIndex.at(basisStates(rows(i), 0));
+                    int c = bandToIndex.at(basisStates(rows(i), 1));
+                    value = this->scissor + eigvalKQStack(c, k_index) - eigvalKStack(v, k_index) - std::real(block(i, j));
+                }
+                H(rows(i), cols(j)) = (T)value;
+                H(cols(j), rows(i)) = (T)std::conj(value);
+            }
+        }
+
+        long int done;
+        #pragma omp atomic capture
+        { completedBlocks++; done = completedBlocks; }
+        if ((100*done)/totalBlocks != (100*(done - 1))/totalBlocks){
+            reportProgress("bse", (double)done/totalBlocks);
+        }
+    }
+    checkCancelled("bse");
+}
+
+/**
+ * Computes the coupling block of the full BSE in a dense matrix.
+ * @details Only the upper triangle is computed; the lower one is filled by symmetry
+ * (the block is complex symmetric, not Hermitian).
+ * @param B Matrix where the coupling block is stored.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
  * @return void
  */
-void Exciton::BShamiltonian(const arma::imat& basis){
+void Exciton::assembleCoupling(arma::cx_mat& B, const arma::imat& basisStates){
+
+    long int basisDimBSE = basisStates.n_rows;
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(basisDimBSE, sizeof(std::complex<double>));
+    B.set_size(basisDimBSE, basisDimBSE);
+    firstTouch(B, tile, nthreads);
+    BLASThreadGuard blasThreads(1);
+
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        if (cancelled_){
+            continue;
+        }
+        for(long int i = 0; i <= j; i++){
+            B(i, j) = couplingMatrixElement(basisStates, i, j);
+        }
+    }
+    checkCancelled("bse");
+
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        for(long int i = j + 1; i < basisDimBSE; i++){
+            B(i, j) = B(j, i);
+        }
+    }
+}
 
+/**
+ * Returns the global factor through which the dielectric constants enter the interaction,
+ * 1/eps_bar with eps_bar = (eps_m + eps_s)/2 for the Keldysh potential, or 1/eps_r for Coulomb.
+ * @return Dielectric factor of the potential.
+ */
+double Exciton::dielectricFactor() const {
+    if (interactionType == "keldysh"){
+        return 2./(eps_m + eps_s);
+    }
+    return 1./eps_r;
+}
+
+/**
+ * Builds and stores separately the kinetic, direct and exchange parts of the BSE matrix, so
+ * that it can be recombined for other dielectric constants, scissor or exchange setting
+ * without computing the kernel again (see recombineBSE and sweepSpectra).
+ * @details The interaction parts are stored for the current dielectric constants and rescaled
+ * with dielectricFactor() when recombined. The exchange part is always computed, and with
+ * density fitting both parts use the fitted kernel, whose fit then includes the exchange
+ * densities. The energy window is applied as in BShamiltonian. Requires initializeHamiltonian() first; the three
+ * matrices are stored in memory in double precision, and HBS is recombined at the end.
+ * @return void
+ */
+void Exciton::BShamiltonianComponents(){
+
+    if (spinSectors_ || fullBSE_){
+        throw std::logic_error("BShamiltonianComponents(): not available with spin sectors or the full BSE");
+    }
     arma::imat basisStates = this->basisStates;
-    if (!basis.is_empty()){
-        basisStates = basis;
-    };
+    windowIndices_.reset();
+    if (energyWindow_ > 0){
+        windowIndices_ = pairsWithinEnergyWindow(this->basisStates, energyWindow_);
+        basisStates = this->basisStates.rows(windowIndices_);
+        log() << "Energy window of " << energyWindow_ << " eV: " << basisStates.n_rows << " of "
+              << this->basisStates.n_rows << " electron-hole pairs kept" << std::endl;
+        if (basisStates.is_empty()){
+            throw std::invalid_argument("BShamiltonianComponents(): no electron-hole pairs within the energy window");
+        }
+    }
+    long int basisDimBSE = basisStates.n_rows;
+    log() << "BSE dimension: " << basisDimBSE << std::endl;
 
-    int basisDimBSE = basisStates.n_rows;
-    std::cout << "BSE dimension: " << basisDimBSE << std::endl;
-    std::cout << "Initializing Bethe-Salpeter matrix... " << std::flush;
+    // The exchange needs the motif FT at Q, which is only computed when it is enabled
+    if (mode == "realspace" && !exchange){
+        double radius = arma::norm(bravaisLattice.row(0)) * cutoff_;
+        this->ftMotifQ = motifFTMatrix(this->Q, truncateSupercell(ncell, radius));
+    }
+    if (isdfTolerance_ > 0 && mode == "realspace"){
+        // The fit covers the densities of the exchange part, which is always computed
+        bool withExchange = this->exchange;
+        this->exchange = true;
+        try{
+            initializeDensityFitting(basisStates);
+        }
+        catch(...){
+            this->exchange = withExchange;
+            throw;
+        }
+        this->exchange = withExchange;
+    }
+    else{
+        isdfAtoms_.reset();
+        isdfKernelStack_.reset();
+    }
+    HBSTiles_.reset();
+    HBSCompressed_.reset();
+    HBSf_.reset();
+    HBS_.reset();
+    HBSReal_.reset();
+
+    log() << "Initializing Bethe-Salpeter matrix components... " << std::flush;
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(basisDimBSE, sizeof(std::complex<double>));
+    HD_.set_size(basisDimBSE, basisDimBSE);
+    HX_.set_size(basisDimBSE, basisDimBSE);
+    firstTouch(HD_, tile, nthreads);
+    firstTouch(HX_, tile, nthreads);
+    BLASThreadGuard blasThreads(1);
+
+    long int totalElements = basisDimBSE*(basisDimBSE + 1)/2;
+    long int completedElements = 0;
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        if (cancelled_){
+            continue;
+        }
+        std::complex<double> D, X;
+        for(long int i = 0; i <= j; i++){
+            interactionTerms(basisStates, i, j, D, X, true);
+            HD_(i, j) = D;
+            HX_(i, j) = X;
+        }
 
-    HBS_ = arma::zeros<cx_mat>(basisDimBSE, basisDimBSE);
-    HK_   = arma::zeros<arma::mat>(basisDimBSE, basisDimBSE);
-    
-    // To be able to parallelize over the triangular matrix, we build
-    long int loopLength = basisDimBSE*(basisDimBSE + 1)/2.;
+        long int done;
+        #pragma omp atomic capture
+        { completedElements += j + 1; done = completedElements; }
+        if ((100*done)/totalElements != (100*(done - j - 1))/totalElements){
+            reportProgress("bse", (double)done/totalElements);
+        }
+    }
+    checkCancelled("bse");
 
-    // https://stackoverflow.com/questions/242711/algorithm-for-index-numbers-of-triangular-matrix-coefficients
-    #pragma omp parallel for
-    for(long int n = 0; n < loopLength; n++){
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int j = 0; j < basisDimBSE; j++){
+        for(long int i = j + 1; i < basisDimBSE; i++){
+            HD_(i, j) = std::conj(HD_(j, i));
+            HX_(i, j) = std::conj(HX_(j, i));
+        }
+    }
 
-        arma::cx_vec coefsK, coefsK2, coefsKQ, coefsK2Q;
+    HK_ = arma::zeros(basisDimBSE, basisDimBSE);
+    for(long int i = 0; i < basisDimBSE; i++){
+        int k_index = basisStates(i, 2);
+        int v = bandToIndex.at(basisStates(i, 0));
+        int c = bandToIndex.at(basisStates(i, 1));
+        HK_(i, i) = eigvalKQStack(c, k_index) - eigvalKStack(v, k_index);
+    }
+    this->componentsFactor_ = dielectricFactor();
+    log() << "Done" << std::endl;
 
-        long int ii = loopLength - 1 - n;
-        long int m  = floor((sqrt(8*ii + 1) - 1)/2);
-        long int i = basisDimBSE - 1 - m;
-        long int j = basisDimBSE - 1 - ii + m*(m+1)/2;
-    
-        double k_index = basisStates(i, 2);
-        int v = bandToIndex[basisStates(i, 0)];
-        int c = bandToIndex[basisStates(i, 1)];
-        int kQ_index = k_index;
+    recombineBSE();
+}
 
-        double k2_index = basisStates(j, 2);
-        int v2 = bandToIndex[basisStates(j, 0)];
-        int c2 = bandToIndex[basisStates(j, 1)];
-        int k2Q_index = k2_index;
+/**
+ * Recombines the stored parts of the BSE into HBS for the current dielectric constants,
+ * scissor and exchange setting.
+ * @return void
+ */
+void Exciton::recombineBSE(){
+    if (HD_.is_empty()){
+        throw std::logic_error("recombineBSE(): BSE components must be built first with BShamiltonianComponents()");
+    }
+    double scale = dielectricFactor()/componentsFactor_;
+    if (exchange){
+        HBS_ = -scale*(HD_ - HX_);
+    }
+    else{
+        HBS_ = -scale*HD_;
+    }
+    HBS_.diag() = arma::conv_to<arma::cx_vec>::from(scissor + HK_.diag() + arma::real(HBS_.diag()));
+}
 
-        // Using the atomic gauge
-        if(gauge == "atomic"){
-            coefsK = latticeToAtomicGauge(eigvecKStack.slice(k_index).col(v), kpoints.row(k_index));
-            coefsKQ = latticeToAtomicGauge(eigvecKQStack.slice(kQ_index).col(c), kpoints.row(kQ_index));
-            coefsK2 = latticeToAtomicGauge(eigvecKStack.slice(k2_index).col(v2), kpoints.row(k2_index));
-            coefsK2Q = latticeToAtomicGauge(eigvecKQStack.slice(k2Q_index).col(c2), kpoints.row(k2Q_index));
+/**
+ * Computes the exciton energies for a grid of parameters, reusing the kernel.
+ * @details Each row of the grid holds the parameters of one spectrum: {eps_m, eps_s, scissor,
+ * exchange} for the Keldysh potential, or {eps_r, scissor, exchange} for Coulomb (exchange is
+ * enabled if non-zero). The screening length r0 and the cutoff enter the motif FT, and can be
+ * swept with the extended rows {eps_m, eps_s, r0, cutoff, scissor, exchange} or {eps_r, cutoff,
+ * scissor, exchange}: whenever they change from one row to the next, the motif FT and the BSE
+ * components are computed again (keeping the bands), so rows sharing them should be consecutive.
+ * The BSE components are built on the first call if needed. The original parameters are
+ * restored at the end, recomputing the kernel if r0 or the cutoff changed.
+ * @param grid Matrix with one set of parameters per row.
+ * @param nstates Number of energies stored for each set of parameters.
+ * @param method Method to diagonalize the BSE (see diagonalize).
+ * @return Matrix with the lowest energies of each set of parameters by rows (padded with zeros
+ * if the energy window leaves fewer states).
+ */
+arma::mat Exciton::sweepSpectra(const arma::mat& grid, int nstates, const std::string& method){
+    bool keldysh = (interactionType == "keldysh");
+    arma::uword nparameters = keldysh ? 4 : 3;
+    // Extra columns with the parameters of the kernel: r0 and cutoff, or only the cutoff
+    arma::uword nkernel = keldysh ? 2 : 1;
+    bool kernelColumns = (grid.n_cols == nparameters + nkernel);
+    if (grid.n_cols != nparameters && !kernelColumns){
+        throw std::invalid_argument("sweepSpectra(): grid must have " + std::to_string(nparameters) + " or " +
+                                    std::to_string(nparameters + nkernel) + " columns");
+    }
+    if (kernelColumns && arma::any(grid.col(keldysh ? 3 : 1) <= 0)){
+        throw std::invalid_argument("sweepSpectra(): cutoff must be positive");
+    }
+    if (HD_.is_empty()){
+        BShamiltonianComponents();
+    }
+    nstates = std::min(nstates, (int)HD_.n_rows);
+
+    // The original parameters are restored on exit, also if a diagonalization throws
+    struct ParameterGuard {
+        Exciton& exciton;
+        double epsM, epsS, epsR, scissor, r0, cutoff;
+        bool exchange;
+        ~ParameterGuard(){
+            exciton.eps_m_ = epsM;
+            exciton.eps_s_ = epsS;
+            exciton.eps_r_ = epsR;
+            exciton.scissor_ = scissor;
+            exciton.exchange = exchange;
+            bool restoreKernel = (exciton.r0_ != r0 || exciton.cutoff_ != cutoff);
+            try{
+                if (restoreKernel){
+                    exciton.r0_ = r0;
+                    exciton.cutoff_ = cutoff;
+                    exciton.initializeInteractionKernel();
+                    exciton.BShamiltonianComponents();
+                }
+                exciton.recombineBSE();
+            }
+            catch(...){
+                // A motif FT left incomplete must not be reused by other excitons
+                if (restoreKernel){
+                    exciton.ftMotifStack.reset();
+                }
+                exciton.HD_.reset();
+                exciton.HX_.reset();
+                exciton.HBS_.reset();
+            }
+        }
+    } guard{*this, eps_m_, eps_s_, eps_r_, scissor_, r0_, cutoff_, this->exchange};
+
+    arma::mat energies(grid.n_rows, nstates, arma::fill::zeros);
+    for(arma::uword p = 0; p < grid.n_rows; p++){
+        if (keldysh){
+            this->eps_m_ = grid(p, 0);
+            this->eps_s_ = grid(p, 1);
         }
         else{
-            coefsK = eigvecKStack.slice(k_index).col(v);
-            coefsKQ = eigvecKQStack.slice(kQ_index).col(c);
-            coefsK2 = eigvecKStack.slice(k2_index).col(v2);
-            coefsK2Q = eigvecKQStack.slice(k2Q_index).col(c2);
+            this->eps_r_ = grid(p, 0);
+        }
+        this->scissor_ = grid(p, grid.n_cols - 2);
+        this->exchange = (grid(p, grid.n_cols - 1) != 0);
+        log() << "Sweep point " << p + 1 << "/" << grid.n_rows << std::endl;
+        if (kernelColumns){
+            double r0 = keldysh ? grid(p, 2) : r0_;
+            double cutoff = grid(p, keldysh ? 3 : 1);
+            if (r0 != r0_ || cutoff != cutoff_){
+                this->r0_ = r0;
+                this->cutoff_ = cutoff;
+                initializeInteractionKernel();
+                BShamiltonianComponents();
+            }
         }
+        recombineBSE();
+        Result result = diagonalize(method, nstates);
+        arma::uword nsolved = std::min<arma::uword>(nstates, result.eigval.n_elem);
+        energies.row(p).head(nsolved) = result.eigval.head(nsolved).t();
+    }
 
-        std::complex<double> D, X = 0.0;
-        if (mode == "realspace"){
-            int effective_k_index = findEquivalentPointBZ(kpoints.row(k2_index) - kpoints.row(k_index), ncell);
-            arma::cx_mat motifFT = ftMotifStack.slice(effective_k_index);
-            D = exactInteractionTermMFT(coefsKQ, coefsK2, coefsK2Q, coefsK, motifFT);
-            if(this->exchange){
-                X = exactInteractionTermMFT(coefsKQ, coefsK2, coefsK, coefsK2Q, this->ftMotifQ);
-            }            
+    return energies;
+}
+
+/**
+ * Builds the upper triangle of the BSE matrix tile by tile in a memory-mapped file.
+ * @details The columns of each tile are computed in parallel, and the tile is handed to the
+ * kernel to be written back as soon as it is complete, so only the tile being assembled
+ * needs to be resident in memory.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+void Exciton::BShamiltonianOutOfCore(const arma::imat& basisStates){
+
+    long int basisDimBSE = basisStates.n_rows;
+    log() << "Initializing Bethe-Salpeter matrix out of core (" << outOfCoreDirectory_ << ")... " << std::flush;
+
+    HBS_.reset();
+    HK_.reset();
+    HBSTiles_.reset();
+    HBSTiles_.reset(new TiledMatrix(outOfCoreDirectory_, basisDimBSE, tileColumns_));
+
+    int nthreads = stageThreads("bse");
+    BLASThreadGuard blasThreads(1);
+
+    long int totalElements = basisDimBSE*(basisDimBSE + 1)/2;
+    for(int t = 0; t < HBSTiles_->ntiles && !cancelled_; t++){
+        arma::cx_mat panel = HBSTiles_->tile(t);
+        long int first = HBSTiles_->firstColumn(t);
+        long int last = HBSTiles_->lastColumn(t);
+
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for(long int jl = 0; jl < (long int)panel.n_cols; jl++){
+            if (cancelled_){
+                continue;
+            }
+            long int j = first + jl;
+            for(long int i = 0; i <= j; i++){
+                panel(i, jl) = BSEMatrixElement(basisStates, i, j);
+            }
         }
-        else if (mode == "reciprocalspace"){
-            arma::rowvec k = kpoints.row(k_index);
-            arma::rowvec k2 = kpoints.row(k2_index);
-            D = interactionTermFT(coefsK, coefsK2, coefsKQ, coefsK2Q, k, k2, k, k2, this->nReciprocalVectors);
-            if(this->exchange){
-                X = interactionTermFT(coefsK2Q, coefsK2, coefsKQ, coefsK, k2 + Q, k2, k + Q, k, this->nReciprocalVectors);
+        HBSTiles_->completeTile(t);
+
+        long int completedElements = (last + 1)*(last + 2)/2;
+        reportProgress("bse", (double)completedElements/totalElements);
+    }
+    checkCancelled("bse");
+    log() << "Done" << std::endl;
+}
+
+/**
+ * Splits the k points of the mesh in clusters of nearby points by recursive coordinate bisection.
+ * @param leafSize Maximum number of k points per cluster.
+ * @return Indices of the k points of each cluster.
+ */
+std::vector<arma::uvec> Exciton::kpointClusters(arma::uword leafSize) const {
+    std::vector<arma::uvec> clusters;
+    std::vector<arma::uvec> pending = {arma::regspace<arma::uvec>(0, kpoints.n_rows - 1)};
+    while(!pending.empty()){
+        arma::uvec indices = pending.back();
+        pending.pop_back();
+        if(indices.n_elem <= leafSize){
+            clusters.push_back(indices);
+            continue;
+        }
+        // Split along the direction of largest extent
+        arma::mat points = kpoints.rows(indices);
+        arma::uword axis = arma::index_max(arma::max(points, 0) - arma::min(points, 0));
+        arma::uvec order = arma::stable_sort_index(points.col(axis));
+        arma::uword half = indices.n_elem/2;
+        pending.push_back(arma::uvec(indices(order.subvec(half, indices.n_elem - 1))));
+        pending.push_back(arma::uvec(indices(order.subvec(0, half - 1))));
+    }
+    return clusters;
+}
+
+/**
+ * Builds the BSE matrix in block-low-rank form.
+ * @details The k points are split in clusters of about sqrt(nk) points, and each cluster of
+ * k points defines the cluster of electron-hole pairs built on them. Two clusters are admissible
+ * (compressed) when the distance between their centers, taken as the minimum over the periodic
+ * images of the reciprocal lattice, exceeds the diameter of both. The kinetic term only enters
+ * the diagonal blocks, which are stored dense.
+ * @param basisStates Electron-hole pair basis used to build the BSE.
+ * @return void
+ */
+void Exciton::BShamiltonianCompressed(const arma::imat& basisStates){
+
+    log() << "Initializing Bethe-Salpeter matrix (block-low-rank, tol. " << compressionTolerance_ << ")... " << std::flush;
+
+    HBS_.reset();
+    HK_.reset();
+    HBSf_.reset();
+    HBSCompressed_.reset();
+
+    arma::uword nk = kpoints.n_rows;
+    arma::uword leafSize = std::max<arma::uword>(4, (arma::uword)std::sqrt((double)nk));
+    std::vector<arma::uvec> kClusters = kpointClusters(leafSize);
+
+    // Clusters of electron-hole pairs, dropping those left empty by a basis subset
+    arma::uvec clusterOfK(nk);
+    for(unsigned int c = 0; c < kClusters.size(); c++){
+        clusterOfK(kClusters[c]).fill(c);
+    }
+    std::vector<std::vector<arma::uword>> members(kClusters.size());
+    for(arma::uword i = 0; i < basisStates.n_rows; i++){
+        members[clusterOfK(basisStates(i, 2))].push_back(i);
+    }
+    std::vector<arma::uvec> clusters;
+    arma::mat centers(0, 3);
+    arma::vec radii;
+    for(unsigned int c = 0; c < kClusters.size(); c++){
+        if(members[c].empty()){
+            continue;
+        }
+        clusters.push_back(arma::uvec(members[c]));
+        arma::mat points = kpoints.rows(kClusters[c]);
+        arma::rowvec center = arma::mean(points, 0);
+        points.each_row() -= center;
+        centers.insert_rows(centers.n_rows, center);
+        radii.insert_rows(radii.n_elem, arma::vec{arma::max(arma::sqrt(arma::sum(arma::square(points), 1)))});
+    }
+
+    // Admissibility with the periodic distance between cluster centers
+    arma::mat images = generateCombinations(3, ndim, true)*reciprocalLattice;
+    arma::uword nclusters = clusters.size();
+    arma::umat admissible = arma::zeros<arma::umat>(nclusters, nclusters);
+    for(arma::uword I = 0; I < nclusters; I++){
+        for(arma::uword J = I + 1; J < nclusters; J++){
+            arma::mat separations = images;
+            separations.each_row() += centers.row(I) - centers.row(J);
+            double distance = arma::min(arma::sqrt(arma::sum(arma::square(separations), 1)));
+            admissible(I, J) = admissible(J, I) = (2*std::max(radii(I), radii(J)) < distance);
+        }
+    }
+
+    // Blocks are built concurrently, so BLAS (used in the recompression) must run single-threaded
+    int nthreads = stageThreads("bse");
+    BLASThreadGuard blasThreads(1);
+    checkCancelled("bse");
+    HBSCompressed_.reset(new BlockLowRankMatrix(
+        [this, &basisStates](arma::uword i, arma::uword j){ return BSEMatrixElement(basisStates, i, j); },
+        clusters, admissible, compressionTolerance_, nthreads));
+    reportProgress("bse", 1.);
+    checkCancelled("bse");
+    log() << "Done" << std::endl;
+
+    log() << "Block-low-rank BSE: " << HBSCompressed_->lowRankBlocks() << " low-rank and "
+          << HBSCompressed_->denseBlocks() << " dense blocks, compression ratio "
+          << HBSCompressed_->compressionRatio() << std::endl;
+}
+
+/**
+ * Computes the product of the double precision BSE with a block of vectors, without storing it.
+ * @details In real space with the exact kernel the product is evaluated from the pair densities
+ * (see applyBSEDensities), without computing the matrix elements. Otherwise the matrix is rebuilt
+ * in panels of columns (upper triangle plus the diagonal block) which are discarded after being
+ * multiplied, so each product costs as much as one assembly of the BSE but only needs the memory
+ * of one panel.
+ * @param basis Electron-hole pair basis of the BSE.
+ * @param X Block of vectors by columns.
+ * @return Product of the BSE with X.
+ */
+arma::cx_mat Exciton::applyBSE(const arma::imat& basis, const arma::cx_mat& X) const {
+
+    if(mode == "realspace" && isdfKernelStack_.is_empty()){
+        return applyBSEDensities(basis, X);
+    }
+
+    long int n = basis.n_rows;
+    long int width = std::max(1L, (64L << 20)/(n*(long int)sizeof(std::complex<double>)));
+    int nthreads = stageThreads("bse");
+    arma::cx_mat Y(n, X.n_cols, arma::fill::zeros);
+
+    for(long int c0 = 0; c0 < n; c0 += width){
+        long int c1 = std::min(c0 + width, n) - 1;
+        arma::cx_mat panel(c1 + 1, c1 - c0 + 1);
+
+        {
+            BLASThreadGuard blasThreads(1);
+            #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+            for(long int jl = 0; jl <= c1 - c0; jl++){
+                long int j = c0 + jl;
+                for(long int i = 0; i <= j; i++){
+                    panel(i, jl) = BSEMatrixElement(basis, i, j);
+                }
             }
         }
-        
-        if (i == j){
-            HBS_(i, j) = (this->scissor + 
-                          eigvalKQStack.col(kQ_index)(c) - eigvalKStack.col(k_index)(v))/2. 
-                          - (D - X)/2.;
-            HK_(i, j) = eigvalKQStack(c, kQ_index) - eigvalKStack(v, k_index);
-            
+        for(long int jl = 0; jl <= c1 - c0; jl++){
+            for(long int i = c0 + jl + 1; i <= c1; i++){
+                panel(i, jl) = std::conj(panel(c0 + jl, i - c0));
+            }
+        }
+
+        BLASThreadGuard blasThreads(solverThreads_ > 0 ? solverThreads_ : stageThreads("solver"));
+        Y.rows(0, c1) += panel*X.rows(c0, c1);
+        if(c0 > 0){
+            Y.rows(c0, c1) += panel.rows(0, c0 - 1).t()*X.rows(0, c0 - 1);
         }
-        else{
-            HBS_(i, j) =  - (D - X);
-        };
     }
-       
-    HBS_ = HBS + HBS.t();
-    std::cout << "Done" << std::endl;
-};
+
+    return Y;
+}
+
+/**
+ * Computes the product of the double precision BSE with a block of vectors from the pair
+ * densities, in real space with the exact kernel.
+ * @details The direct term of the element between pairs {v,c,k} and {v',c',k'} is
+ * sum_{o,p} conj(c_k(o)) v_k(p) M_{a(o)b(p)}(k'-k) c'_k'(o) conj(v'_k'(p)), with a(o) the atom
+ * of orbital o. Its product with a vector x is then obtained contracting first, for each k',
+ * T_k'(o,p) = sum_{v'c'} c'_k'(o) x_{v'c'k'} conj(v'_k'(p)); then W_k = sum_k' M(k'-k) T_k'
+ * orbital by orbital, and finally each pair at k with W_k. This costs O(nk^2 norb^2) per vector
+ * and allocates nothing per element. The exchange term is separable in the densities of each
+ * pair, and the diagonal is corrected to match BSEMatrixElement (real interaction term plus
+ * the kinetic energy and the scissor).
+ * @param basis Electron-hole pair basis of the BSE.
+ * @param X Block of vectors by columns.
+ * @return Product of the BSE with X.
+ */
+arma::cx_mat Exciton::applyBSEDensities(const arma::imat& basis, const arma::cx_mat& X) const {
+
+    long int n = basis.n_rows;
+    int norb = basisdim;
+    int nthreads = stageThreads("bse");
+    BLASThreadGuard blasThreads(1);
+
+    // Pairs grouped by k, with their coefficients, atom-resolved exchange densities and
+    // kinetic plus diagonal correction of the interaction
+    std::vector<std::vector<arma::uword>> pairsAtK(nk);
+    for(long int i = 0; i < n; i++){
+        pairsAtK[basis(i, 2)].push_back(i);
+    }
+    arma::cx_mat coefsV(norb, n), coefsC(norb, n);
+    arma::cx_mat densities(natoms, n, arma::fill::zeros);
+    arma::cx_vec diagonalShift(n);
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(nthreads)
+    for(long int i = 0; i < n; i++){
+        arma::cx_vec coefsK, coefsKQ;
+        pairCoefficients(basis, i, coefsK, coefsKQ);
+        coefsV.col(i) = coefsK;
+        coefsC.col(i) = coefsKQ;
+        for(int o = 0; o < norb; o++){
+            densities(orbitalAtom_(o), i) += std::conj(coefsKQ(o))*coefsK(o);
+        }
+        std::complex<double> D, Xc;
+        interactionTerms(basis, i, i, D, Xc, this->exchange);
+        int k_index = basis(i, 2);
+        int v = bandToIndex.at(basis(i, 0));
+        int c = bandToIndex.at(basis(i, 1));
+        double kinetic = this->scissor + eigvalKQStack(c, k_index) - eigvalKStack(v, k_index);
+        diagonalShift(i) = std::complex<double>(kinetic, std::imag(D - Xc));
+    }
+
+    // Atom pair of each pair of orbitals, and columns processed together to bound the memory of T
+    arma::uvec atomPair(norb*norb);
+    for(int p = 0; p < norb; p++){
+        for(int o = 0; o < norb; o++){
+            atomPair(o + norb*p) = orbitalAtom_(o) + natoms*orbitalAtom_(p);
+        }
+    }
+    long int chunk = std::max(1L, (64L << 20)/((long int)nk*norb*norb*(long int)sizeof(std::complex<double>)));
+
+    arma::cx_mat Y(n, X.n_cols);
+    for(arma::uword col0 = 0; col0 < X.n_cols; col0 += chunk){
+        arma::uword col1 = std::min<arma::uword>(col0 + chunk, X.n_cols) - 1;
+        int m = col1 - col0 + 1;
+
+        arma::cx_cube T(norb*norb, m, nk, arma::fill::zeros);
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for(int k2 = 0; k2 < nk; k2++){
+            for(arma::uword j : pairsAtK[k2]){
+                for(int col = 0; col < m; col++){
+                    std::complex<double> x = X(j, col0 + col);
+                    std::complex<double>* t = T.slice_colptr(k2, col);
+                    for(int p = 0; p < norb; p++){
+                        std::complex<double> xv = x*std::conj(coefsV(p, j));
+                        for(int o = 0; o < norb; o++){
+                            t[o + norb*p] += coefsC(o, j)*xv;
+                        }
+                    }
+                }
+            }
+        }
+
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for(int k = 0; k < nk; k++){
+            if(pairsAtK[k].empty()){
+                continue;
+            }
+            arma::cx_mat W(norb*norb, m, arma::fill::zeros);
+            for(int k2 = 0; k2 < nk; k2++){
+                if(pairsAtK[k2].empty()){
+                    continue;
+                }
+                int q = findEquivalentPointBZ(kpoints.row(k2) - kpoints.row(k), ncell);
+                const std::complex<double>* M = ftMotifStack.slice_memptr(q);
+                for(int col = 0; col < m; col++){
+                    const std::complex<double>* t = T.slice_colptr(k2, col);
+                    std::complex<double>* w = W.colptr(col);
+                    for(int op = 0; op < norb*norb; op++){
+                        w[op] += M[atomPair(op)]*t[op];
+                    }
+                }
+            }
+            for(arma::uword i : pairsAtK[k]){
+                for(int col = 0; col < m; col++){
+                    const std::complex<double>* w = W.colptr(col);
+                    std::complex<double> direct = 0;
+                    for(int p = 0; p < norb; p++){
+                        std::complex<double> row = 0;
+                        for(int o = 0; o < norb; o++){
+                            row += std::conj(coefsC(o, i))*w[o + norb*p];
+                        }
+                        direct += row*coefsV(p, i);
+                    }
+                    Y(i, col0 + col) = -direct;
+                }
+            }
+        }
+    }
+
+    if(this->exchange){
+        Y += densities.st()*(ftMotifQ*(arma::conj(densities)*X));
+    }
+    Y += arma::diagmat(diagonalShift)*X;
+
+    return Y;
+}
+
+/**
+ * Refines approximate eigenpairs of the single precision BSE against the double precision
+ * one with Rayleigh-Ritz steps on the space spanned by the current eigenvectors and their
+ * diagonal-preconditioned residuals, until the residuals are below the tolerance.
+ * @details All the products use the double precision operator (see applyBSE), so the
+ * eigenpairs converge to those of the double precision BSE. The residual norms
+ * ||A y - mu y|| before and after the refinement are printed, and the final ones, evaluated
+ * with a new product with the double precision operator, are stored (refinementResiduals).
+ * @param eigval Approximate eigenvalues, overwritten with the refined ones.
+ * @param eigvec Approximate eigenvectors by columns, overwritten with the refined ones.
+ * @param basis Electron-hole pair basis of the BSE.
+ * @param diagonal Diagonal of the BSE, used as preconditioner.
+ * @param tolerance Maximum residual norm of the refined eigenpairs.
+ * @param maxIterations Maximum number of Rayleigh-Ritz steps.
+ * @return void
+ */
+void Exciton::refineEigenpairs(arma::vec& eigval, arma::cx_mat& eigvec, const arma::imat& basis,
+                               const arma::vec& diagonal, double tolerance, int maxIterations){
+
+    if(HBSf_.n_rows != basis.n_rows){
+        throw std::logic_error("refineEigenpairs(): the single precision BSE must be built first");
+    }
+    int nstates = eigvec.n_cols;
+    arma::cx_mat X, R;
+    arma::qr_econ(X, R, eigvec);
+    arma::cx_mat AX = applyBSE(basis, X);
+
+    arma::vec residualsBefore;
+    int iteration = 0;
+    for(; iteration < maxIterations; iteration++){
+        checkCancelled("solver");
+
+        // Residuals of the current eigenpairs with the double precision operator
+        arma::vec theta = arma::real(arma::sum(arma::conj(X) % AX, 0)).t();
+        arma::cx_mat residuals = AX - X*arma::diagmat(arma::conv_to<arma::cx_vec>::from(theta));
+        arma::vec norms(nstates);
+        arma::cx_mat corrections(X.n_rows, nstates);
+        for(int j = 0; j < nstates; j++){
+            norms(j) = arma::norm(residuals.col(j));
+            arma::vec denominator = theta(j) - diagonal;
+            denominator.transform([](double d){ return (std::abs(d) < 1E-8) ? 1E-8 : d; });
+            corrections.col(j) = residuals.col(j) / arma::conv_to<arma::cx_vec>::from(denominator);
+        }
+        if(iteration == 0){
+            residualsBefore = norms;
+        }
+        if(norms.max() < tolerance){
+            break;
+        }
+
+        // Only the corrections of the states not yet converged extend the space
+        corrections = arma::cx_mat(corrections.cols(arma::find(norms >= tolerance)));
+        for(int pass = 0; pass < 2; pass++){
+            corrections -= X*(X.t()*corrections);
+        }
+        for(arma::uword j = 0; j < corrections.n_cols; j++){
+            double norm = arma::norm(corrections.col(j));
+            if(norm > 0){
+                corrections.col(j) /= norm;
+            }
+        }
+
+        // Rayleigh-Ritz on span{X, corrections}, orthonormalized through the overlap matrix
+        // so that linearly dependent corrections are dropped
+        arma::cx_mat AC = applyBSE(basis, corrections);
+        arma::cx_mat V = arma::join_rows(X, corrections);
+        arma::cx_mat AV = arma::join_rows(AX, AC);
+        arma::vec overlapEigval;
+        arma::cx_mat overlapEigvec;
+        arma::eig_sym(overlapEigval, overlapEigvec, arma::cx_mat(V.t()*V));
+        arma::uvec independent = arma::find(overlapEigval > 1E-10*arma::max(overlapEigval));
+        arma::cx_mat W = overlapEigvec.cols(independent) *
+                         arma::diagmat(arma::conv_to<arma::cx_vec>::from(1./arma::sqrt(overlapEigval(independent))));
+        arma::cx_mat G = W.t()*(V.t()*AV)*W;
+        G = 0.5*(G + G.t());
+        arma::vec mu;
+        arma::cx_mat S;
+        arma::eig_sym(mu, S, G);
+
+        arma::cx_mat rotation = W*S.cols(0, nstates - 1);
+        X = V*rotation;
+        AX = AV*rotation;
+    }
+
+    // Residuals of the refined eigenpairs, with a new product with the double precision operator
+    arma::cx_mat AY = applyBSE(basis, X);
+    arma::vec mu = arma::real(arma::sum(arma::conj(X) % AY, 0)).t();
+    this->residuals_ = arma::vec(nstates);
+    for(int j = 0; j < nstates; j++){
+        residuals_(j) = arma::norm(AY.col(j) - mu(j)*X.col(j));
+    }
+    arma::uvec order = arma::sort_index(mu);
+    arma::vec refined = mu(order);
+    double maxShift = arma::max(arma::abs(refined - eigval));
+    eigval = refined;
+    eigvec = X.cols(order);
+    residuals_ = arma::vec(residuals_(order));
+
+    log() << "Mixed precision refinement (" << iteration << " iterations): max. residual "
+          << arma::max(residualsBefore) << " -> " << arma::max(residuals_) << ", max. eigenvalue shift "
+          << maxShift << std::endl;
+    if(residuals_.max() >= tolerance){
+        log() << "Warning: mixed precision refinement did not reach the requested tolerance" << std::endl;
+    }
+}
 
 /**
  * Routine to diagonalize the BSE and return a Result object.
  * @param method Method to diagonalize the BSE, either 'diag' (standard diagonalization) 
- * 'davidson' (iterative diagonalization) or 'sparse' (Lanczos).
+ * 'davidson' (iterative diagonalization) or 'sparse' (Lanczos). With out-of-core storage
+ * or block-low-rank compression only 'davidson' is available.
  * @param nstates Number of states to be stored from the diagonalization.
  * @return Result object storing the exciton energies and states.
  */ 
 Result Exciton::diagonalize(std::string method, int nstates){
-    std::cout << "Solving BSE with ";
+    log() << "Solving BSE with ";
     arma::vec eigval;
     arma::cx_mat eigvec;
 
-    if (method == "diag"){
-        std::cout << "exact diagonalization... " << std::flush;
+    // Dense LAPACK/ARPACK solvers cannot be interrupted, so for them the cancellation is
+    // only checked before they start
+    reportProgress("solver", 0.);
+    checkCancelled("solver");
+
+    // The eigensolver is a single dense LAPACK call, so it gets all the threads of its stage
+    BLASThreadGuard blasThreads(solverThreads_ > 0 ? solverThreads_ : stageThreads("solver"));
+    converged_ = true;
+
+    // The Davidson method is interrupted at its next product with the BSE once cancelled
+    auto cancellable = [this](const BlockMatVec& matvec) -> BlockMatVec {
+        return [this, matvec](const arma::cx_mat& X){
+            checkCancelled("solver");
+            return matvec(X);
+        };
+    };
+
+    if (fullBSE_){
+        if (method != "diag"){
+            throw std::invalid_argument("diagonalize(): full BSE can only be solved with the diag method");
+        }
+        if (HBSCoupling_.is_empty() && HBSCouplingReal_.is_empty()){
+            throw std::logic_error("diagonalize(): BShamiltonian() must be called after enabling the full BSE");
+        }
+        if (!HBSReal_.is_empty()){
+            log() << "product form of the full BSE (real arithmetic)... " << std::flush;
+            arma::mat X, Y;
+            product_form_method(eigval, X, Y, HBSReal_, HBSCouplingReal_);
+            eigvec = fromRealBasis(arma::conv_to<arma::cx_mat>::from(X));
+            antiresonant_ = arma::conj(fromRealBasis(arma::conv_to<arma::cx_mat>::from(Y)));
+        }
+        else if (arma::abs(arma::imag(HBS)).max() <= 1E-12*arma::abs(HBS).max() &&
+                 arma::abs(arma::imag(HBSCoupling_)).max() <= 1E-12*arma::abs(HBS).max()){
+            // A and B may already be real in the pair basis
+            log() << "product form of the full BSE (real blocks)... " << std::flush;
+            arma::mat X, Y;
+            product_form_method(eigval, X, Y, arma::real(HBS), arma::real(HBSCoupling_));
+            eigvec = arma::conv_to<arma::cx_mat>::from(X);
+            antiresonant_ = arma::conv_to<arma::cx_mat>::from(Y);
+        }
+        else{
+            log() << "product form of the full BSE (complex blocks)... " << std::flush;
+            complex_product_form_method(eigval, eigvec, antiresonant_, HBS, HBSCoupling_);
+        }
+    }
+    else if (!HBSReal_.is_empty()){
+        if (method != "diag" && method != "davidson"){
+            throw std::invalid_argument("diagonalize(): real BSE can only be solved with the diag or davidson methods");
+        }
+        arma::cx_mat realBasisEigvec;
+        if (method == "diag"){
+            log() << "exact diagonalization (real arithmetic)... " << std::flush;
+            arma::mat realEigvec;
+            arma::eig_sym(eigval, realEigvec, HBSReal_);
+            realBasisEigvec = arma::conv_to<arma::cx_mat>::from(realEigvec);
+        }
+        else{
+            log() << "Davidson method (real arithmetic)... " << std::flush;
+            const arma::mat& H = HBSReal_;
+            converged_ &= davidson_method(eigval, realBasisEigvec, cancellable([&H](const arma::cx_mat& X){
+                                return arma::cx_mat(H*arma::real(X), H*arma::imag(X));
+                            }), arma::vec(H.diag()), nstates);
+        }
+        eigvec = fromRealBasis(realBasisEigvec);
+    }
+    else if (!HBSSectors_.empty()){
+        if (method != "diag" && method != "davidson"){
+            throw std::invalid_argument("diagonalize(): spin sectors can only be solved with the diag or davidson methods");
+        }
+        log() << (method == "diag" ? "exact diagonalization" : "Davidson method") << " by spin sectors... " << std::flush;
+
+        // Eigenpairs of all sectors, embedded in the basis of the BSE and sorted by energy
+        std::vector<arma::vec> sectorEigval(HBSSectors_.size());
+        std::vector<arma::cx_mat> sectorEigvec(HBSSectors_.size());
+        for(unsigned int s = 0; s < HBSSectors_.size(); s++){
+            int nsectorStates = std::min(nstates, (int)HBSSectors_[s].n_rows);
+            if (method == "diag" || nsectorStates == (int)HBSSectors_[s].n_rows){
+                arma::eig_sym(sectorEigval[s], sectorEigvec[s], HBSSectors_[s]);
+            }
+            else{
+                const arma::cx_mat& H = HBSSectors_[s];
+                converged_ &= davidson_method(sectorEigval[s], sectorEigvec[s],
+                                              cancellable([&H](const arma::cx_mat& X){ return arma::cx_mat(H*X); }),
+                                              arma::vec(arma::real(H.diag())), nsectorStates);
+            }
+            sectorEigval[s] = sectorEigval[s].subvec(0, sectorEigvec[s].n_cols - 1);
+        }
+
+        arma::uword nsolved = 0;
+        for(unsigned int s = 0; s < HBSSectors_.size(); s++){
+            nsolved += sectorEigval[s].n_elem;
+        }
+        eigval.set_size(nsolved);
+        eigvec = arma::zeros<arma::cx_mat>(basisBSE_.n_rows, nsolved);
+        arma::uword offset = 0;
+        for(unsigned int s = 0; s < HBSSectors_.size(); s++){
+            arma::uword n = sectorEigval[s].n_elem;
+            eigval.subvec(offset, offset + n - 1) = sectorEigval[s];
+            eigvec.submat(sectorIndices_[s], arma::regspace<arma::uvec>(offset, offset + n - 1)) = sectorEigvec[s];
+            offset += n;
+        }
+        arma::uvec order = arma::stable_sort_index(eigval);
+        if (method == "davidson"){
+            order = order.subvec(0, std::min<arma::uword>(nstates, order.n_elem) - 1);
+        }
+        eigval = arma::vec(eigval(order));
+        eigvec = arma::cx_mat(eigvec.cols(order));
+    }
+    else if (HBSTiles_){
+        if (method != "davidson"){
+            throw std::invalid_argument("diagonalize(): out-of-core BSE can only be solved with the davidson method");
+        }
+        log() << "matrix-free Davidson method (out of core)... " << std::flush;
+        const TiledMatrix& tiles = *HBSTiles_;
+        converged_ &= davidson_method(eigval, eigvec, cancellable([&tiles](const arma::cx_mat& X){ return tiles.multiply(X); }),
+                        tiles.diagonal, nstates);
+    }
+    else if (HBSCompressed_){
+        if (method != "davidson"){
+            throw std::invalid_argument("diagonalize(): block-low-rank BSE can only be solved with the davidson method");
+        }
+        log() << "matrix-free Davidson method (block-low-rank)... " << std::flush;
+        const BlockLowRankMatrix& H = *HBSCompressed_;
+        converged_ &= davidson_method(eigval, eigvec, cancellable([&H](const arma::cx_mat& X){ return H.multiply(X); }),
+                        H.diagonal, nstates);
+    }
+    else if (precision_ == "single"){
+        if (method != "diag" && method != "davidson"){
+            throw std::invalid_argument("diagonalize(): single precision BSE can only be solved with the diag or davidson methods");
+        }
+        nstates = std::min(nstates, (int)HBSf_.n_rows);
+        if (method == "diag"){
+            log() << "exact diagonalization (single precision)... " << std::flush;
+            arma::fvec eigvalSingle;
+            arma::cx_fmat eigvecSingle;
+            arma::eig_sym(eigvalSingle, eigvecSingle, HBSf_);
+            eigval = arma::conv_to<arma::vec>::from(eigvalSingle);
+            eigvec = arma::conv_to<arma::cx_mat>::from(arma::cx_fmat(eigvecSingle.cols(0, nstates - 1)));
+        }
+        else{
+            log() << "Davidson method (single precision)... " << std::flush;
+            const arma::cx_fmat& H = HBSf_;
+            arma::vec diagonal = arma::conv_to<arma::vec>::from(arma::real(H.diag()));
+            converged_ &= davidson_method(eigval, eigvec, cancellable([&H](const arma::cx_mat& X){
+                                return arma::conv_to<arma::cx_mat>::from(H*arma::conv_to<arma::cx_fmat>::from(X));
+                            }), diagonal, nstates);
+        }
+    }
+    else if (method == "diag"){
+        log() << "exact diagonalization... " << std::flush;
         arma::eig_sym(eigval, eigvec, HBS);
     }
+    else if (method == "davidson" && warmStart_.n_rows == HBS.n_rows && !warmStart_.is_empty()){
+        log() << "Davidson method (warm start)... " << std::flush;
+        const arma::cx_mat& H = HBS;
+        converged_ &= davidson_method(eigval, eigvec, cancellable([&H](const arma::cx_mat& X){ return arma::cx_mat(H*X); }),
+                        arma::vec(arma::real(H.diag())), nstates, 1E-6, 200, warmStart_);
+        warmStart_.reset();
+    }
     else if (method == "davidson"){
-        std::cout << "Davidson method... " << std::flush;
-        davidson_method(eigval, eigvec, HBS, nstates);
+        log() << "Davidson method... " << std::flush;
+        const arma::cx_mat& H = HBS;
+        converged_ &= davidson_method(eigval, eigvec, cancellable([&H](const arma::cx_mat& X){ return arma::cx_mat(H*X); }),
+                                      arma::vec(arma::real(H.diag())), nstates);
     }
     else if (method == "sparse"){
-        std::cout << "Lanczos method..." << std::flush;
+        log() << "Lanczos method..." << std::flush;
 
         arma::cx_vec cx_eigval;
         arma::eigs_gen(cx_eigval, eigvec, arma::sp_cx_mat(HBS), nstates, "sr");
         eigval = arma::sort(real(cx_eigval));
     }
     
-    std::cout << "Done" << std::endl;
+    log() << "Done" << std::endl;
+    if (!converged_){
+        log() << "Warning: Davidson method did not reach the requested tolerance" << std::endl;
+    }
+
+    // The requested states are refined against the double precision operator
+    if (precision_ == "single" && !HBSTiles_ && !HBSCompressed_){
+        arma::vec refinedEigval = eigval.subvec(0, nstates - 1);
+        arma::vec diagonal = arma::conv_to<arma::vec>::from(arma::real(HBSf_.diag()));
+        refineEigenpairs(refinedEigval, eigvec, basisBSE_, diagonal);
+        eigval.subvec(0, nstates - 1) = refinedEigval;
+    }
+
+    // Pairs outside the energy window have zero weight in the states
+    if (!windowIndices_.is_empty()){
+        arma::cx_mat fullEigvec = arma::zeros<arma::cx_mat>(basisStates.n_rows, eigvec.n_cols);
+        fullEigvec.rows(windowIndices_) = eigvec;
+        eigvec = fullEigvec;
+        if (!antiresonant_.is_empty()){
+            arma::cx_mat fullAntiresonant = arma::zeros<arma::cx_mat>(basisStates.n_rows, antiresonant_.n_cols);
+            fullAntiresonant.rows(windowIndices_) = antiresonant_;
+            antiresonant_ = fullAntiresonant;
+        }
+    }
+
+    reportProgress("solver", 1.);
+    checkCancelled("solver");
     Result results = Result(*this, eigval, eigvec);
 
     return results;
 }
 
+/**
+ * Computes the exciton band structure along a path of center-of-mass momenta.
+ * @details For each Q an exciton is built reusing the bands at k and the motif FT of this one
+ * (which must be initialized), so only the bands at k+Q, the exchange motif FT at Q and the BSE
+ * are computed. The path is split in parallelQ contiguous segments processed concurrently; along
+ * each segment, the states of the previous Q are used as initial guess of the Davidson method.
+ * The stages of each Q run inside the parallel region, so without nested parallelism they are
+ * serial, and parallelQ should then be close to the number of cores; with several segments
+ * BLAS also runs single-threaded. The bands at k and the motif FT are read in place from this
+ * exciton instead of being copied for each Q. The excitons of each Q take the settings of this
+ * one (see copySettings), and report their stages to its progress callback.
+ * @param Qpath Matrix with one center-of-mass momentum per row.
+ * @param nstates Number of energies stored for each Q.
+ * @param method Method to diagonalize the BSE (see diagonalize).
+ * @param parallelQ Number of Q points computed concurrently.
+ * @param triangular Boolean to specify whether the single-particle Hamiltonian matrices are triangular.
+ * @return Matrix with the lowest exciton energies of each Q by rows (padded with zeros if the
+ * energy window leaves fewer states).
+ */
+arma::mat Exciton::excitonDispersion(const arma::mat& Qpath, int nstates, const std::string& method,
+                                     int parallelQ, bool triangular){
+    if(eigvecKStack.is_empty()){
+        throw std::logic_error("excitonDispersion(): initializeHamiltonian() must be called first");
+    }
+    if(Qpath.n_cols != 3){
+        throw std::invalid_argument("excitonDispersion(): Q points must be 3d vectors");
+    }
+    if(parallelQ < 1){
+        throw std::invalid_argument("excitonDispersion(): number of parallel Q points must be positive");
+    }
+    if((realArithmetic_ || fullBSE_) && arma::abs(Qpath).max() != 0){
+        throw std::invalid_argument("excitonDispersion(): real arithmetic and full BSE require Q = 0");
+    }
+
+    int nQ = Qpath.n_rows;
+    int nsegments = std::min(parallelQ, nQ);
+    nstates = std::min(nstates, excitonbasisdim);
+    arma::rowvec parameters = (interactionType == "keldysh") ? arma::rowvec{eps_m, eps_s, r0} : arma::rowvec{eps_r};
+    arma::mat energies(nQ, nstates, arma::fill::zeros);
+
+    log() << "Computing exciton dispersion on " << nQ << " Q points (" << nsegments << " in parallel)..." << std::endl;
+    int completed = 0;
+    // The flag stops the other segments; the exception itself is only accessed in the critical section
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    int segmentSolverThreads = (nsegments > 1) ? 1 : 0;
+    BLASThreadGuard blasThreads((nsegments > 1) ? 1 : 0);
+    #pragma omp parallel for schedule(static, 1) num_threads(nsegments)
+    for(int segment = 0; segment < nsegments; segment++){
+        arma::cx_mat guess;
+        for(int q = (segment*nQ)/nsegments; q < ((segment + 1)*nQ)/nsegments; q++){
+            if (cancelled_ || failed){
+                break;
+            }
+            try{
+                Exciton excitonQ(static_cast<const System&>(*this), ncell, bands, parameters, Qpath.row(q), interactionType);
+                excitonQ.copySettings(*this);
+                excitonQ.nk_ = nk_;
+                excitonQ.factor_ = factor_;
+                excitonQ.kpoints_ = kpoints_;
+                excitonQ.meshBZ_ = meshBZ_;
+                excitonQ.totalCells_ = totalCells_;
+                excitonQ.setSilent(silent_ || nsegments > 1);
+                // The stages of each Q are reported to the callback of this exciton, and stopped
+                // when it is cancelled
+                excitonQ.progressCallback_ = [this](const std::string& stage, double fraction){
+                    return (!progressCallback_ || progressCallback_(stage, fraction)) && !cancelled_;
+                };
+                excitonQ.solverThreads_ = segmentSolverThreads;
+                excitonQ.shareReferenceStacks_ = true;
+
+                excitonQ.initializeHamiltonian(*this, triangular);
+                excitonQ.BShamiltonian();
+                if (method == "davidson"){
+                    excitonQ.warmStart_ = guess;
+                }
+                Result result = excitonQ.diagonalize(method, nstates);
+                // The energy window may leave fewer pairs than states requested
+                arma::uword nsolved = std::min<arma::uword>(nstates, result.eigval.n_elem);
+                energies.row(q).head(nsolved) = result.eigval.head(nsolved).t();
+                guess = result.eigvec.cols(0, std::min<arma::uword>(nstates, result.eigvec.n_cols) - 1);
+            }
+            catch(...){
+                #pragma omp critical(dispersionError)
+                {
+                    if (!error){
+                        error = std::current_exception();
+                    }
+                }
+                failed = true;
+                break;
+            }
+
+            #pragma omp critical(dispersionProgress)
+            {
+                completed++;
+                log() << "Q point " << q + 1 << " (" << completed << "/" << nQ << " done)" << std::endl;
+                reportProgress("dispersion", (double)completed/nQ);
+            }
+        }
+    }
+    if (failed){
+        // A cancellation has already stopped the excitons of each Q, and must not carry over
+        cancelled_ = false;
+        std::rethrow_exception(error);
+    }
+    checkCancelled("dispersion");
+
+    return energies;
+}
+
 // ------------- Symmetries -------------
 /**
  * Method to obtain the C3 rotation operator in the basis of electron-hole pairs of the exciton.
  * @return Matrix representation of C3. 
  */
-arma::mat Exciton::C3ExcitonBasisRep(){
-    calculateInverseReciprocalMatrix();
+arma::mat Exciton::C3ExcitonBasisRep() const {
     arma::mat C3 = arma::zeros(excitonbasisdim, excitonbasisdim);
     int nbandCombinations = valenceBands.n_elem * conductionBands.n_elem;
     if(kpoints.empty()){
@@ -1070,9 +3854,9 @@ cx_vec Exciton::ehPairCoefs(double energy, const vec& gapEnergy, std::string sid
             currentEnergy = eDiff;
         };
     };
-    cout << closestKindex << endl;
-    cout << "Selected k: " << kpoints(closestKindex) << "\t" << closestKindex << endl;
-    cout << "Closest gap energy: " << gapEnergy(closestKindex) << endl;
+    log() << closestKindex << endl;
+    log() << "Selected k: " << kpoints(closestKindex) << "\t" << closestKindex << endl;
+    log() << "Closest gap energy: " << gapEnergy(closestKindex) << endl;
     // By virtue of band symmetry, we expect n < nk/2
     double dispersion = PI/(16*a);
     if(side == "left"){
@@ -1082,8 +3866,8 @@ cx_vec Exciton::ehPairCoefs(double energy, const vec& gapEnergy, std::string sid
         coefs(nk - 1 - closestKindex) = 1.;
     }
 
-    cout << "Energy gap (-k): " << gapEnergy(closestKindex) << endl;
-    cout << "Energy gap (k): " << gapEnergy(nk - 1 - closestKindex) << endl;
+    log() << "Energy gap (-k): " << gapEnergy(closestKindex) << endl;
+    log() << "Energy gap (k): " << gapEnergy(nk - 1 - closestKindex) << endl;
 
     return coefs;
 };
@@ -1104,7 +3888,8 @@ double Exciton::fermiGoldenRule(const Exciton& targetExciton, const arma::cx_vec
     cx_mat W = arma::zeros<cx_mat>(finalBasis.n_rows, initialBasis.n_rows);
 
     // -------- Main loop (W initialization) --------
-    #pragma omp parallel for schedule(static, 1) collapse(2)
+    BLASThreadGuard blasThreads(1);
+    #pragma omp parallel for schedule(static, 1) collapse(2) num_threads(stageThreads("bse"))
     for (int i = 0; i < finalBasis.n_rows; i++){
         for (int j = 0; j < initialBasis.n_rows; j++){
 
@@ -1114,36 +3899,35 @@ double Exciton::fermiGoldenRule(const Exciton& targetExciton, const arma::cx_vec
             int cf = targetExciton.bandToIndex.at(finalBasis(i, 1));
             double kf_index = finalBasis(i, 2);
             
-            int vi = bandToIndex[initialBasis(j, 0)];
-            int ci = bandToIndex[initialBasis(j, 1)];
+            int vi = bandToIndex.at(initialBasis(j, 0));
+            int ci = bandToIndex.at(initialBasis(j, 1));
             double ki_index = initialBasis(j, 2);
 
+            coefsK = targetExciton.eigvecKStack.slice(kf_index).col(vf);
+            coefsKQ = targetExciton.eigvecKQStack.slice(kf_index).col(cf);
+            coefsK2 = eigvecKStack.slice(ki_index).col(vi);
+            coefsK2Q = eigvecKQStack.slice(ki_index).col(ci);
+
             // Using the atomic gauge
             if(gauge == "atomic"){
-                coefsK = latticeToAtomicGauge(targetExciton.eigvecKStack.slice(kf_index).col(vf), kpoints.row(kf_index));
-                coefsKQ = latticeToAtomicGauge(targetExciton.eigvecKQStack.slice(kf_index).col(cf), kpoints.row(kf_index));
-                coefsK2 = latticeToAtomicGauge(eigvecKStack.slice(ki_index).col(vi), kpoints.row(ki_index));
-                coefsK2Q = latticeToAtomicGauge(eigvecKQStack.slice(ki_index).col(ci), kpoints.row(ki_index));
-            }
-            else{
-                coefsK = targetExciton.eigvecKStack.slice(kf_index).col(vf);
-                coefsKQ = targetExciton.eigvecKQStack.slice(kf_index).col(cf);
-                coefsK2 = eigvecKStack.slice(ki_index).col(vi);
-                coefsK2Q = eigvecKQStack.slice(ki_index).col(ci);
+                coefsK %= atomicGaugePhases_.col(kf_index);
+                coefsKQ %= atomicGaugePhases_.col(kf_index);
+                coefsK2 %= atomicGaugePhases_.col(ki_index);
+                coefsK2Q %= atomicGaugePhases_.col(ki_index);
             }
 
             std::complex<double> D, X;
             if (mode == "realspace"){
                 int effective_k_index = findEquivalentPointBZ(kpoints.row(ki_index) - kpoints.row(kf_index), ncell);
-                arma::cx_mat motifFT = ftMotifStack.slice(effective_k_index);
-                D = exactInteractionTermMFT(coefsKQ, coefsK2, coefsK2Q, coefsK, motifFT);
+                const arma::cx_mat& motifFT = ftMotifStack.slice(effective_k_index);
+                D = exactInteractionTermMFT(coefsKQ.memptr(), coefsK2.memptr(), coefsK2Q.memptr(), coefsK.memptr(), motifFT);
                 X = 0;
 
             }
             else if (mode == "reciprocalspace"){
-                arma::rowvec k = kpoints.row(kf_index);
-                arma::rowvec k2 = kpoints.row(ki_index);
-                D = interactionTermFT(coefsK, coefsK2, coefsKQ, coefsK2Q, k, k2, k, k2, this->nReciprocalVectors);
+                // Both excitons share the mesh, so the phases and potential are taken from the tables
+                arma::cx_vec phases = orbitalPhasesK_.col(kf_index) % arma::conj(orbitalPhasesK_.col(ki_index));
+                D = interactionTermFT(coefsK, coefsK2, coefsKQ, coefsK2Q, phases, reciprocalPotential(kf_index, ki_index));
                 X = 0;
             }
             
@@ -1153,7 +3937,7 @@ double Exciton::fermiGoldenRule(const Exciton& targetExciton, const arma::cx_vec
 
     double delta = 2.4/(2*ncell); // Adjust delta depending on number of k points
     double rho = targetExciton.pairDensityOfStates(energy, delta);
-    cout << "DoS value: " << rho << endl;
+    log() << "DoS value: " << rho << endl;
     double hbar = 6.582119624E-16; // Units are eV*s
 
     transitionRate = 2*PI*std::norm(arma::cdot(finalState, W*initialState))*rho/hbar;
@@ -1246,8 +4030,8 @@ arma::rowvec Exciton::findElectronHolePair(const Exciton& targetExciton, double
         k = min_k * (1 - currentIndex/n) + max_k * currentIndex/n;
         min_k = kmin;
         max_k = kmax;
-        arma::cout << "Current edge pair energy: " << currentEnergy << arma::endl;
-        arma::cout << "Target energy: " << energy << "\n" << arma::endl;
+        log() << "Current edge pair energy: " << currentEnergy << arma::endl;
+        log() << "Target energy: " << energy << "\n" << arma::endl;
 
         if (currentEnergy == prevEnergy){
             n += 1;
@@ -1255,7 +4039,7 @@ arma::rowvec Exciton::findElectronHolePair(const Exciton& targetExciton, double
         prevEnergy = currentEnergy;
     }
 
-    arma::cout << "k: " << k << arma::endl;
+    log() << "k: " << k << arma::endl;
 
     bool computeOccupations = false;
     if (computeOccupations){
@@ -1266,13 +4050,13 @@ arma::rowvec Exciton::findElectronHolePair(const Exciton& targetExciton, double
         double l_h_edge_occ = arma::norm(coefsK.subvec(0, 15));
         double r_h_edge_occ = arma::norm(coefsK.subvec(N - 16, N - 1));
 
-        std::cout << "left e occ.: " << l_e_edge_occ << "\nright e occ: " << r_e_edge_occ << std::endl;
-        std::cout << "Total e occ.: " << std::sqrt(l_e_edge_occ*l_e_edge_occ + r_e_edge_occ*r_e_edge_occ) << arma::endl;
-        std::cout << "--------------------------------------" << std::endl;
-        std::cout << "left h occ.: " << l_h_edge_occ << "\nright h occ: " << r_h_edge_occ << std::endl;
-        std::cout << "Total h occ.: " << std::sqrt(l_h_edge_occ*l_h_edge_occ + r_h_edge_occ*r_h_edge_occ) << arma::endl;
-        std::cout << "--------------------------------------" << std::endl;
-        std::cout << "Total e-h pair edge occu.: " << std::sqrt(l_e_edge_occ*l_e_edge_occ + r_e_edge_occ*r_e_edge_occ) + 
+        log() << "left e occ.: " << l_e_edge_occ << "\nright e occ: " << r_e_edge_occ << std::endl;
+        log() << "Total e occ.: " << std::sqrt(l_e_edge_occ*l_e_edge_occ + r_e_edge_occ*r_e_edge_occ) << arma::endl;
+        log() << "--------------------------------------" << std::endl;
+        log() << "left h occ.: " << l_h_edge_occ << "\nright h occ: " << r_h_edge_occ << std::endl;
+        log() << "Total h occ.: " << std::sqrt(l_h_edge_occ*l_h_edge_occ + r_h_edge_occ*r_h_edge_occ) << arma::endl;
+        log() << "--------------------------------------" << std::endl;
+        log() << "Total e-h pair edge occu.: " << std::sqrt(l_e_edge_occ*l_e_edge_occ + r_e_edge_occ*r_e_edge_occ) + 
                     std::sqrt(l_h_edge_occ*l_h_edge_occ + r_h_edge_occ*r_h_edge_occ) << std::endl;
     }
 
@@ -1341,37 +4125,44 @@ double Exciton::edgeFermiGoldenRule(const Exciton& targetExciton, const arma::cx
     }
     
     arma::cx_vec W = arma::zeros<arma::cx_vec>(initialBasis.n_rows);
+    arma::cx_vec phasesEdge = (mode == "reciprocalspace") ? orbitalPhases(k) : arma::cx_vec();
 
     // -------- Main loop (W initialization) --------
-    #pragma omp parallel for
+    BLASThreadGuard blasThreads(1);
+    #pragma omp parallel for num_threads(stageThreads("bse"))
     for (int i = 0; i < initialBasis.n_rows; i++){
 
         arma::cx_vec coefsK2, coefsK2Q;
         
-        int vi = bandToIndex[initialBasis(i, 0)];
-        int ci = bandToIndex[initialBasis(i, 1)];
+        int vi = bandToIndex.at(initialBasis(i, 0));
+        int ci = bandToIndex.at(initialBasis(i, 1));
         double ki_index = initialBasis(i, 2);
 
+        coefsK2 = eigvecKStack.slice(ki_index).col(vi);
+        coefsK2Q = eigvecKQStack.slice(ki_index).col(ci);
+
         // Using the atomic gauge
         if(gauge == "atomic"){
-            coefsK2 = latticeToAtomicGauge(eigvecKStack.slice(ki_index).col(vi), kpoints.row(ki_index));
-            coefsK2Q = latticeToAtomicGauge(eigvecKQStack.slice(ki_index).col(ci), kpoints.row(ki_index));
-        }
-        else{
-            coefsK2 = eigvecKStack.slice(ki_index).col(vi);
-            coefsK2Q = eigvecKQStack.slice(ki_index).col(ci);
+            coefsK2 %= atomicGaugePhases_.col(ki_index);
+            coefsK2Q %= atomicGaugePhases_.col(ki_index);
         }
 
         std::complex<double> D, X;
         if (mode == "realspace"){
-            arma::cx_mat motifFT = ftMotifStack.slice(ki_index);
-            D = exactInteractionTermMFT(coefsKQ, coefsK2, coefsK2Q, coefsK, motifFT);
+            const arma::cx_mat& motifFT = ftMotifStack.slice(ki_index);
+            D = exactInteractionTermMFT(coefsKQ.memptr(), coefsK2.memptr(), coefsK2Q.memptr(), coefsK.memptr(), motifFT);
             X = 0;
 
         }
         else if (mode == "reciprocalspace"){
+            // The edge k is not on the mesh, so only the phases at k' are tabulated
             arma::rowvec k2 = kpoints.row(ki_index);
-            D = interactionTermFT(coefsK, coefsK2, coefsKQ, coefsK2Q, k, k2, k, k2, this->nReciprocalVectors);
+            arma::cx_vec phases = phasesEdge % arma::conj(orbitalPhasesK_.col(ki_index));
+            arma::vec potential(reciprocalVectors_.n_rows);
+            for(arma::uword g = 0; g < reciprocalVectors_.n_rows; g++){
+                potential(g) = potentialFT(k - k2 + reciprocalVectors_.row(g));
+            }
+            D = interactionTermFT(coefsK, coefsK2, coefsKQ, coefsK2Q, phases, potential);
             X = 0;
         }
         
@@ -1380,7 +4171,7 @@ double Exciton::edgeFermiGoldenRule(const Exciton& targetExciton, const arma::cx
 
     double delta = 2.0/targetExciton.nk; // Adjust delta depending on number of k points
     double rho = targetExciton.pairDensityOfStates(energy, delta);
-    cout << "DoS value: " << rho << endl;
+    log() << "DoS value: " << rho << endl;
     double hbar = 6.582119624E-16; // Units are eV*s
 
     transitionRate = (ncell*a)*2*PI*std::norm(arma::dot(W, initialState))*rho/hbar;
@@ -1393,35 +4184,35 @@ double Exciton::edgeFermiGoldenRule(const Exciton& targetExciton, const arma::cx
  * @return void 
  */
 void Exciton::printInformation(){
-    cout << std::left << std::setw(30) << "Number of cells: " << ncell << endl;
-    cout << std::left << std::setw(30) << "Valence bands:";
+    log() << std::left << std::setw(30) << "Number of cells: " << ncell << endl;
+    log() << std::left << std::setw(30) << "Valence bands:";
     for (int i = 0; i < valenceBands.n_elem; i++){
-        cout << valenceBands(i) << "\t";
+        log() << valenceBands(i) << "\t";
     }
-    cout << endl;
+    log() << endl;
 
-    cout << std::left << std::setw(30) << "Conduction bands: ";
+    log() << std::left << std::setw(30) << "Conduction bands: ";
     for (int i = 0; i < conductionBands.n_elem; i++){
-        cout << conductionBands(i) << "\t";
+        log() << conductionBands(i) << "\t";
     }
-    cout << "\n" << endl;
+    log() << "\n" << endl;
 
-    cout << std::left << std::setw(30) << "Gauge used: " << gauge << endl;
-    cout << std::left << std::setw(30) << "Calculation mode: " << mode << endl;
+    log() << std::left << std::setw(30) << "Gauge used: " << gauge << endl;
+    log() << std::left << std::setw(30) << "Calculation mode: " << mode << endl;
     if(mode == "reciprocalspace"){
-        cout << std::left << std::setw(30) << "nG: " << nReciprocalVectors << endl;
+        log() << std::left << std::setw(30) << "nG: " << nReciprocalVectors << endl;
     }
     if(exchange){
-        cout << std::left << std::setw(30) << "Exchange: " << (exchange ? "True" : "False") << endl;
+        log() << std::left << std::setw(30) << "Exchange: " << (exchange ? "True" : "False") << endl;
     }
     if(arma::norm(Q) > 1E-7){
-        cout << std::left << std::setw(30) << "Q: "; 
+        log() << std::left << std::setw(30) << "Q: "; 
         for (auto qi : Q){
-            cout << qi << "  ";
+            log() << qi << "  ";
         }
-        cout << endl;
+        log() << endl;
     }
-    cout << std::left << std::setw(30) << "Scissor cut: " << scissor_ << endl;
+    log() << std::left << std::setw(30) << "Scissor cut: " << scissor_ << endl;
 }
 
 }
\ No newline at end of file
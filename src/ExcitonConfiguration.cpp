@@ -101,6 +101,36 @@ void ExcitonConfiguration::parseContent(){
         else if (arg == "interaction") {
             excitonInfo.interactionType = content[0];
         }
+        else if(arg == "energywindow"){
+            excitonInfo.energyWindow = parseScalar<double>(content[0]);
+        }
+        else if(arg == "spinsectors"){
+            std::string str = content[0];
+            str.erase(std::remove_if(str.begin(), str.end(), isspace), str.end());
+            std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+            if ((str != "true") && (str != "false")){
+                throw std::invalid_argument("Spin sectors option must be set to 'true' or 'false'.");
+            }
+            excitonInfo.spinSectors = (str == "true");
+        }
+        else if(arg == "realarithmetic"){
+            std::string str = content[0];
+            str.erase(std::remove_if(str.begin(), str.end(), isspace), str.end());
+            std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+            if ((str != "true") && (str != "false")){
+                throw std::invalid_argument("Real arithmetic option must be set to 'true' or 'false'.");
+            }
+            excitonInfo.realArithmetic = (str == "true");
+        }
+        else if(arg == "fullbse"){
+            std::string str = content[0];
+            str.erase(std::remove_if(str.begin(), str.end(), isspace), str.end());
+            std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+            if ((str != "true") && (str != "false")){
+                throw std::invalid_argument("Full BSE option must be set to 'true' or 'false'.");
+            }
+            excitonInfo.fullBSE = (str == "true");
+        }
         else{    
             std::cout << "Unexpected argument: " << arg << ", skipping block..." << std::endl;
         }
@@ -136,6 +166,9 @@ void ExcitonConfiguration::checkContentCoherence(){
     if (excitonInfo.interactionType == "keldysh" && excitonInfo.eps.n_elem != 3) {
         throw std::invalid_argument("Must have three dielectric constants for Keldysh potential");
     }
+    if (excitonInfo.energyWindow < 0) {
+        throw std::invalid_argument("Energy window must be a positive number");
+    }
 };
 
 }
\ No newline at end of file
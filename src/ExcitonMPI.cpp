@@ -0,0 +1,601 @@
+#ifdef XATU_MPI
+#include <armadillo>
+#include <algorithm>
+#include <complex>
+#include <cmath>
+#include <string>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "xatu/ExcitonMPI.hpp"
+#include "xatu/threading.hpp"
+
+// BLACS and ScaLAPACK routines
+extern "C" {
+    int  Csys2blacs_handle(MPI_Comm);
+    void Cblacs_gridinit(int*, const char*, int, int);
+    void Cblacs_gridinfo(int, int*, int*, int*, int*);
+    void Cblacs_gridexit(int);
+    int  numroc_(const int*, const int*, const int*, const int*, const int*);
+    void descinit_(int*, const int*, const int*, const int*, const int*, const int*, const int*,
+                   const int*, const int*, int*);
+    void pzheevd_(const char*, const char*, const int*, std::complex<double>*, const int*, const int*,
+                  const int*, double*, std::complex<double>*, const int*, const int*, const int*,
+                  std::complex<double>*, const int*, double*, const int*, int*, const int*, int*);
+    void pzgemr2d_(const int*, const int*, const std::complex<double>*, const int*, const int*, const int*,
+                   std::complex<double>*, const int*, const int*, const int*, const int*);
+}
+
+namespace xatu {
+
+ExcitonMPI::~ExcitonMPI(){
+    freeSharedWindows();
+    if(nodeComm_ != MPI_COMM_NULL){
+        MPI_Comm_free(&nodeComm_);
+    }
+    if(leaderComm_ != MPI_COMM_NULL){
+        MPI_Comm_free(&leaderComm_);
+    }
+    if(context_ >= 0){
+        Cblacs_gridexit(context_);
+    }
+}
+
+/**
+ * Splits a range of n items in contiguous blocks, as even as possible.
+ * @param n Number of items.
+ * @param parts Number of blocks.
+ * @param index Index of the block.
+ * @param start Returns the first item of the block.
+ * @param count Returns the number of items of the block.
+ * @return void
+ */
+static void blockRange(int n, int parts, int index, int& start, int& count){
+    count = n/parts + ((index < n % parts) ? 1 : 0);
+    start = index*(n/parts) + std::min(index, n % parts);
+}
+
+/**
+ * Sets the MPI communicator over which the calculation is distributed (default MPI_COMM_WORLD).
+ * @param comm MPI communicator.
+ * @return void
+ */
+void ExcitonMPI::setCommunicator(MPI_Comm comm){
+    if(context_ >= 0){
+        throw std::logic_error("setCommunicator(): communicator must be set before initializing the Hamiltonian");
+    }
+    comm_ = comm;
+}
+
+/**
+ * Sets the block size of the block-cyclic distribution of the BSE matrix.
+ * @param blockSize Number of rows and columns of each block.
+ * @return void
+ */
+void ExcitonMPI::setBlockSize(int blockSize){
+    if(blockSize <= 0){
+        throw std::invalid_argument("setBlockSize(): block size must be a positive integer");
+    }
+    blockSize_ = blockSize;
+}
+
+/**
+ * Creates the BLACS process grid, as square as the number of processes allows.
+ * @details Only the root process prints progress messages.
+ * @return void
+ */
+void ExcitonMPI::initializeGrid(){
+    if(context_ >= 0){
+        return;
+    }
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm_size(comm_, &nprocs_);
+    if(rank_ != 0){
+        setSilent(true);
+    }
+
+    nprow_ = (int)std::sqrt((double)nprocs_);
+    while(nprocs_ % nprow_ != 0){
+        nprow_--;
+    }
+    npcol_ = nprocs_/nprow_;
+
+    context_ = Csys2blacs_handle(comm_);
+    Cblacs_gridinit(&context_, "Row", nprow_, npcol_);
+    Cblacs_gridinfo(context_, &nprow_, &npcol_, &myrow_, &mycol_);
+
+    initializeNodeCommunicators();
+}
+
+/**
+ * Groups the ranks that share memory (i.e. run on the same node), and creates a communicator
+ * with one leader rank per node.
+ * @return void
+ */
+void ExcitonMPI::initializeNodeCommunicators(){
+    MPI_Comm_split_type(comm_, MPI_COMM_TYPE_SHARED, rank_, MPI_INFO_NULL, &nodeComm_);
+    MPI_Comm_rank(nodeComm_, &nodeRank_);
+    MPI_Comm_size(nodeComm_, &nodeSize_);
+
+    MPI_Comm_split(comm_, (nodeRank_ == 0) ? 0 : MPI_UNDEFINED, rank_, &leaderComm_);
+    if(leaderComm_ != MPI_COMM_NULL){
+        MPI_Comm_rank(leaderComm_, &nodeIndex_);
+        MPI_Comm_size(leaderComm_, &nnodes_);
+    }
+    MPI_Bcast(&nodeIndex_, 1, MPI_INT, 0, nodeComm_);
+    MPI_Bcast(&nnodes_, 1, MPI_INT, 0, nodeComm_);
+}
+
+/**
+ * Returns the items of a k point loop assigned to this rank. Nodes get contiguous blocks,
+ * which are split again among the ranks of each node.
+ * @param n Number of items.
+ * @param start Returns the first item assigned to the rank.
+ * @param count Returns the number of items assigned to the rank.
+ * @return void
+ */
+void ExcitonMPI::localRange(int n, int& start, int& count) const {
+    int nodeStart, nodeCount;
+    blockRange(n, nnodes_, nodeIndex_, nodeStart, nodeCount);
+    blockRange(nodeCount, nodeSize_, nodeRank_, start, count);
+    start += nodeStart;
+}
+
+/**
+ * Allocates a cube in a shared-memory window of the node. The memory is owned by the
+ * first rank of the node, and the rest of ranks map the same pages.
+ * @details Armadillo objects can not change their memory after construction, so the cube
+ * is rebuilt in place over the window (with a fixed size).
+ * @param cube Cube to allocate.
+ * @param nrows Number of rows.
+ * @param ncols Number of columns.
+ * @param nslices Number of slices.
+ * @return Shared-memory window.
+ */
+template<typename T>
+MPI_Win ExcitonMPI::allocateShared(arma::Cube<T>& cube, arma::uword nrows, arma::uword ncols, arma::uword nslices){
+    arma::uword nelem = std::max<arma::uword>(1, nrows*ncols*nslices);
+    MPI_Aint size = (nodeRank_ == 0) ? (MPI_Aint)(nelem*sizeof(T)) : 0;
+    T* memory;
+    MPI_Win window;
+    MPI_Win_allocate_shared(size, sizeof(T), MPI_INFO_NULL, nodeComm_, &memory, &window);
+    if(nodeRank_ != 0){
+        MPI_Aint ownerSize;
+        int displacement;
+        MPI_Win_shared_query(window, 0, &ownerSize, &displacement, &memory);
+    }
+    windows_.push_back(window);
+    MPI_Win_fence(0, window);
+
+    cube.~Cube();
+    new (&cube) arma::Cube<T>(memory, nrows, ncols, nslices, false, true);
+
+    return window;
+}
+
+/**
+ * Releases the shared-memory windows, leaving the stacks that used them empty.
+ * @return void
+ */
+void ExcitonMPI::freeSharedWindows(){
+    if(windows_.empty()){
+        return;
+    }
+    for(arma::cx_cube* cube : {&eigvecKStack_, &eigvecKQStack_, &ftMotifStack}){
+        cube->~Cube();
+        new (cube) arma::cx_cube();
+    }
+    for(MPI_Win& window : windows_){
+        MPI_Win_free(&window);
+    }
+    windows_.clear();
+}
+
+/**
+ * Completes a node-shared cube whose slices have been computed by the different ranks.
+ * @details The ranks of a node write directly on the shared window; then the node leaders
+ * exchange the blocks of slices computed by their nodes.
+ * @param cube Cube stored in a shared-memory window.
+ * @param n Number of slices distributed among the ranks.
+ * @param window Shared-memory window of the cube.
+ * @return void
+ */
+template<typename T>
+void ExcitonMPI::gatherSlices(arma::Cube<T>& cube, int n, MPI_Win window){
+    MPI_Win_fence(0, window);
+    if(leaderComm_ != MPI_COMM_NULL && nnodes_ > 1){
+        MPI_Datatype sliceType;
+        MPI_Type_contiguous((int)(cube.n_elem_slice*sizeof(T)), MPI_BYTE, &sliceType);
+        MPI_Type_commit(&sliceType);
+
+        std::vector<int> counts(nnodes_), displacements(nnodes_);
+        for(int node = 0; node < nnodes_; node++){
+            blockRange(n, nnodes_, node, displacements[node], counts[node]);
+        }
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, cube.memptr(), counts.data(),
+                       displacements.data(), sliceType, leaderComm_);
+        MPI_Type_free(&sliceType);
+    }
+    MPI_Win_fence(0, window);
+}
+
+/**
+ * Fills a node-shared cube with the content of a cube available in every rank. Only the
+ * node leader writes, since the window holds a single copy per node.
+ * @param cube Cube stored in a shared-memory window.
+ * @param source Cube to copy, with the same dimensions.
+ * @param window Shared-memory window of the cube.
+ * @return void
+ */
+template<typename T>
+void ExcitonMPI::copyShared(arma::Cube<T>& cube, const arma::Cube<T>& source, MPI_Win window){
+    if(nodeRank_ == 0){
+        std::copy(source.memptr(), source.memptr() + source.n_elem, cube.memptr());
+    }
+    MPI_Win_fence(0, window);
+}
+
+/**
+ * Completes a replicated matrix whose columns have been computed by the different ranks.
+ * @param matrix Matrix with one column per item.
+ * @param n Number of columns distributed among the ranks.
+ * @return void
+ */
+void ExcitonMPI::gatherColumns(arma::mat& matrix, int n){
+    int range[2];
+    localRange(n, range[0], range[1]);
+    std::vector<int> ranges(2*nprocs_), counts(nprocs_), displacements(nprocs_);
+    MPI_Allgather(range, 2, MPI_INT, ranges.data(), 2, MPI_INT, comm_);
+    for(int p = 0; p < nprocs_; p++){
+        displacements[p] = ranges[2*p];
+        counts[p] = ranges[2*p + 1];
+    }
+
+    MPI_Datatype columnType;
+    MPI_Type_contiguous((int)matrix.n_rows, MPI_DOUBLE, &columnType);
+    MPI_Type_commit(&columnType);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, matrix.memptr(), counts.data(),
+                   displacements.data(), columnType, comm_);
+    MPI_Type_free(&columnType);
+}
+
+/**
+ * Propagates a cancellation requested in any rank to all of them, and throws if cancelled.
+ * @details Otherwise the ranks that were not cancelled would wait forever in the next collective call.
+ * @param stage Name of the stage being cancelled.
+ * @return void
+ */
+void ExcitonMPI::checkCancelledAll(const std::string& stage){
+    int localCancelled = cancelled_ ? 1 : 0;
+    int anyCancelled = 0;
+    MPI_Allreduce(&localCancelled, &anyCancelled, 1, MPI_INT, MPI_MAX, comm_);
+    if(anyCancelled){
+        cancelled_ = true;
+    }
+    checkCancelled(stage);
+}
+
+/**
+ * Converts a local row or column index of the block-cyclic distribution to the global one.
+ * @param local Local index.
+ * @param proc Row or column of the process in the grid.
+ * @param nprocs Number of rows or columns of the grid.
+ * @return Global index.
+ */
+long int ExcitonMPI::localToGlobal(int local, int proc, int nprocs) const {
+    return ((long int)(local/blockSize_)*nprocs + proc)*blockSize_ + local % blockSize_;
+}
+
+/**
+ * Broadcasts an array from the root process, splitting it in chunks that fit in an MPI count.
+ * @param data Pointer to the array (already allocated in every process).
+ * @param n Number of elements.
+ * @return void
+ */
+template<typename T>
+void ExcitonMPI::broadcast(T* data, arma::uword n){
+    const arma::uword chunk = 1 << 24;
+    for(arma::uword offset = 0; offset < n; offset += chunk){
+        int count = (int)(std::min(chunk, n - offset)*sizeof(T));
+        MPI_Bcast(data + offset, count, MPI_BYTE, 0, comm_);
+    }
+}
+
+/**
+ * Computes the band stacks and motif Fourier transforms distributing the k points among all
+ * the ranks, and stores the eigenvector and motif FT stacks in node-shared windows.
+ * @details The eigenvalues are small, so they are replicated in every rank.
+ * @param triangular Boolean to specify whether the Hamiltonian matrices are triangular.
+ * @return void
+ */
+void ExcitonMPI::initializeResultsH0(bool triangular){
+    if (spinSectors_ || realArithmetic_){
+        throw std::logic_error("ExcitonMPI: spin sectors and real arithmetic are not available in the distributed implementation");
+    }
+    initializeGrid();
+    freeSharedWindows();
+
+    int nTotalBands = bandList.n_elem;
+    int nthreads = stageThreads("bands");
+    MPI_Win windowK  = allocateShared(eigvecKStack_, basisdim, nTotalBands, nk);
+    MPI_Win windowKQ = allocateShared(eigvecKQStack_, basisdim, nTotalBands, nk);
+    this->eigvalKStack_  = arma::mat(nTotalBands, nk);
+    this->eigvalKQStack_ = arma::mat(nTotalBands, nk);
+
+    // Each iteration runs its own diagonalization, so BLAS must not spawn more threads
+    BLASThreadGuard blasThreads(1);
+
+    int start, count;
+    localRange(nk, start, count);
+    int completed = 0;
+    log() << "Diagonalizing H0 for all k points (" << nprocs_ << " processes)... " << std::flush;
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int i = start; i < start + count; i++){
+        if (cancelled_){
+            continue;
+        }
+        initializeBands(i, triangular);
+
+        int done;
+        #pragma omp atomic capture
+        done = ++completed;
+        if ((100*done)/count != (100*(done - 1))/count){
+            reportProgress("bands", (double)done/count);
+        }
+    }
+    checkCancelledAll("bands");
+    gatherSlices(eigvecKStack_, nk, windowK);
+    gatherSlices(eigvecKQStack_, nk, windowKQ);
+    gatherColumns(eigvalKStack_, nk);
+    gatherColumns(eigvalKQStack_, nk);
+    log() << "Done" << std::endl;
+
+    double radius = arma::norm(bravaisLattice.row(0)) * cutoff;
+    arma::mat cells = truncateSupercell(ncell, radius);
+    int nmesh = meshBZ_.n_rows;
+    MPI_Win windowFT = allocateShared(ftMotifStack, natoms, natoms, nmesh);
+    this->ftMotifQ = arma::cx_mat(natoms, natoms);
+
+    if(this->mode == "realspace"){
+        localRange(nmesh, start, count);
+        completed = 0;
+        log() << "Computing lattice Fourier transform (" << nprocs_ << " processes)... " << std::flush;
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for (int i = start; i < start + count; i++){
+            if (cancelled_){
+                continue;
+            }
+            initializeMotifFT(i, cells);
+
+            int done;
+            #pragma omp atomic capture
+            done = ++completed;
+            if ((100*done)/count != (100*(done - 1))/count){
+                reportProgress("motifFT", (double)done/count);
+            }
+        }
+        checkCancelledAll("motifFT");
+        gatherSlices(ftMotifStack, nmesh, windowFT);
+        log() << "Done" << std::endl;
+    }
+
+    if(this->exchange){
+        this->ftMotifQ = motifFTMatrix(this->Q, cells);
+    }
+}
+
+/**
+ * Overload of initializeHamiltonian that reuses the band stacks and motif FT of a previously
+ * initialized exciton, copying them into new node-shared windows.
+ * @details The stacks of the base class cannot be reassigned, since they live in the shared
+ * windows. Only the complete reuse (same bands and same motif FT) is supported; otherwise
+ * everything is recomputed distributed among the ranks.
+ * @param reference Exciton whose single-particle quantities are to be reused.
+ * @param triangular Boolean to specify whether the single-particle Hamiltonian matrices are triangular.
+ * @return void
+ */
+void ExcitonMPI::initializeHamiltonian(const Exciton& reference, bool triangular){
+    if(!hasSameBands(reference) || !hasSameMotifFT(reference)){
+        initializeHamiltonian(triangular);
+        return;
+    }
+    if (spinSectors_ || realArithmetic_){
+        throw std::logic_error("ExcitonMPI: spin sectors and real arithmetic are not available in the distributed implementation");
+    }
+    if(bands.empty()){
+        throw std::invalid_argument("Error: Exciton object must have some bands");
+    }
+    if(nk == 0){
+        throw std::invalid_argument("Error: BZ mesh must be initialized first");
+    }
+
+    this->excitonbasisdim_ = nk*valenceBands.n_elem*conductionBands.n_elem;
+
+    log() << "Initializing basis for BSE... " << std::flush;
+    initializeBasis();
+    generateBandDictionary();
+    initializeMotifKernel();
+    initializeGaugePhases();
+    initializeGrid();
+    freeSharedWindows();
+
+    log() << "Reusing bands of previous calculation" << std::endl;
+    MPI_Win windowK  = allocateShared(eigvecKStack_, basisdim, bandList.n_elem, nk);
+    MPI_Win windowKQ = allocateShared(eigvecKQStack_, basisdim, bandList.n_elem, nk);
+    copyShared(eigvecKStack_, reference.eigvecKStack, windowK);
+    copyShared(eigvecKQStack_, reference.eigvecKQStack, windowKQ);
+    this->eigvalKStack_  = reference.eigvalKStack;
+    this->eigvalKQStack_ = reference.eigvalKQStack;
+
+    log() << "Reusing lattice Fourier transform of previous calculation" << std::endl;
+    MPI_Win windowFT = allocateShared(ftMotifStack, natoms, natoms, meshBZ_.n_rows);
+    copyShared(ftMotifStack, reference.ftMotifStack, windowFT);
+    double scale = dielectricFactor()/reference.dielectricFactor();
+    if(scale != 1){
+        if(nodeRank_ == 0){
+            ftMotifStack *= scale;
+        }
+        MPI_Win_fence(0, windowFT);
+    }
+    this->ftMotifQ = arma::cx_mat(natoms, natoms);
+    if(this->exchange){
+        double radius = arma::norm(bravaisLattice.row(0)) * cutoff;
+        this->ftMotifQ = motifFTMatrix(this->Q, truncateSupercell(ncell, radius));
+    }
+    if(this->mode == "reciprocalspace"){
+        initializeReciprocalKernel();
+    }
+}
+
+/**
+ * Not available in the distributed implementation: extending the bands would reassign the
+ * band stacks stored in the node-shared windows, and the BSE is not stored in a single rank.
+ * @return void
+ */
+void ExcitonMPI::extendBands(const arma::ivec&, const arma::cx_mat&, bool){
+    throw std::logic_error("ExcitonMPI: extendBands() is not available in the distributed implementation");
+}
+
+/**
+ * Assembles the local blocks of the Bethe-Salpeter matrix in the 2D block-cyclic layout.
+ * @details Only the upper triangle is computed, since it is the only part referenced by the
+ * Hermitian eigensolver. Within each process the local columns are distributed among the
+ * OpenMP threads of the 'bse' stage.
+ * @param basis Subset of the exciton basis to build the BSE. If none, defaults to
+ * the complete or original basis.
+ * @return void
+ */
+void ExcitonMPI::BShamiltonian(const arma::imat& basis){
+    initializeGrid();
+
+    arma::imat basisStates = this->basisStates;
+    if (!basis.is_empty()){
+        basisStates = basis;
+    };
+
+    int n = basisStates.n_rows;
+    basisDimBSE_ = n;
+    log() << "BSE dimension: " << n << std::endl;
+    log() << "Initializing distributed Bethe-Salpeter matrix (" << nprow_ << "x" << npcol_
+          << " process grid)... " << std::flush;
+
+    int zero = 0, info;
+    int nrowsLocal = numroc_(&n, &blockSize_, &myrow_, &zero, &nprow_);
+    int ncolsLocal = numroc_(&n, &blockSize_, &mycol_, &zero, &npcol_);
+    int lld = std::max(1, nrowsLocal);
+    descinit_(descHBS_, &n, &n, &blockSize_, &blockSize_, &zero, &zero, &context_, &lld, &info);
+    if(info != 0){
+        throw std::runtime_error("BShamiltonian(): invalid ScaLAPACK descriptor (info = " + std::to_string(info) + ")");
+    }
+
+    int nthreads = stageThreads("bse");
+    int tile = pageTile(nrowsLocal, sizeof(std::complex<double>));
+    HBSLocal_.set_size(nrowsLocal, ncolsLocal);
+    firstTouch(HBSLocal_, tile, nthreads);
+
+    // Matrix elements are computed concurrently, so BLAS must run single-threaded
+    BLASThreadGuard blasThreads(1);
+
+    int completed = 0;
+    #pragma omp parallel for schedule(static, tile) num_threads(nthreads)
+    for(long int jl = 0; jl < ncolsLocal; jl++){
+        if (cancelled_){
+            continue;
+        }
+        long int j = localToGlobal(jl, mycol_, npcol_);
+        for(long int il = 0; il < nrowsLocal; il++){
+            long int i = localToGlobal(il, myrow_, nprow_);
+            if(i > j){
+                break;
+            }
+            HBSLocal_(il, jl) = BSEMatrixElement(basisStates, i, j);
+        }
+
+        int done;
+        #pragma omp atomic capture
+        done = ++completed;
+        if ((100*done)/ncolsLocal != (100*(done - 1))/ncolsLocal){
+            reportProgress("bse", (double)done/ncolsLocal);
+        }
+    }
+
+    checkCancelledAll("bse");
+    log() << "Done" << std::endl;
+}
+
+/**
+ * Diagonalizes the distributed BSE with ScaLAPACK (pzheevd) and returns a Result object.
+ * @details The local blocks of HBS are overwritten by the solver. Every process receives all
+ * the eigenvalues, and the first 'nstates' eigenvectors are gathered and replicated.
+ * @param method Diagonalization method, only 'diag' is supported.
+ * @param nstates Number of eigenvectors to be stored from the diagonalization.
+ * @return Result object storing the exciton energies and states.
+ */
+Result ExcitonMPI::diagonalize(std::string method, int nstates){
+    if(method != "diag"){
+        throw std::invalid_argument("ExcitonMPI::diagonalize(): method must be 'diag'");
+    }
+    if(basisDimBSE_ == 0){
+        throw std::logic_error("ExcitonMPI::diagonalize(): BShamiltonian() must be called first");
+    }
+    int n = basisDimBSE_;
+    nstates = std::max(1, std::min(nstates, n));
+
+    log() << "Solving BSE with ScaLAPACK distributed diagonalization... " << std::flush;
+    reportProgress("solver", 0.);
+    checkCancelledAll("solver");
+    BLASThreadGuard blasThreads(stageThreads("solver"));
+
+    arma::vec eigval(n);
+    arma::cx_mat eigvecLocal(HBSLocal_.n_rows, HBSLocal_.n_cols);
+    int one = 1, zero = 0, info;
+
+    // Workspace query
+    int lwork = -1, lrwork = -1, liwork = -1;
+    std::complex<double> workSize;
+    double rworkSize;
+    int iworkSize;
+    pzheevd_("V", "U", &n, HBSLocal_.memptr(), &one, &one, descHBS_, eigval.memptr(),
+             eigvecLocal.memptr(), &one, &one, descHBS_,
+             &workSize, &lwork, &rworkSize, &lrwork, &iworkSize, &liwork, &info);
+    lwork = (int)std::real(workSize);
+    lrwork = (int)rworkSize;
+    liwork = iworkSize;
+    std::vector<std::complex<double>> work(lwork);
+    std::vector<double> rwork(lrwork);
+    std::vector<int> iwork(liwork);
+
+    pzheevd_("V", "U", &n, HBSLocal_.memptr(), &one, &one, descHBS_, eigval.memptr(),
+             eigvecLocal.memptr(), &one, &one, descHBS_,
+             work.data(), &lwork, rwork.data(), &lrwork, iwork.data(), &liwork, &info);
+    if(info != 0){
+        throw std::runtime_error("ExcitonMPI::diagonalize(): pzheevd failed (info = " + std::to_string(info) + ")");
+    }
+
+    // Gather the first eigenvectors in the root process through a 1x1 grid
+    int rootContext = Csys2blacs_handle(comm_);
+    Cblacs_gridinit(&rootContext, "Row", 1, 1);
+    int descRoot[9] = {0};
+    descRoot[1] = -1;
+    arma::cx_mat eigvec(n, nstates);
+    if(rank_ == 0){
+        descinit_(descRoot, &n, &nstates, &blockSize_, &blockSize_, &zero, &zero, &rootContext, &n, &info);
+    }
+    pzgemr2d_(&n, &nstates, eigvecLocal.memptr(), &one, &one, descHBS_,
+              eigvec.memptr(), &one, &one, descRoot, &context_);
+    if(rank_ == 0){
+        Cblacs_gridexit(rootContext);
+    }
+    broadcast(eigvec.memptr(), eigvec.n_elem);
+
+    log() << "Done" << std::endl;
+    reportProgress("solver", 1.);
+    checkCancelledAll("solver");
+    Result results = Result(*this, eigval, eigvec);
+
+    return results;
+}
+
+}
+#endif
@@ -10,7 +10,7 @@ namespace xatu {
  * @param stateindex Index of exciton.
  * @return Kinetic energy of the exciton.
  */
-double Result::kineticEnergy(int stateindex){
+double Result::kineticEnergy(int stateindex) const {
     arma::cx_vec coefs = eigvec.col(stateindex);
     std::complex<double> energy = arma::cdot(coefs, exciton.HK*coefs);
     return energy.real();
@@ -23,7 +23,7 @@ double Result::kineticEnergy(int stateindex){
  * @param stateindex Index of exciton.
  * @return Potential energy of the exciton.
  */
-double Result::potentialEnergy(int stateindex){
+double Result::potentialEnergy(int stateindex) const {
     arma::cx_vec coefs = eigvec.col(stateindex);
     arma::cx_mat HV = exciton.HBS - exciton.HK;
     std::complex<double> energy = arma::cdot(coefs, HV*coefs);
@@ -39,13 +39,13 @@ double Result::potentialEnergy(int stateindex){
  * @param gap Gap of the system
  * @return Binding energy of the exciton.
  */
-double Result::bindingEnergy(int stateindex, double gap){
+double Result::bindingEnergy(int stateindex, double gap) const {
     double energy;
     if (gap == -1){
         gap = determineGap();
     }
     else if (gap < 0){
-        std::cout << "Provided gap value must be positive" << std::endl;
+        exciton.log() << "Provided gap value must be positive" << std::endl;
     }
 
     energy = eigval(stateindex) - gap;
@@ -58,11 +58,11 @@ double Result::bindingEnergy(int stateindex, double gap){
  * bands that are used in the exciton formation.
  * @return Gap of the system.
  */
-double Result::determineGap(){
+double Result::determineGap() const {
     int stateindex = 0; // Ground state
     int kIndex = findExcitonPeak(stateindex);
-    int valence = exciton.bandToIndex[exciton.valenceBands.max()];
-    int conduction = exciton.bandToIndex[exciton.conductionBands.min()];
+    int valence = exciton.bandToIndex.at(exciton.valenceBands.max());
+    int conduction = exciton.bandToIndex.at(exciton.conductionBands.min());
 
     double gap = exciton.eigvalKStack.col(kIndex)(conduction) - 
                  exciton.eigvalKStack.col(kIndex)(valence);
@@ -77,7 +77,7 @@ double Result::determineGap(){
  * @param stateindex Index of exciton.
  * @return Index of kpoint where the exciton peaks.
  */ 
-int Result::findExcitonPeak(int stateindex){
+int Result::findExcitonPeak(int stateindex) const {
     int index = eigvec.col(stateindex).index_max();
     int bandCombinations = exciton.valenceBands.n_elem*exciton.conductionBands.n_elem;
     index = (int)index/bandCombinations;
@@ -90,7 +90,7 @@ int Result::findExcitonPeak(int stateindex){
  * @param stateindex Index of the exciton.
  * @return Vector with the total spin of the exciton, the spin of the hole and that of the electron
  */
-arma::cx_vec Result::spinX(int stateindex){
+arma::cx_vec Result::spinX(int stateindex) const {
 
     arma::cx_vec coefs = eigvec.col(stateindex);
     
@@ -138,9 +138,9 @@ arma::cx_vec Result::spinX(int stateindex){
         arma::cx_mat spinHoleReduced = arma::zeros<arma::cx_mat>(nvbands, nvbands);
         arma::cx_mat spinElectronReduced = arma::zeros<arma::cx_mat>(ncbands, ncbands);
         for(int i = 0; i < nvbands; i++){
-            int vIndex = exciton.bandToIndex[exciton.valenceBands(i)];
+            int vIndex = exciton.bandToIndex.at(exciton.valenceBands(i));
             for(int j = 0; j < nvbands; j++){
-                int vIndex2 = exciton.bandToIndex[exciton.valenceBands(j)];
+                int vIndex2 = exciton.bandToIndex.at(exciton.valenceBands(j));
                 eigvec = exciton.eigvecKStack.slice(k).col(vIndex);
                 spinEigvec = eigvec % spinVector;
                 eigvec = exciton.eigvecKStack.slice(k).col(vIndex2);
@@ -148,9 +148,9 @@ arma::cx_vec Result::spinX(int stateindex){
             }
         }
         for(int i = 0; i < ncbands; i++){
-            int cIndex = exciton.bandToIndex[exciton.conductionBands(i)];
+            int cIndex = exciton.bandToIndex.at(exciton.conductionBands(i));
             for(int j = 0; j < ncbands; j++){
-                int cIndex2 = exciton.bandToIndex[exciton.conductionBands(j)];
+                int cIndex2 = exciton.bandToIndex.at(exciton.conductionBands(j));
                 eigvec = exciton.eigvecKQStack.slice(k).col(cIndex);
                 spinEigvec = eigvec % spinVector;
                 eigvec = exciton.eigvecKQStack.slice(k).col(cIndex2);
@@ -178,13 +178,13 @@ arma::cx_vec Result::spinX(int stateindex){
  * @param states Vector storing the indices of the states of the degenerate subspace.
  * @return Eigenvectors of C3 in the degenerate exciton basis.
  */
-arma::cx_mat Result::diagonalizeC3(const arma::vec& states){
+arma::cx_mat Result::diagonalizeC3(const arma::vec& states) const {
     arma::mat C3 = exciton.C3ExcitonBasisRep();
     arma::cx_mat degenerateSubspaceC3 = arma::zeros<arma::cx_mat>(states.n_elem, states.n_elem);
     arma::cx_vec state = eigvec.col(states(0));
-    arma::cout << "First C3: " << arma::cdot(state, C3*state) << arma::endl;
-    arma::cout << "Second C3: " << arma::cdot(state, C3*C3*state) << arma::endl;
-    arma::cout << "Third C3: " << arma::cdot(state, C3*C3*C3*state) << arma::endl;
+    exciton.log() << "First C3: " << arma::cdot(state, C3*state) << arma::endl;
+    exciton.log() << "Second C3: " << arma::cdot(state, C3*C3*state) << arma::endl;
+    exciton.log() << "Third C3: " << arma::cdot(state, C3*C3*C3*state) << arma::endl;
     for(unsigned int i = 0; i < states.n_elem; i++){
         for(unsigned int j = 0; j < states.n_elem; j++){
             arma::cx_vec rowState = eigvec.col(states(i));
@@ -194,11 +194,11 @@ arma::cx_mat Result::diagonalizeC3(const arma::vec& states){
         }
     }
 
-    std::cout << degenerateSubspaceC3 << std::endl;
+    exciton.log() << degenerateSubspaceC3 << std::endl;
     arma::cx_vec eigvalC3;
     arma::cx_mat eigvecC3;
     arma::eig_gen(eigvalC3, eigvecC3, degenerateSubspaceC3);
-    std::cout << "C3 eigval:\n" << eigvalC3 << std::endl;
+    exciton.log() << "C3 eigval:\n" << eigvalC3 << std::endl;
     return eigvecC3;
 }
 
@@ -207,7 +207,7 @@ arma::cx_mat Result::diagonalizeC3(const arma::vec& states){
  * rotational symmetry. Beware: this method most likely returns incorrect results.
  * @param state
  */
-arma::cx_mat Result::symmetrizeStates(const arma::cx_vec& state, const arma::cx_vec& degState){
+arma::cx_mat Result::symmetrizeStates(const arma::cx_vec& state, const arma::cx_vec& degState) const {
     arma::mat C3 = exciton.C3ExcitonBasisRep();
     double alpha, phase;
     arma::vec values = arma::linspace(0, 1, 100);
@@ -227,7 +227,7 @@ arma::cx_mat Result::symmetrizeStates(const arma::cx_vec& state, const arma::cx_
             }
         }
     }
-    std::cout << "alpha value is: " << alpha << std::endl;
+    exciton.log() << "alpha value is: " << alpha << std::endl;
     arma::cx_vec symmetrizedState    = state*alpha*exp(imag*phase) + degState*sqrt(1 - alpha*alpha);
     arma::cx_vec degSymmetrizedState = state*sqrt(1 - alpha*alpha) - degState*alpha*exp(imag*phase);
     arma::cx_mat states(exciton.excitonbasisdim, 2);
@@ -246,7 +246,7 @@ arma::cx_mat Result::symmetrizeStates(const arma::cx_vec& state, const arma::cx_
  * necessarily an exciton eigenstate.
  * @param textfile Pointer to file to write the reciprocal amplitude.
  */
-void Result::writeReciprocalAmplitude(const arma::cx_vec& statecoefs, FILE* textfile){
+void Result::writeReciprocalAmplitude(const arma::cx_vec& statecoefs, FILE* textfile) const {
     fprintf(textfile, "kx\tky\tkz\tProb.\n");
     int nbandsCombinations = exciton.conductionBands.n_elem * exciton.valenceBands.n_elem;
     for (int i = 0; i < exciton.kpoints.n_rows; i++){
@@ -269,7 +269,7 @@ void Result::writeReciprocalAmplitude(const arma::cx_vec& statecoefs, FILE* text
  * @param stateindex Index of exciton.
  * @param textfile Pointer to file to write.
  */
-void Result::writeReciprocalAmplitude(int stateindex, FILE* textfile){
+void Result::writeReciprocalAmplitude(int stateindex, FILE* textfile) const {
     arma::cx_vec statecoefs = eigvec.col(stateindex);
     writeReciprocalAmplitude(statecoefs, textfile);
 };
@@ -281,7 +281,7 @@ void Result::writeReciprocalAmplitude(int stateindex, FILE* textfile){
  * @param statecoefs Coefficients of state (not necessarily an exciton eigenstate).
  * @param textfile Pointer to file.
  */
-void Result::writePhase(const arma::cx_vec& statecoefs, FILE* textfile){
+void Result::writePhase(const arma::cx_vec& statecoefs, FILE* textfile) const {
     if(exciton.bandList.n_elem != 2){
         throw std::logic_error("writePhase requires only one valence and conduction bands");
     }
@@ -305,7 +305,7 @@ void Result::writePhase(const arma::cx_vec& statecoefs, FILE* textfile){
  * @param stateindex Index of exciton.
  * @param textfile Pointer of file.
  */
-void Result::writePhase(int stateindex, FILE* textfile){
+void Result::writePhase(int stateindex, FILE* textfile) const {
     arma::cx_vec coefs = eigvec.col(stateindex);
     writePhase(coefs, textfile);
 }
@@ -317,7 +317,7 @@ void Result::writePhase(int stateindex, FILE* textfile){
  * @param statecoefs Coefficients of state.
  * @param textfile Pointer to file. 
  */
-void Result::writeExtendedReciprocalAmplitude(const arma::cx_vec& statecoefs, FILE* textfile){
+void Result::writeExtendedReciprocalAmplitude(const arma::cx_vec& statecoefs, FILE* textfile) const {
     int nbandsCombinations = exciton.conductionBands.n_elem * exciton.valenceBands.n_elem;
     double boxLimit = boundingBoxBZ();
 
@@ -352,7 +352,7 @@ void Result::writeExtendedReciprocalAmplitude(const arma::cx_vec& statecoefs, FI
  * @param textfile Pointer to a file where the extended reciprocal amplitude will be written
  * @return void
  */
-void Result::writeExtendedReciprocalAmplitude(int stateindex, FILE* textfile){
+void Result::writeExtendedReciprocalAmplitude(int stateindex, FILE* textfile) const {
     arma::cx_vec statecoefs = eigvec.col(stateindex);
     writeExtendedReciprocalAmplitude(statecoefs, textfile);
 }
@@ -365,7 +365,7 @@ void Result::writeExtendedReciprocalAmplitude(int stateindex, FILE* textfile){
  * @throws std::logic_error if the number of valence and conduction bands is different from one (i.e. one pair of bands)
  * @return void
  */
-void Result::writeExtendedPhase(const arma::cx_vec& statecoefs, FILE* textfile){
+void Result::writeExtendedPhase(const arma::cx_vec& statecoefs, FILE* textfile) const {
     if(exciton.bandList.n_elem != 2){
         throw std::logic_error("writeExtendedPhase requires only one valence and conduction bands");
     }
@@ -403,7 +403,7 @@ void Result::writeExtendedPhase(const arma::cx_vec& statecoefs, FILE* textfile){
  * @throws std::logic_error if the exciton have more than one pair of bands.
  * @return void
  */
-void Result::writeExtendedPhase(int stateindex, FILE* textfile){
+void Result::writeExtendedPhase(int stateindex, FILE* textfile) const {
     arma::cx_vec statecoefs = eigvec.col(stateindex);
     writeExtendedPhase(statecoefs, textfile);
 }
@@ -419,10 +419,25 @@ void Result::writeExtendedPhase(int stateindex, FILE* textfile){
  * @return void
  */
 void Result::writeRealspaceAmplitude(const arma::cx_vec& statecoefs, int holeIndex,
-                                     const arma::rowvec& holeCell, FILE* textfile, int ncells){
+                                     const arma::rowvec& holeCell, FILE* textfile, int ncells) const {
 
-    arma::rowvec holePosition = exciton.motif.row(holeIndex).subvec(0, 2) + holeCell;
-    fprintf(textfile, "%11.8lf\t%11.8lf\t%14.11lf\n", holePosition(0), holePosition(1), 0.0);
+    arma::vec coefs = realspaceAmplitude(statecoefs, holeIndex, holeCell, ncells);
+    writeRealspaceAmplitude(coefs, holeIndex, holeCell, textfile, ncells);
+}
+
+/**
+ * Method to compute the probability density of finding the electron of an exciton state
+ * on each atom of the supercell, having fixed the position of the hole.
+ * @details The atoms are ordered by unit cell, as given by truncateSupercell. The computation
+ * is separated from the writing so that both can be overlapped.
+ * @param statecoefs State whose real-space amplitude is computed.
+ * @param holeIndex Index of atom where we put the hole.
+ * @param holeCell Unit cell where the hole is fixed.
+ * @param ncells Number of unit cells where we compute the probability density.
+ * @return Vector with the probability density on each atom.
+ */
+arma::vec Result::realspaceAmplitude(const arma::cx_vec& statecoefs, int holeIndex,
+                                     const arma::rowvec& holeCell, int ncells) const {
 
     double radius = arma::norm(exciton.bravaisLattice.row(0)) * ncells;
     arma::mat cellCombinations = exciton.truncateSupercell(exciton.ncell, radius);
@@ -439,8 +454,43 @@ void Result::writeRealspaceAmplitude(const arma::cx_vec& statecoefs, int holeInd
         }
     }
 
+    return coefs;
+}
+
+/**
+ * Overload of realspaceAmplitude for exciton eigenstates.
+ * @param stateindex Index of exciton.
+ * @param holeIndex Index of atom where we put the hole.
+ * @param holeCell Unit cell where the hole is fixed.
+ * @param ncells Number of unit cells where we compute the probability density.
+ * @return Vector with the probability density on each atom.
+ */
+arma::vec Result::realspaceAmplitude(int stateindex, int holeIndex, const arma::rowvec& holeCell, int ncells) const {
+
+    arma::cx_vec statecoefs = eigvec.col(stateindex);
+    return realspaceAmplitude(statecoefs, holeIndex, holeCell, ncells);
+}
+
+/**
+ * Method to write to a file an already computed real-space probability density.
+ * @param coefs Probability density on each atom, as given by realspaceAmplitude.
+ * @param holeIndex Index of atom where we put the hole.
+ * @param holeCell Unit cell where the hole is fixed.
+ * @param textfile File to write the probability density.
+ * @param ncells Number of unit cells used to compute the probability density.
+ * @return void
+ */
+void Result::writeRealspaceAmplitude(const arma::vec& coefs, int holeIndex,
+                                     const arma::rowvec& holeCell, FILE* textfile, int ncells) const {
+
+    arma::rowvec holePosition = exciton.motif.row(holeIndex).subvec(0, 2) + holeCell;
+    fprintf(textfile, "%11.8lf\t%11.8lf\t%14.11lf\n", holePosition(0), holePosition(1), 0.0);
+
+    double radius = arma::norm(exciton.bravaisLattice.row(0)) * ncells;
+    arma::mat cellCombinations = exciton.truncateSupercell(exciton.ncell, radius);
+
     // Write probabilities to file
-    it = 0;
+    int it = 0;
     for(unsigned int cellIndex = 0; cellIndex < cellCombinations.n_rows; cellIndex++){
         arma::rowvec cell = cellCombinations.row(cellIndex);
         for(unsigned int atomIndex = 0; atomIndex < exciton.motif.n_rows; atomIndex++){
@@ -465,7 +515,7 @@ void Result::writeRealspaceAmplitude(const arma::cx_vec& statecoefs, int holeInd
  * @return void 
  */
 void Result::writeRealspaceAmplitude(int stateindex, int holeIndex, 
-                                     const arma::rowvec& holeCell, FILE* textfile, int ncells){
+                                     const arma::rowvec& holeCell, FILE* textfile, int ncells) const {
 
     arma::cx_vec statecoefs = eigvec.col(stateindex);
     writeRealspaceAmplitude(statecoefs, holeIndex, holeCell, textfile, ncells);
@@ -477,7 +527,7 @@ void Result::writeRealspaceAmplitude(int stateindex, int holeIndex,
  * @param n Number of eigenvalues to write. If not specified, all eigenvalues are written.
  * @return void 
  */
-void Result::writeEigenvalues(FILE* textfile, int n){
+void Result::writeEigenvalues(FILE* textfile, int n) const {
 
     if(n > exciton.excitonbasisdim || n < 0){
         throw std::invalid_argument("Optional argument n must be a positive integer equal or below basisdim");
@@ -497,7 +547,7 @@ void Result::writeEigenvalues(FILE* textfile, int n){
  * @param n Optional argument to specify number of states to write to a file. 
  * @return void
  */
-void Result::writeStates(FILE* textfile, int n){
+void Result::writeStates(FILE* textfile, int n) const {
     if(n > exciton.excitonbasisdim || n < 0){
         throw std::invalid_argument("Optional argument n must be a positive integer equal or below basisdim");
     }
@@ -529,7 +579,7 @@ void Result::writeStates(FILE* textfile, int n){
  * named kubo_w.in
  * @return void 
  */
-void Result::writeAbsorptionSpectrum(){
+void Result::writeAbsorptionSpectrum() const {
 
     int nR = exciton.unitCellList.n_rows;
     int norb = exciton.basisdim;
@@ -574,9 +624,14 @@ void Result::writeAbsorptionSpectrum(){
     arma::mat eigval_sp = exciton.eigvalKStack;
     arma::cx_cube eigvec_sp = exciton.eigvecKStack;
 
+    // The Fortran routine takes non-const pointers, so it works on copies of the results
+    int ndim = exciton.ndim;
+    arma::vec eigval_ex = m_eigval;
+    arma::cx_mat eigvec_ex = m_eigvec;
+
     skubo_w_(&nR, &norb, &norb_ex, &nv, &nc, &filling,
              Rvec.memptr(), R.memptr(), extendedMotif.memptr(), hhop.memptr(), shop.memptr(), &nk, rkx.memptr(),
-             rky.memptr(), rkz.memptr(), &exciton.ndim, m_eigvec.memptr(), m_eigval.memptr(), eigval_sp.memptr(), eigvec_sp.memptr());
+             rky.memptr(), rkz.memptr(), &ndim, eigvec_ex.memptr(), eigval_ex.memptr(), eigval_sp.memptr(), eigvec_sp.memptr());
 }
 
 /**
@@ -584,7 +639,7 @@ void Result::writeAbsorptionSpectrum(){
  * @param n Number of excitons to compute and write spin.
  * @param textfile Textfile where the spins are written.
  */
-void Result::writeSpin(int n, FILE* textfile){
+void Result::writeSpin(int n, FILE* textfile) const {
 
     if(n > exciton.excitonbasisdim || n < 0){
         throw std::invalid_argument("Optional argument n must be a positive integer equal or below basisdim");
@@ -606,7 +661,7 @@ void Result::writeSpin(int n, FILE* textfile){
  * @return Fourier transform of the amplitude, evaluated at Re - Rh. 
  */
 double Result::fourierTransformExciton(int stateindex, const arma::rowvec& electron_position, 
-                                       const arma::rowvec& hole_position){
+                                       const arma::rowvec& hole_position) const {
 
     arma::cx_vec coefs = eigvec.col(stateindex);
 
@@ -642,7 +697,7 @@ double Result::fourierTransformExciton(int stateindex, const arma::rowvec& elect
  * by the BZ mesh. Intended to use with full BZ meshes. 
  * @return Half the side of the box.
  */ 
-double Result::boundingBoxBZ(){
+double Result::boundingBoxBZ() const {
     double max_x = arma::max(exciton.kpoints.col(0));
     double max_y = arma::max(exciton.kpoints.col(1));
 
@@ -661,7 +716,7 @@ double Result::boundingBoxBZ(){
  * @return Real-space amplitude evaluated at those electron and hole positions.
  */
 double Result::realSpaceWavefunction(const arma::cx_vec& BSEcoefs, int electronIndex, int holeIndex,
-                             const arma::rowvec& eCell, const arma::rowvec& hCell){
+                             const arma::rowvec& eCell, const arma::rowvec& hCell) const {
 
     std::complex<double> imag(0, 1);
     double totalAmplitude = 0;
@@ -716,7 +771,7 @@ double Result::realSpaceWavefunction(const arma::cx_vec& BSEcoefs, int electronI
  * @param cell Unit cell used in the exponential.
  * @return Coefficients with the added exponential.
  */
-arma::cx_vec Result::addExponential(arma::cx_vec& coefs, const arma::rowvec& cell){
+arma::cx_vec Result::addExponential(arma::cx_vec& coefs, const arma::rowvec& cell) const {
 
     arma::vec product = exciton.kpoints * cell.t();
     std::complex<double> imag(0, 1);
@@ -740,8 +795,8 @@ arma::cx_vec Result::addExponential(arma::cx_vec& coefs, const arma::rowvec& cel
  * @param hIndex Index of atom of hole.
  * @return Density matrix matrix element.
  */
-std::complex<double> Result::densityMatrix(Exciton& exciton, const arma::cx_vec& BSEcoefs, 
-                                    int eIndex, int hIndex){
+std::complex<double> Result::densityMatrix(const Exciton& exciton, const arma::cx_vec& BSEcoefs, 
+                                    int eIndex, int hIndex) const {
 
     std::complex<double> rho;
     int nk = exciton.nk;
@@ -797,8 +852,8 @@ std::complex<double> Result::densityMatrix(Exciton& exciton, const arma::cx_vec&
  * @param hIndex Index of hole.
  * @return Matrix elements of density matrix evaluated at k.
  */
-std::complex<double> Result::densityMatrixK(int kIndex, Exciton& exciton, const arma::cx_vec& BSEcoefs, 
-                                    int eIndex, int hIndex){
+std::complex<double> Result::densityMatrixK(int kIndex, const Exciton& exciton, const arma::cx_vec& BSEcoefs, 
+                                    int eIndex, int hIndex) const {
 
     std::complex<double> rho;
     int nk = exciton.nk;
@@ -128,7 +128,7 @@ void System::setFilling(int filling){
 		fermiLevel_ = filling_ - 1;
 	}
 	else{
-		std::cout << "Filling must be a positive integer" << std::endl;
+		log() << "Filling must be a positive integer" << std::endl;
 	}
 }
 
@@ -154,6 +154,79 @@ void System::solveBands(arma::rowvec& k, arma::vec& eigval, arma::cx_mat& eigvec
 	arma::eig_sym(eigval, eigvec, h);
 }
 
+/**
+ * Method to obtain the energy bands and real eigenvectors at a k point where the Bloch Hamiltonian
+ * is real, e.g. the time-reversal invariant momenta of a model with real Fock and overlap matrices.
+ * @details H(k) and S(k) are built from the Fock and overlap matrices, and the eigenvectors are
+ * given in the same Lowdin orthonormalized basis as in solveBands, S(k)^-1/2 being real as well.
+ * @param k kpoint where we want the eigenvalues and eigenvectors.
+ * @param eigval Vector to store the energies of the system.
+ * @param eigvec Real matrix to store eigenvectors.
+ * @param triangular To specifiy if the matrices are triangular.
+*/
+void System::solveRealBands(const arma::rowvec& k, arma::vec& eigval, arma::mat& eigvec, bool triangular) const {
+	arma::mat h = arma::real(hamiltonian(k, triangular));
+	double auToEV = 27.2;
+
+	if (!overlapMatrices.empty()){
+		h *= auToEV;
+		arma::mat s = arma::real(overlap(k, triangular));
+		arma::vec overlapEigval;
+		arma::mat overlapEigvec;
+		arma::eig_sym(overlapEigval, overlapEigvec, arma::mat(arma::symmatu(s)));
+		if (overlapEigval.min() <= 0){
+			throw std::invalid_argument("Zero or negative overlap eigenvalues found, exiting...");
+		}
+		arma::mat sInverseRoot = overlapEigvec*arma::diagmat(1./arma::sqrt(overlapEigval))*overlapEigvec.t();
+		h = sInverseRoot*h*sInverseRoot;
+	}
+
+	arma::eig_sym(eigval, eigvec, arma::mat(arma::symmatu(h)));
+}
+
+/**
+ * Method to obtain the energy bands and eigenvectors at a given k with definite spin, for
+ * models that conserve Sz (see conservesSpinZ).
+ * @details The Bloch Hamiltonian is block diagonal in spin, so each block is diagonalized
+ * separately and the eigenstates have zero weight on the orbitals of opposite spin, even
+ * within degenerate subspaces. Bands are returned sorted by energy as in solveBands.
+ * @param k kpoint where we want the eigenvalues and eigenvectors.
+ * @param eigval Vector to store the energies of the system.
+ * @param eigvec Complex matrix to store eigenvectors.
+ * @param spin Vector to store the Sz value (+1/2 or -1/2) of each band.
+ * @param triangular To specifiy if the matrices are triangular.
+*/
+void System::solveBandsSpinZ(const arma::rowvec& k, arma::vec& eigval, arma::cx_mat& eigvec, arma::vec& spin, bool triangular) const {
+	arma::cx_mat h = hamiltonian(k, triangular);
+	double auToEV = 27.2;
+
+	if (!overlapMatrices.empty()){
+		h *= auToEV;
+		orthogonalize_hamiltonian(k, h, triangular);	
+	}
+
+	// Orbitals are ordered {|1,up>, |1,down>, |2,up>, ...}
+	int half = basisdim/2;
+	arma::vec sectorEigval(basisdim), sectorSpin(basisdim);
+	arma::cx_mat sectorEigvec = arma::zeros<arma::cx_mat>(basisdim, basisdim);
+	for (int s = 0; s < 2; s++){
+		arma::uvec orbitals = arma::regspace<arma::uvec>(s, 2, basisdim - 1);
+		arma::vec blockEigval;
+		arma::cx_mat blockEigvec;
+		arma::eig_sym(blockEigval, blockEigvec, arma::cx_mat(h.submat(orbitals, orbitals)));
+
+		arma::uvec columns = arma::regspace<arma::uvec>(s*half, (s + 1)*half - 1);
+		sectorEigval(columns) = blockEigval;
+		sectorEigvec.submat(orbitals, columns) = blockEigvec;
+		sectorSpin(columns).fill(0.5 - s);
+	}
+
+	arma::uvec order = arma::stable_sort_index(sectorEigval);
+	eigval = sectorEigval(order);
+	eigvec = sectorEigvec.cols(order);
+	spin = sectorSpin(order);
+}
+
 /**
  * Method to write to a file the energy bands evaluated on a set of kpoints specified on a file.
  * @details It creates a file with the name "[systemName].bands" where the bands are stores.
@@ -185,7 +258,7 @@ void System::solveBands(std::string kpointsfile, bool triangular) const {
 		std::cerr << e.what() << std::endl;
 	}
 	fclose(bandfile);
-	arma::cout << "Done" << arma::endl;
+	log() << "Done" << arma::endl;
 }
 
 /**
@@ -266,6 +339,51 @@ double System::expectedSpinZValue(const arma::cx_vec& eigvec){
 	return real(arma::cdot(eigvec, spinEigvec));
 };
 
+/**
+ * Checks whether the spin component Sz is conserved, i.e. whether the Fock and overlap
+ * matrices do not couple orbitals of opposite spin. The ordering assumed is the same one
+ * of expectedSpinZValue.
+ * @param tolerance Maximum absolute value allowed for the spin-mixing elements.
+ * @returns True if Sz is conserved.
+ */
+bool System::conservesSpinZ(double tolerance) const {
+	if (basisdim % 2 != 0){
+		return false;
+	}
+	arma::uvec up = arma::regspace<arma::uvec>(0, 2, basisdim - 1);
+	arma::uvec down = up + 1;
+	for (arma::uword i = 0; i < hamiltonianMatrices.n_slices; i++){
+		arma::cx_mat h = hamiltonianMatrices.slice(i);
+		if (arma::abs(h.submat(up, down)).max() > tolerance || arma::abs(h.submat(down, up)).max() > tolerance){
+			return false;
+		}
+	}
+	for (arma::uword i = 0; i < overlapMatrices.n_slices; i++){
+		arma::cx_mat s = overlapMatrices.slice(i);
+		if (arma::abs(s.submat(up, down)).max() > tolerance || arma::abs(s.submat(down, up)).max() > tolerance){
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Checks whether the Fock and overlap matrices are real, so that H(-k) = H(k)* and the model
+ * is invariant under complex conjugation (time reversal for spinless models, or spinful ones
+ * without spin-orbit coupling).
+ * @param tolerance Maximum absolute value allowed for the imaginary parts.
+ * @returns True if all the matrices are real.
+ */
+bool System::hasRealMatrices(double tolerance) const {
+	if (arma::abs(arma::imag(hamiltonianMatrices)).max() > tolerance){
+		return false;
+	}
+	if (!overlapMatrices.empty() && arma::abs(arma::imag(overlapMatrices)).max() > tolerance){
+		return false;
+	}
+	return true;
+}
+
 /**
  * Routine to calculate the expected value of the spin component Sy.
  * NB: Not correctly implemented yet (incorrect basis ordering).
@@ -0,0 +1,177 @@
+#include <armadillo>
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "xatu/TiledMatrix.hpp"
+
+namespace xatu {
+
+/**
+ * Creates the memory-mapped file holding the tiles of the matrix.
+ * @param directory Directory where the file is created (preferably on a local fast disk).
+ * @param n Dimension of the matrix.
+ * @param tileColumns Number of columns per tile. If zero, tiles of about 64 MB are used.
+ */
+TiledMatrix::TiledMatrix(const std::string& directory, arma::uword n, arma::uword tileColumns) : n_(n){
+    if(n == 0){
+        throw std::invalid_argument("TiledMatrix: dimension must be positive");
+    }
+    if(tileColumns == 0){
+        const std::size_t targetBytes = 64UL << 20;
+        tileColumns = std::max<arma::uword>(1, targetBytes/(n*sizeof(std::complex<double>)));
+    }
+    tileColumns_ = std::min(tileColumns, n);
+    ntiles_ = (n + tileColumns_ - 1)/tileColumns_;
+
+    std::size_t elements = 0;
+    for(int t = 0; t < ntiles_; t++){
+        offsets_.push_back(elements);
+        elements += (std::size_t)(lastColumn(t) + 1)*(lastColumn(t) - firstColumn(t) + 1);
+    }
+    bytes_ = elements*sizeof(std::complex<double>);
+
+    std::string path = directory + "/xatu_hbs_XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    fd_ = mkstemp(name.data());
+    if(fd_ < 0){
+        throw std::runtime_error("TiledMatrix: could not create file in " + directory);
+    }
+    unlink(name.data());
+    if(ftruncate(fd_, bytes_) != 0){
+        close(fd_);
+        throw std::runtime_error("TiledMatrix: could not allocate " + std::to_string(bytes_) + " bytes in " + directory);
+    }
+    void* address = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(address == MAP_FAILED){
+        close(fd_);
+        throw std::runtime_error("TiledMatrix: could not map file in " + directory);
+    }
+    data_ = static_cast<std::complex<double>*>(address);
+    diagonal_ = arma::zeros(n);
+}
+
+TiledMatrix::~TiledMatrix(){
+    if(data_ != nullptr){
+        munmap(data_, bytes_);
+    }
+    if(fd_ >= 0){
+        close(fd_);
+    }
+}
+
+/**
+ * Returns the first column of a tile.
+ * @param t Tile index.
+ * @return Column index.
+ */
+arma::uword TiledMatrix::firstColumn(int t) const {
+    return t*tileColumns_;
+}
+
+/**
+ * Returns the last column of a tile.
+ * @param t Tile index.
+ * @return Column index.
+ */
+arma::uword TiledMatrix::lastColumn(int t) const {
+    return std::min((t + 1)*tileColumns_, n_) - 1;
+}
+
+/**
+ * Returns the size in bytes of a tile.
+ * @param t Tile index.
+ * @return Size of the tile.
+ */
+std::size_t TiledMatrix::tileBytes(int t) const {
+    return (std::size_t)(lastColumn(t) + 1)*(lastColumn(t) - firstColumn(t) + 1)*sizeof(std::complex<double>);
+}
+
+/**
+ * Gives the kernel advice about the pages of a tile (e.g. MADV_WILLNEED to read it ahead).
+ * @details madvise needs page-aligned addresses, so the range is extended to whole pages.
+ * @param t Tile index.
+ * @param advice madvise advice.
+ * @return void
+ */
+void TiledMatrix::advise(int t, int advice) const {
+    if(t < 0 || t >= ntiles_){
+        return;
+    }
+    std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    std::size_t start = offsets_[t]*sizeof(std::complex<double>);
+    std::size_t alignedStart = (start/pageSize)*pageSize;
+    madvise(reinterpret_cast<char*>(data_) + alignedStart, tileBytes(t) + start - alignedStart, advice);
+}
+
+/**
+ * Returns a tile as a matrix using the mapped memory, so writes go directly to the file.
+ * @details The returned object must not be copy-assigned to another matrix, which would copy
+ * the tile into memory.
+ * @param t Tile index.
+ * @return Matrix of dimension (lastColumn + 1) x (number of columns of the tile).
+ */
+arma::cx_mat TiledMatrix::tile(int t){
+    return arma::cx_mat(data_ + offsets_[t], lastColumn(t) + 1, lastColumn(t) - firstColumn(t) + 1, false, true);
+}
+
+/**
+ * Finishes a tile once its upper triangle has been written: completes the lower triangle of its
+ * diagonal block, stores its diagonal, and starts writing it back to disk.
+ * @param t Tile index.
+ * @return void
+ */
+void TiledMatrix::completeTile(int t){
+    arma::cx_mat panel = tile(t);
+    arma::uword first = firstColumn(t);
+    for(arma::uword jl = 0; jl < panel.n_cols; jl++){
+        arma::uword j = first + jl;
+        diagonal_(j) = std::real(panel(j, jl));
+        for(arma::uword i = j + 1; i < panel.n_rows; i++){
+            panel(i, jl) = std::conj(panel(j, i - first));
+        }
+    }
+    std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    std::size_t start = offsets_[t]*sizeof(std::complex<double>);
+    std::size_t alignedStart = (start/pageSize)*pageSize;
+    msync(reinterpret_cast<char*>(data_) + alignedStart, tileBytes(t) + start - alignedStart, MS_ASYNC);
+}
+
+/**
+ * Computes the product of the matrix with a block of vectors streaming the tiles from disk.
+ * @details With P the tile of columns c0..c1, its upper part contributes P*X(c0:c1) to the rows
+ * 0..c1 of the result, and its strictly upper part (rows 0..c0-1) contributes P^H*X(0:c0-1) to
+ * the rows c0..c1 (the Hermitian counterpart). The pages of each tile are released after use.
+ * @param X Block of vectors by columns.
+ * @return Product of the matrix with X.
+ */
+arma::cx_mat TiledMatrix::multiply(const arma::cx_mat& X) const {
+    if(X.n_rows != n_){
+        throw std::invalid_argument("TiledMatrix::multiply(): dimension mismatch");
+    }
+    arma::cx_mat Y(n_, X.n_cols, arma::fill::zeros);
+    advise(0, MADV_WILLNEED);
+    for(int t = 0; t < ntiles_; t++){
+        advise(t + 1, MADV_WILLNEED);
+
+        arma::uword c0 = firstColumn(t), c1 = lastColumn(t);
+        const arma::cx_mat panel(data_ + offsets_[t], c1 + 1, c1 - c0 + 1, false, true);
+        Y.rows(0, c1) += panel*X.rows(c0, c1);
+        if(c0 > 0){
+            Y.rows(c0, c1) += panel.rows(0, c0 - 1).t()*X.rows(0, c0 - 1);
+        }
+
+        advise(t, MADV_DONTNEED);
+    }
+    return Y;
+}
+
+}
@@ -1,8 +1,21 @@
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
 #include "xatu/davidson.hpp"
 
 namespace xatu {
 
-void davidson_method(
+/**
+ * Block Davidson method for the lowest eigenpairs of a dense Hermitian matrix.
+ * @param eigval Returns the lowest eigenvalues.
+ * @param eigvec Returns the corresponding eigenvectors by columns.
+ * @param mat Hermitian matrix.
+ * @param neigval Number of eigenpairs to compute.
+ * @param tol Tolerance on the change of the eigenvalues between iterations.
+ * @return True if the eigenvalues converged within the maximum number of iterations.
+ */
+bool davidson_method(
     arma::vec& eigval, 
     arma::cx_mat& eigvec, 
     const arma::cx_mat& mat, 
@@ -20,6 +33,7 @@ void davidson_method(
     arma::cx_mat proyected_matrix;
     arma::vec aux_eigval = arma::ones(neigval);
     arma::cx_mat Q, R;
+    bool converged = false;
 
     for(int i = 0; i < max_iterations; i++){
 
@@ -41,6 +55,7 @@ void davidson_method(
 
         // Check convergence
         if(arma::norm(eigval.subvec(0, neigval - 1) - aux_eigval) < tol){
+            converged = true;
             break;
         }
 
@@ -48,16 +63,130 @@ void davidson_method(
         aux_eigval = eigval.subvec(0, neigval - 1);
         guess_eigvec.clear();
         guess_eigvec = Q;
-
-        if (i == max_iterations - 1){
-            std::cout << "Reached maximum number of iterations" << std::endl;
-        }
     }
 
     // Store final eigenvectors
     eigval = eigval.subvec(0, neigval - 1);
-    arma::cout << eigvec.n_rows << arma::endl;
-    arma::cout << eigvec.n_cols << arma::endl;
+
+    return converged;
 };
 
-}
\ No newline at end of file
+/**
+ * Matrix-free block Davidson method for the lowest eigenpairs of a Hermitian matrix.
+ * @details The matrix is only accessed through its product with blocks of vectors, so it does
+ * not need to be stored in memory. Corrections are preconditioned with the diagonal of the matrix,
+ * and the search space is restarted from the current Ritz vectors when it grows too large.
+ * @param eigval Returns the lowest eigenvalues.
+ * @param eigvec Returns the corresponding eigenvectors by columns.
+ * @param matvec Function returning the product of the matrix with a block of vectors.
+ * @param diagonal Diagonal of the matrix.
+ * @param neigval Number of eigenpairs to compute.
+ * @param tol Tolerance on the norm of the residual of each eigenpair.
+ * @param maxIterations Maximum number of iterations.
+ * @param guess Initial guess for the eigenvectors. If empty, unit vectors on the smallest diagonal elements are used.
+ * @return True if the residuals of the requested eigenpairs are below the tolerance; otherwise
+ * the last Ritz pairs are returned anyway.
+ */
+bool davidson_method(
+    arma::vec& eigval,
+    arma::cx_mat& eigvec,
+    const BlockMatVec& matvec,
+    const arma::vec& diagonal,
+    int neigval,
+    double tol,
+    int maxIterations,
+    const arma::cx_mat& guess){
+
+    arma::uword n = diagonal.n_elem;
+    if(neigval < 1 || (arma::uword)neigval > n){
+        throw std::invalid_argument("davidson_method: number of eigenvalues must be between 1 and the matrix dimension");
+    }
+    arma::uword nblock = std::min<arma::uword>(2*neigval, n);
+    arma::uword maxBasis = std::min<arma::uword>(n, std::max<arma::uword>(4*nblock, 20));
+
+    // Initial search space
+    arma::cx_mat V(n, nblock, arma::fill::zeros);
+    arma::uword nguess = std::min<arma::uword>(guess.n_cols, nblock);
+    if(nguess > 0){
+        if(guess.n_rows != n){
+            throw std::invalid_argument("davidson_method: initial guess has wrong dimension");
+        }
+        V.cols(0, nguess - 1) = guess.cols(0, nguess - 1);
+    }
+    arma::uvec order = arma::sort_index(diagonal);
+    for(arma::uword j = nguess, next = 0; j < nblock; j++, next++){
+        V(order(next), j) = 1.0;
+    }
+    arma::cx_mat Q, R;
+    arma::qr_econ(Q, R, V);
+    V = Q;
+    arma::cx_mat AV = matvec(V);
+
+    arma::vec theta;
+    arma::cx_mat S, X, AX;
+    bool converged = false;
+    for(int iteration = 0; iteration < maxIterations; iteration++){
+
+        // Rayleigh-Ritz on the search space
+        arma::cx_mat T = V.t()*AV;
+        T = 0.5*(T + T.t());
+        arma::eig_sym(theta, S, T);
+        arma::uword nritz = std::min<arma::uword>(nblock, S.n_cols);
+        X  = V*S.cols(0, nritz - 1);
+        AX = AV*S.cols(0, nritz - 1);
+        arma::cx_mat residuals = AX - X*arma::diagmat(arma::conv_to<arma::cx_vec>::from(theta.subvec(0, nritz - 1)));
+
+        // Convergence of the requested eigenpairs
+        converged = true;
+        for(int j = 0; j < neigval; j++){
+            if(arma::norm(residuals.col(j)) > tol){
+                converged = false;
+                break;
+            }
+        }
+        if(converged || V.n_cols == n){
+            // With the whole space spanned the Ritz pairs are exact
+            converged = true;
+            break;
+        }
+
+        // Restart from the Ritz vectors if the search space is full
+        if(V.n_cols + nritz > maxBasis){
+            V = X;
+            AV = AX;
+        }
+
+        // Diagonal-preconditioned corrections, orthogonalized against the search space
+        arma::cx_mat corrections(n, 0);
+        for(arma::uword j = 0; j < nritz; j++){
+            if(arma::norm(residuals.col(j)) <= tol){
+                continue;
+            }
+            arma::vec denominator = theta(j) - diagonal;
+            denominator.transform([](double d){ return (std::abs(d) < 1E-8) ? 1E-8 : d; });
+            arma::cx_vec t = residuals.col(j) / arma::conv_to<arma::cx_vec>::from(denominator);
+            for(int pass = 0; pass < 2; pass++){
+                t -= V*(V.t()*t);
+                if(corrections.n_cols > 0){
+                    t -= corrections*(corrections.t()*t);
+                }
+            }
+            double norm = arma::norm(t);
+            if(norm > 1E-10 && V.n_cols + corrections.n_cols < n){
+                corrections.insert_cols(corrections.n_cols, t/norm);
+            }
+        }
+        if(corrections.n_cols == 0){
+            break;
+        }
+        V.insert_cols(V.n_cols, corrections);
+        AV.insert_cols(AV.n_cols, matvec(corrections));
+    }
+
+    eigval = theta.subvec(0, neigval - 1);
+    eigvec = X.cols(0, neigval - 1);
+
+    return converged;
+}
+
+}
@@ -0,0 +1,124 @@
+#include <armadillo>
+#include <stdexcept>
+#include <cmath>
+#include <vector>
+
+#include "xatu/fullbse.hpp"
+
+namespace xatu {
+
+/**
+ * Solves the full BSE for real A and B with the product form.
+ * @details With K = A - B and M = A + B, the eigenproblem is equivalent to K*M s = w^2 s, with
+ * s = X + Y. If K = L*L^T is positive definite (stable ground state), the excitation energies
+ * are the square roots of the eigenvalues of the symmetric matrix L^T*M*L, which has half the
+ * dimension of the full problem. The states are normalized as X^T X - Y^T Y = 1.
+ * @param eigval Returns positive excitation energies in ascending order.
+ * @param X Returns resonant part of the states by columns.
+ * @param Y Returns antiresonant part of the states by columns.
+ * @param A Resonant block (real symmetric).
+ * @param B Coupling block (real symmetric).
+ * @param nstates Number of states returned (all if zero).
+ */
+void product_form_method(arma::vec& eigval, arma::mat& X, arma::mat& Y, const arma::mat& A, const arma::mat& B,
+                         int nstates){
+
+    arma::mat L;
+    if(!arma::chol(L, arma::mat(A - B), "lower")){
+        throw std::runtime_error("product_form_method: A - B is not positive definite (unstable ground state)");
+    }
+    arma::mat M = A + B;
+    arma::mat W = L.t()*M*L;
+    arma::vec omega2;
+    arma::mat U;
+    arma::eig_sym(omega2, U, arma::symmatu(W));
+    if(omega2(0) <= 0){
+        throw std::runtime_error("product_form_method: A + B is not positive definite (unstable ground state)");
+    }
+
+    arma::uword n = (nstates > 0) ? std::min<arma::uword>(nstates, omega2.n_elem) : omega2.n_elem;
+    eigval = arma::sqrt(omega2.subvec(0, n - 1));
+
+    // s = X + Y = L u and d = X - Y = M s/w, with s^T d = w
+    arma::mat S = L*U.cols(0, n - 1);
+    arma::mat D = M*S;
+    for(arma::uword i = 0; i < n; i++){
+        D.col(i) /= eigval(i);
+        double norm = std::sqrt(eigval(i));
+        S.col(i) /= norm;
+        D.col(i) /= norm;
+    }
+    X = (S + D)/2;
+    Y = (S - D)/2;
+}
+
+/**
+ * Solves the full BSE for complex A and B with the product form of its real representation.
+ * @details Writing X = a + ib and Y = c - ie, the complex problem is equivalent to a real one
+ * with blocks [[Re A, -Im A], [Im A, Re A]] and [[Re B, Im B], [Im B, -Re B]], both symmetric and
+ * of twice the size of A, which is solved with product_form_method. This replaces the Hermitian
+ * eigenproblem of the complex 2n x 2n matrix by a real symmetric one of size 2n, about four times
+ * cheaper. Every state appears twice in the real problem, as (X, Y) and (iX, iY), so each level is
+ * reduced to its independent complex states by diagonalizing the Gram matrix X^H X - Y^H Y of its
+ * real solutions, whose eigenvalues are either 0 or 2. The states are normalized as X^H X - Y^H Y = 1.
+ * @param eigval Returns positive excitation energies in ascending order.
+ * @param X Returns resonant part of the states by columns.
+ * @param Y Returns antiresonant part of the states by columns.
+ * @param A Resonant block (Hermitian).
+ * @param B Coupling block (complex symmetric).
+ * @param nstates Number of states returned (all if zero).
+ */
+void complex_product_form_method(arma::vec& eigval, arma::cx_mat& X, arma::cx_mat& Y, const arma::cx_mat& A,
+                                 const arma::cx_mat& B, int nstates){
+
+    arma::uword n = A.n_rows;
+    arma::mat realA = arma::join_cols(arma::join_rows(arma::real(A), arma::mat(-arma::imag(A))),
+                                      arma::join_rows(arma::imag(A), arma::real(A)));
+    arma::mat realB = arma::join_cols(arma::join_rows(arma::real(B), arma::imag(B)),
+                                      arma::join_rows(arma::imag(B), arma::mat(-arma::real(B))));
+
+    // Two real solutions per complex state, plus margin for a level cut at the end
+    int nreal = (nstates > 0) ? std::min<int>(2*nstates + 2, (int)(2*n)) : 0;
+    arma::vec realEigval;
+    arma::mat realX, realY;
+    product_form_method(realEigval, realX, realY, realA, realB, nreal);
+
+    arma::cx_mat complexX(realX.rows(0, n - 1), realX.rows(n, 2*n - 1));
+    arma::cx_mat complexY(realY.rows(0, n - 1), arma::mat(-realY.rows(n, 2*n - 1)));
+
+    std::vector<double> energies;
+    std::vector<arma::cx_vec> resonant, antiresonant;
+    arma::uword start = 0;
+    while(start < realEigval.n_elem){
+        arma::uword end = start + 1;
+        while(end < realEigval.n_elem && realEigval(end) - realEigval(end - 1) < 1E-8*std::max(1., realEigval(end))){
+            end++;
+        }
+        arma::span level(start, end - 1);
+        arma::cx_mat gram = complexX.cols(level).t()*complexX.cols(level) - complexY.cols(level).t()*complexY.cols(level);
+        arma::vec weights;
+        arma::cx_mat combinations;
+        arma::eig_sym(weights, combinations, gram);
+        for(arma::uword j = 0; j < weights.n_elem; j++){
+            if(weights(j) > 0.5){
+                arma::cx_vec combination = combinations.col(j)/std::sqrt(weights(j));
+                energies.push_back(arma::mean(realEigval(level)));
+                resonant.push_back(complexX.cols(level)*combination);
+                antiresonant.push_back(complexY.cols(level)*combination);
+            }
+        }
+        start = end;
+    }
+
+    arma::uword nreturned = (nstates > 0) ? std::min<arma::uword>(nstates, energies.size()) : energies.size();
+    eigval = arma::vec(nreturned);
+    X = arma::cx_mat(n, nreturned);
+    Y = arma::cx_mat(n, nreturned);
+    for(arma::uword i = 0; i < nreturned; i++){
+        eigval(i) = energies[i];
+        X.col(i) = resonant[i];
+        Y.col(i) = antiresonant[i];
+    }
+}
+
+}
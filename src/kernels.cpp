@@ -0,0 +1,97 @@
+#include <armadillo>
+#include <complex>
+
+#include "xatu/kernels.hpp"
+
+namespace xatu {
+
+/**
+ * Contraction of the atom-resolved pair densities with the motif Fourier transform, for any size.
+ * @param coefs1 First eigenstate vector.
+ * @param coefs2 Second eigenstate vector.
+ * @param coefs3 Third eigenstate vector.
+ * @param coefs4 Fourth eigenstate vector.
+ * @param motifFT Motif Fourier transform (natoms x natoms).
+ * @param orbitalAtom Atom of each orbital.
+ * @return Interaction term.
+ */
+std::complex<double> motifContraction(const std::complex<double>* coefs1, const std::complex<double>* coefs2,
+                                      const std::complex<double>* coefs3, const std::complex<double>* coefs4,
+                                      const arma::cx_mat& motifFT, const arma::uvec& orbitalAtom){
+
+    arma::cx_vec first = arma::zeros<arma::cx_vec>(motifFT.n_rows);
+    arma::cx_vec second = arma::zeros<arma::cx_vec>(motifFT.n_rows);
+    for(arma::uword alpha = 0; alpha < orbitalAtom.n_elem; alpha++){
+        first(orbitalAtom(alpha)) += std::conj(coefs1[alpha])*coefs3[alpha];
+        second(orbitalAtom(alpha)) += std::conj(coefs2[alpha])*coefs4[alpha];
+    }
+    return arma::dot(first, motifFT*second);
+}
+
+/**
+ * Fixed-size version of motifContraction. The densities are kept in stack arrays and all
+ * the loops have compile-time bounds, so they are fully unrolled and no memory is allocated.
+ * @param c1 First eigenstate vector.
+ * @param c2 Second eigenstate vector.
+ * @param c3 Third eigenstate vector.
+ * @param c4 Fourth eigenstate vector.
+ * @param motifFT Motif Fourier transform (NATOMS x NATOMS).
+ * @param orbitalAtom Atom of each orbital (BASISDIM entries).
+ * @return Interaction term.
+ */
+template<int NATOMS, int BASISDIM>
+std::complex<double> fixedMotifContraction(const std::complex<double>* c1, const std::complex<double>* c2,
+                                           const std::complex<double>* c3, const std::complex<double>* c4,
+                                           const arma::cx_mat& motifFT, const arma::uvec& orbitalAtom){
+
+    const std::complex<double>* M = motifFT.memptr();
+    const arma::uword* atom = orbitalAtom.memptr();
+
+    std::complex<double> first[NATOMS] = {};
+    std::complex<double> second[NATOMS] = {};
+    for(int alpha = 0; alpha < BASISDIM; alpha++){
+        first[atom[alpha]] += std::conj(c1[alpha])*c3[alpha];
+        second[atom[alpha]] += std::conj(c2[alpha])*c4[alpha];
+    }
+
+    std::complex<double> term = 0;
+    for(int j = 0; j < NATOMS; j++){
+        std::complex<double> column = 0;
+        for(int i = 0; i < NATOMS; i++){
+            column += first[i]*M[i + NATOMS*j];
+        }
+        term += column*second[j];
+    }
+    return term;
+}
+
+/**
+ * Selects the implementation of motifContraction for the given sizes: a fixed-size one for
+ * the small motifs of the tight-binding models (hBN, spinful hBN, MoS2), or the generic one.
+ * @param natoms Number of atoms in the motif.
+ * @param basisdim Number of orbitals.
+ * @return Pointer to the kernel.
+ */
+MotifKernel motifKernel(int natoms, int basisdim){
+    if(natoms == 1 && basisdim == 1){
+        return fixedMotifContraction<1, 1>;
+    }
+    if(natoms == 1 && basisdim == 2){
+        return fixedMotifContraction<1, 2>;
+    }
+    if(natoms == 2 && basisdim == 2){
+        return fixedMotifContraction<2, 2>;
+    }
+    if(natoms == 2 && basisdim == 4){
+        return fixedMotifContraction<2, 4>;
+    }
+    if(natoms == 3 && basisdim == 11){
+        return fixedMotifContraction<3, 11>;
+    }
+    if(natoms == 3 && basisdim == 22){
+        return fixedMotifContraction<3, 22>;
+    }
+    return motifContraction;
+}
+
+}
@@ -0,0 +1,296 @@
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <omp.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#include "xatu/threading.hpp"
+
+// OpenBLAS runtime control of its own thread pool
+extern "C" {
+    void openblas_set_num_threads(int);
+    int openblas_get_num_threads(void);
+}
+
+namespace xatu {
+
+// Policy shared by all the exciton calculations of the process
+static ThreadingPolicy policy;
+
+// Requests of the BLAS thread guards alive in the process: number of stages that need serial
+// BLAS, the threads requested by the solvers, and the setting to restore once none is alive
+static std::mutex blasMutex;
+static int blasSerialStages = 0;
+static std::multiset<int> blasSolverRequests;
+static int blasBaseThreads = 1;
+
+/**
+ * Sets the threading policy used by the different stages of the exciton calculations.
+ * @details If the policy specifies a thread binding, the threads are pinned immediately.
+ * @param newPolicy Threading policy.
+ * @return void
+ */
+void setThreadingPolicy(const ThreadingPolicy& newPolicy){
+    if(newPolicy.bands < 0 || newPolicy.bse < 0 || newPolicy.solver < 0){
+        throw std::invalid_argument("setThreadingPolicy(): number of threads must be non-negative");
+    }
+    policy = newPolicy;
+    if(policy.binding != "none"){
+        bindThreads(policy.binding);
+    }
+}
+
+/**
+ * Returns the threading policy currently in use.
+ * @return Threading policy.
+ */
+const ThreadingPolicy& getThreadingPolicy(){
+    return policy;
+}
+
+/**
+ * Sets the total number of threads of the process, which is used by every stage
+ * that does not have a specific number of threads assigned.
+ * @param nthreads Number of threads.
+ * @return void
+ */
+void setNumThreads(int nthreads){
+    if(nthreads <= 0){
+        throw std::invalid_argument("setNumThreads(): number of threads must be a positive integer");
+    }
+    omp_set_num_threads(nthreads);
+    setBLASThreads(nthreads);
+}
+
+/**
+ * Sets the number of threads of each stage from a string.
+ * @details The expected format is a comma separated list of 'stage=nthreads' pairs,
+ * e.g. 'bands=4,bse=16,solver=16'. Stages not present keep their current value.
+ * @param stages String with the per-stage number of threads.
+ * @return void
+ */
+void setStageThreads(const std::string& stages){
+    ThreadingPolicy newPolicy = policy;
+    std::istringstream iss(stages);
+    std::string item;
+    while(std::getline(iss, item, ',')){
+        std::size_t pos = item.find("=");
+        if(pos == std::string::npos){
+            throw std::invalid_argument("setStageThreads(): expected format is stage=nthreads");
+        }
+        std::string stage = item.substr(0, pos);
+        int nthreads = std::stoi(item.substr(pos + 1));
+        if(stage == "bands"){
+            newPolicy.bands = nthreads;
+        }
+        else if(stage == "bse"){
+            newPolicy.bse = nthreads;
+        }
+        else if(stage == "solver"){
+            newPolicy.solver = nthreads;
+        }
+        else{
+            throw std::invalid_argument("setStageThreads(): stage must be either bands, bse or solver");
+        }
+    }
+    setThreadingPolicy(newPolicy);
+}
+
+/**
+ * Returns the number of threads to be used in a given stage of the calculation.
+ * @param stage Either 'bands', 'bse' or 'solver'.
+ * @return Number of threads of the stage.
+ */
+int stageThreads(const std::string& stage){
+    int nthreads = 0;
+    if(stage == "bands"){
+        nthreads = policy.bands;
+    }
+    else if(stage == "bse"){
+        nthreads = policy.bse;
+    }
+    else if(stage == "solver"){
+        nthreads = policy.solver;
+    }
+    else{
+        throw std::invalid_argument("stageThreads(): stage must be either bands, bse or solver");
+    }
+
+    return (nthreads > 0) ? nthreads : omp_get_max_threads();
+}
+
+/**
+ * Sets the number of BLAS threads resulting from the requests of the alive guards: one while
+ * any stage calls BLAS from an OpenMP loop, otherwise the largest request of the solvers, and
+ * the base setting when there is no guard. Must be called with blasMutex locked.
+ * @return void
+ */
+static void applyBLASThreads(){
+    int nthreads = blasBaseThreads;
+    if(blasSerialStages > 0){
+        nthreads = 1;
+    }
+    else if(!blasSolverRequests.empty()){
+        nthreads = *blasSolverRequests.rbegin();
+    }
+    if(openblas_get_num_threads() != nthreads){
+        openblas_set_num_threads(nthreads);
+    }
+}
+
+/**
+ * Sets the number of threads used by BLAS/LAPACK calls.
+ * @details The setting is global to the process. If some stage holds a BLASThreadGuard, the
+ * value is stored and applied once the last guard is released, so that it does not
+ * oversubscribe the cores of the stages running meanwhile.
+ * @param nthreads Number of BLAS threads.
+ * @return void
+ */
+void setBLASThreads(int nthreads){
+    std::lock_guard<std::mutex> lock(blasMutex);
+    if(blasSerialStages == 0 && blasSolverRequests.empty()){
+        if(openblas_get_num_threads() != nthreads){
+            openblas_set_num_threads(nthreads);
+        }
+    }
+    else{
+        blasBaseThreads = nthreads;
+    }
+}
+
+/**
+ * Returns the number of threads currently used by BLAS/LAPACK.
+ * @return Number of BLAS threads.
+ */
+int getBLASThreads(){
+    return openblas_get_num_threads();
+}
+
+/**
+ * Registers a request of BLAS threads, as done by BLASThreadGuard.
+ * @details A request of one thread comes from an OpenMP loop whose iterations call BLAS,
+ * and forces BLAS to one thread until all such requests are released, regardless of the
+ * other calculations of the process. Larger requests come from the dense solvers, which
+ * receive the largest of them while no loop is running. The setting before the first
+ * request is restored when the last one is released.
+ * @param nthreads Number of BLAS threads requested.
+ * @return void
+ */
+void acquireBLASThreads(int nthreads){
+    std::lock_guard<std::mutex> lock(blasMutex);
+    if(blasSerialStages == 0 && blasSolverRequests.empty()){
+        blasBaseThreads = openblas_get_num_threads();
+    }
+    if(nthreads <= 1){
+        blasSerialStages++;
+    }
+    else{
+        blasSolverRequests.insert(nthreads);
+    }
+    applyBLASThreads();
+}
+
+/**
+ * Releases a request of BLAS threads registered with acquireBLASThreads.
+ * @param nthreads Number of BLAS threads that was requested.
+ * @return void
+ */
+void releaseBLASThreads(int nthreads){
+    std::lock_guard<std::mutex> lock(blasMutex);
+    if(nthreads <= 1){
+        blasSerialStages--;
+    }
+    else{
+        blasSolverRequests.erase(blasSolverRequests.find(nthreads));
+    }
+    applyBLASThreads();
+}
+
+/**
+ * Pins the OpenMP threads to the cores available to the process.
+ * @details 'close' pins consecutive threads to consecutive cores, while 'spread' distributes
+ * the threads evenly over all the available cores (e.g. over both sockets). Since the OpenMP
+ * runtime reuses its thread pool, the binding persists in later parallel regions with the same
+ * number of threads. Each worker pins itself to one core inside a parallel region, while the
+ * master thread keeps the affinity of the process: threads created later from it (OpenBLAS
+ * workers, larger OpenMP teams) inherit its mask and would otherwise share a single core.
+ * @param binding Either 'none', 'close' or 'spread'.
+ * @return void
+ */
+void bindThreads(const std::string& binding){
+    if(binding != "none" && binding != "close" && binding != "spread"){
+        throw std::invalid_argument("bindThreads(): binding must be either none, close or spread");
+    }
+    if(binding == "none"){
+        return;
+    }
+
+#ifdef __linux__
+    cpu_set_t processSet;
+    CPU_ZERO(&processSet);
+    sched_getaffinity(0, sizeof(cpu_set_t), &processSet);
+
+    std::vector<int> cores;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+        if(CPU_ISSET(cpu, &processSet)){
+            cores.push_back(cpu);
+        }
+    }
+    int ncores = cores.size();
+    if(ncores == 0){
+        return;
+    }
+
+    #pragma omp parallel
+    {
+        int threadIndex = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int coreIndex = (binding == "close") ? threadIndex % ncores
+                                             : (int)((long int)threadIndex * ncores / nthreads) % ncores;
+        cpu_set_t threadSet;
+        CPU_ZERO(&threadSet);
+        CPU_SET(cores[coreIndex], &threadSet);
+        if(threadIndex != 0){
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &threadSet);
+        }
+    }
+#else
+    std::cout << "Warning: thread binding is only supported on Linux, ignoring..." << std::endl;
+#endif
+}
+
+/**
+ * Returns the number of consecutive columns that fill at least one memory page.
+ * @details Used as the chunk size of the column distribution of large matrices, so that
+ * no page is shared between threads that may run on different NUMA nodes.
+ * @param nrows Number of rows of the matrix.
+ * @param elementSize Size in bytes of each matrix element.
+ * @return Number of columns per tile.
+ */
+int pageTile(arma::uword nrows, std::size_t elementSize){
+    const std::size_t pageSize = 4096;
+    std::size_t columnSize = std::max<std::size_t>(1, nrows * elementSize);
+    return (int)std::max<std::size_t>(1, (pageSize + columnSize - 1)/columnSize);
+}
+
+/**
+ * Prints the number of threads used in each stage.
+ * @return void
+ */
+void printThreadingPolicy(){
+    std::cout << std::left << std::setw(30) << "Threads (bands/BSE/solver): "
+              << stageThreads("bands") << "/" << stageThreads("bse") << "/" << stageThreads("solver") << std::endl;
+    if(policy.binding != "none"){
+        std::cout << std::left << std::setw(30) << "Thread binding: " << policy.binding << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing bands at k+Q in spinful hBN nk=20 for Q commensurate with the mesh... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 2;
+    int nrmbands = 0;
+    int ncell = 20;
+    arma::rowvec parameters = {1., 1., 10.};
+    std::string modelfile = "../models/hBN_spinful.model";    
+    
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+
+    // Q is a vector of the mesh, so the bands at k+Q are looked up instead of computed
+    arma::rowvec Q = 3.*bulkExciton.reciprocalLattice.row(0)/ncell + bulkExciton.reciprocalLattice.row(1)/ncell;
+    bulkExciton.setQ(Q);
+    bulkExciton.brillouinZoneMesh(ncell);
+    bulkExciton.initializeHamiltonian();
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    for(int i = 0; i < bulkExciton.nk; i++){
+        arma::vec eigval;
+        arma::cx_mat eigvec;
+        arma::rowvec kQ = bulkExciton.kpoints.row(i) + Q;
+        bulkExciton.solveBands(kQ, eigval, eigvec);
+        if(arma::norm(eigval(bulkExciton.bandList) - bulkExciton.eigvalKQStack.col(i)) > 1E-8){
+            std::cout << "Incorrect bands at k+Q. " << std::flush; 
+            testPassed = false;
+            break;
+        }
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
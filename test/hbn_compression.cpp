@@ -0,0 +1,62 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing block-low-rank BSE in hBN nk=30, compressed and dense spectra... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 30;
+    int nstates = 4;
+    double tolerance = 1E-6;
+    arma::rowvec parameters = {1., 5., 10.};
+    std::string modelfile = "../models/hBN.model";
+
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+    bulkExciton.setExchange(true);
+    bulkExciton.brillouinZoneMesh(ncell);
+    bulkExciton.initializeHamiltonian();
+    bulkExciton.BShamiltonian();
+    arma::vec denseEnergies = bulkExciton.diagonalize("diag", nstates).eigval.subvec(0, nstates - 1);
+    double matrixNorm = arma::norm(bulkExciton.HBS, "fro");
+
+    bulkExciton.setCompression(tolerance);
+    bulkExciton.BShamiltonian();
+    int lowRankBlocks = bulkExciton.HBSCompressed->lowRankBlocks();
+    arma::vec compressedEnergies = bulkExciton.diagonalize("davidson", nstates).eigval.subvec(0, nstates - 1);
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    if(lowRankBlocks == 0){
+        std::cout << "No block was compressed. " << std::flush;
+        testPassed = false;
+    }
+    // The eigenvalues move at most by the norm of the compression error (plus the Davidson residual)
+    if(arma::abs(compressedEnergies - denseEnergies).max() > tolerance*matrixNorm + 1E-6){
+        std::cout << "Compressed spectrum outside the tolerance. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include <xatu.hpp>
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing concurrent exciton calculations in hBN nk=40... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 40;
+    int nstates = 8;
+    int nexcitons = 2;
+    arma::rowvec parameters = {1., 1., 10.};
+    std::string modelfile = "../models/hBN.model";
+
+    // The stages of both excitons overlap; the BLAS setting must be restored once both finish
+    int blasThreads = 2;
+    xatu::setBLASThreads(blasThreads);
+
+    // The configuration is shared (read-only) by all the excitons
+    const xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+
+    std::vector<arma::vec> eigvals(nexcitons);
+    std::vector<std::thread> workers;
+    for(int n = 0; n < nexcitons; n++){
+        workers.emplace_back([&, n](){
+            xatu::Exciton bulkExciton(config, ncell, nbands, nrmbands, parameters);
+            bulkExciton.setSilent(true);
+            bulkExciton.setMode("realspace");
+
+            bulkExciton.brillouinZoneMesh(ncell);
+            bulkExciton.initializeHamiltonian();
+            bulkExciton.BShamiltonian();
+            auto results = bulkExciton.diagonalize("diag", nstates);
+            eigvals[n] = results.eigval;
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    std::cout.clear();
+    bool testPassed = true;
+    if(xatu::getBLASThreads() != blasThreads){
+        std::cout << "BLAS threads not restored. " << std::flush;
+        testPassed = false;
+    }
+    std::vector<std::vector<double>> expectedEnergies = {{5.335687, 2}, {6.073800, 1}, {6.164057, 2}, {6.172253, 1}, {6.351066, 2}};
+    for(int n = 0; n < nexcitons && testPassed; n++){
+        auto energies = xatu::detectDegeneracies(eigvals[n], nstates, 6);
+        for(int i = 0; i < energies.size(); i++){
+            if(abs(energies[i][0] - expectedEnergies[i][0]) > 1E-5){
+                std::cout << "Incorrect eigval computed. " << std::flush;
+                testPassed = false;
+                break;
+            }
+            else if(abs(energies[i][1] - expectedEnergies[i][1]) > 1E-5){
+                std::cout << "Incorrect degeneracy. " << std::flush;
+                testPassed = false;
+                break;
+            }
+        }
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
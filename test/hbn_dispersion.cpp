@@ -0,0 +1,100 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing exciton dispersion in hBN nk=12, serial and concurrent Q points... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 12;
+    int nstates = 4;
+    arma::rowvec parameters = {1., 5., 10.};
+    std::string modelfile = "../models/hBN.model";
+    arma::mat Qpath = {{0., 0., 0.}, {0.1, 0., 0.}, {0.2, 0., 0.}};
+
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+    bulkExciton.setExchange(true);
+    bulkExciton.brillouinZoneMesh(ncell);
+    bulkExciton.initializeHamiltonian();
+    bulkExciton.BShamiltonian();
+    arma::vec reference = bulkExciton.diagonalize("diag", nstates).eigval.subvec(0, nstates - 1);
+
+    arma::mat serial = bulkExciton.excitonDispersion(Qpath, nstates, "diag", 1);
+    arma::mat concurrent = bulkExciton.excitonDispersion(Qpath, nstates, "diag", 3);
+
+    // Exciton built directly at the second Q point
+    xatu::Exciton excitonQ = xatu::Exciton(config, ncell, nbands, nrmbands, parameters, Qpath.row(1));
+    excitonQ.setExchange(true);
+    excitonQ.brillouinZoneMesh(ncell);
+    excitonQ.initializeHamiltonian();
+    excitonQ.BShamiltonian();
+    arma::vec direct = excitonQ.diagonalize("diag", nstates).eigval.subvec(0, nstates - 1);
+
+    // The dispersion reads the stacks of the reference in place and must leave them unchanged
+    bulkExciton.BShamiltonian();
+    arma::vec after = bulkExciton.diagonalize("diag", nstates).eigval.subvec(0, nstates - 1);
+
+    // The excitons of each Q report their stages through the callback of the reference
+    bool bseReported = false;
+    bulkExciton.setProgressCallback([&bseReported](const std::string& stage, double fraction){
+        bseReported = bseReported || (stage == "bse");
+        return true;
+    });
+    bulkExciton.excitonDispersion(Qpath.rows(1, 1), nstates, "diag", 1);
+
+    // Settings that require Q = 0 can not be carried to the other Q points
+    bool rejectedFullBSE = false;
+    bulkExciton.setFullBSE(true);
+    try{
+        bulkExciton.excitonDispersion(Qpath, nstates, "diag", 1);
+    }
+    catch(const std::invalid_argument&){
+        rejectedFullBSE = true;
+    }
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    if(arma::abs(serial - concurrent).max() > 1E-8){
+        std::cout << "Serial and concurrent dispersions disagree. " << std::flush;
+        testPassed = false;
+    }
+    if(arma::abs(serial.row(1).t() - direct).max() > 1E-6){
+        std::cout << "Dispersion differs from the exciton at Q. " << std::flush;
+        testPassed = false;
+    }
+    if(arma::abs(reference - after).max() > 1E-10){
+        std::cout << "Reference exciton modified by the dispersion. " << std::flush;
+        testPassed = false;
+    }
+    if(!bseReported){
+        std::cout << "Progress of the Q points not reported. " << std::flush;
+        testPassed = false;
+    }
+    if(!rejectedFullBSE){
+        std::cout << "Full BSE accepted at finite Q. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
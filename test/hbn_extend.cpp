@@ -0,0 +1,86 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing exciton spectrum in spinful hBN nk=20 extending the bands of a previous run... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 20;
+    int nstates = 20;
+    arma::rowvec parameters = {1., 1., 10.};
+    std::string modelfile = "../models/hBN_spinful.model";    
+    
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+    bulkExciton.setMode("realspace");
+
+    bulkExciton.brillouinZoneMesh(ncell);
+    bulkExciton.initializeHamiltonian();
+    bulkExciton.BShamiltonian();
+    auto previousResults = bulkExciton.diagonalize("diag", nstates);
+
+    // Same bands as a run with nbands = 2, computing only the new blocks
+    bulkExciton.extendBands({-1, 0, 1, 2}, previousResults.eigvec);
+    auto results = bulkExciton.diagonalize("diag", nstates);
+
+    // Kept and new bands must form an orthonormal set at every k, also within degenerate subspaces
+    double orthonormalityError = 0;
+    for(arma::uword k = 0; k < bulkExciton.eigvecKStack.n_slices; k++){
+        const arma::cx_mat& states = bulkExciton.eigvecKStack.slice(k);
+        arma::cx_mat overlap = states.t()*states - arma::eye<arma::cx_mat>(states.n_cols, states.n_cols);
+        orthonormalityError = std::max(orthonormalityError, arma::abs(overlap).max());
+    }
+
+    // The Davidson method starts from the previous states (diag leaves the warm start unused)
+    arma::vec davidsonEnergies = bulkExciton.diagonalize("davidson", nstates).eigval.subvec(0, nstates - 1);
+
+    std::cout.clear();
+    bool testPassed = true;
+    auto energies = xatu::detectDegeneracies(results.eigval, nstates, 6);
+    
+    std::vector<std::vector<double>> expectedEnergies = {{5.335690, 8}, {6.074062, 4}, {6.164494, 4}, {6.164585, 4}};
+    for(int i = 0; i < energies.size(); i++){
+        if(abs(energies[i][0] - expectedEnergies[i][0]) > 1E-5){
+            std::cout << "Incorrect eigval computed. " << std::flush; 
+            testPassed = false;
+            break;
+        }
+        else if(abs(energies[i][1] - expectedEnergies[i][1]) > 1E-5){
+            std::cout << "Incorrect degeneracy. " << std::flush;
+            testPassed = false; 
+            break;
+        }
+    }
+
+    if(orthonormalityError > 1E-10){
+        std::cout << "Extended bands are not orthonormal. " << std::flush;
+        testPassed = false;
+    }
+    if(arma::abs(davidsonEnergies - results.eigval.subvec(0, nstates - 1)).max() > 1E-5){
+        std::cout << "Warm-started Davidson disagrees with diag. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
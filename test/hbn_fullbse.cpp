@@ -0,0 +1,79 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing full BSE in hBN nk=12, real and complex product forms... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 12;
+    int nstates = 8;
+    arma::rowvec parameters = {1., 1., 10.};
+    std::string modelfile = "../models/hBN.model";    
+    
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    std::vector<arma::vec> energies;
+    for(int run = 0; run < 3; run++){
+        xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+        bulkExciton.setMode("realspace");
+        bulkExciton.setExchange(true);
+        bulkExciton.setFullBSE(run > 0);
+        bulkExciton.setRealArithmetic(run == 2);
+
+        bulkExciton.brillouinZoneMesh(ncell);
+        bulkExciton.initializeHamiltonian();
+        bulkExciton.BShamiltonian();
+        auto results = bulkExciton.diagonalize("diag", nstates);
+        energies.push_back(results.eigval.subvec(0, nstates - 1));
+    }
+
+    // The full BSE is only implemented for Q = 0, which the setter must check
+    bool rejectedQ = false;
+    xatu::Exciton finiteQExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+    finiteQExciton.setQ(arma::rowvec{0.1, 0., 0.});
+    try{
+        finiteQExciton.setFullBSE(true);
+    }
+    catch(const std::invalid_argument&){
+        rejectedQ = true;
+    }
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    // Both solvers must agree, and the coupling lowers the energies of the Tamm-Dancoff approximation
+    if(arma::abs(energies[1] - energies[2]).max() > 1E-6){
+        std::cout << "Real and complex product forms disagree. " << std::flush; 
+        testPassed = false;
+    }
+    else if(energies[1](0) > energies[0](0) + 1E-8){
+        std::cout << "Incorrect full BSE ground state. " << std::flush;
+        testPassed = false;
+    }
+    else if(!rejectedQ){
+        std::cout << "Full BSE accepted at finite Q. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing reciprocal-space kernel in hBN nk=15, blocks and elements... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 15;
+    int nstates = 8;
+    arma::rowvec parameters = {1., 1., 10.};
+    std::string modelfile = "../models/hBN.model";    
+    
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    std::vector<arma::vec> energies;
+    for(int run = 0; run < 2; run++){
+        xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+        bulkExciton.setMode("reciprocalspace");
+        bulkExciton.setReciprocalVectors(3);
+        bulkExciton.setExchange(true);
+        // The real arithmetic path builds the BSE element by element
+        bulkExciton.setRealArithmetic(run == 1);
+
+        bulkExciton.brillouinZoneMesh(ncell);
+        bulkExciton.initializeHamiltonian();
+        bulkExciton.BShamiltonian();
+        auto results = bulkExciton.diagonalize("diag", nstates);
+        energies.push_back(results.eigval.subvec(0, nstates - 1));
+    }
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    if(arma::abs(energies[0] - energies[1]).max() > 1E-8){
+        std::cout << "Block and element-wise kernels disagree. " << std::flush; 
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing parameter sweep in hBN nk=12, dielectric constants and r0... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 12;
+    int nstates = 4;
+    arma::rowvec parameters = {1., 5., 10.};
+    std::string modelfile = "../models/hBN.model";
+
+    // Rows {eps_m, eps_s, r0, cutoff, scissor, exchange}; the second one changes the kernel
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+    bulkExciton.brillouinZoneMesh(ncell);
+    bulkExciton.initializeHamiltonian();
+    double cutoff = bulkExciton.cutoff;
+    arma::mat grid = {{1., 5., 10., cutoff, 0., 1.},
+                      {1., 5., 20., cutoff, 0., 1.}};
+    arma::mat sweep = bulkExciton.sweepSpectra(grid, nstates);
+
+    std::vector<arma::vec> direct;
+    for(arma::uword p = 0; p < grid.n_rows; p++){
+        xatu::Exciton exciton = xatu::Exciton(config, ncell, nbands, nrmbands, arma::rowvec(grid.row(p).head(3)));
+        exciton.setExchange(true);
+        exciton.brillouinZoneMesh(ncell);
+        exciton.initializeHamiltonian();
+        exciton.BShamiltonian();
+        direct.push_back(exciton.diagonalize("diag", nstates).eigval.subvec(0, nstates - 1));
+    }
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    for(arma::uword p = 0; p < grid.n_rows; p++){
+        if(arma::abs(sweep.row(p).t() - direct[p]).max() > 1E-6){
+            std::cout << "Sweep differs from the exciton with r0 = " << grid(p, 2) << ". " << std::flush;
+            testPassed = false;
+        }
+    }
+    if(bulkExciton.r0 != parameters(2)){
+        std::cout << "Original r0 not restored. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
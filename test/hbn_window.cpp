@@ -0,0 +1,80 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing energy window in hBN nk=15, pruned and full BSE... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 1;
+    int nrmbands = 0;
+    int ncell = 15;
+    int nstates = 4;
+    arma::rowvec parameters = {1., 5., 10.};
+    std::string modelfile = "../models/hBN.model";
+
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+    bulkExciton.brillouinZoneMesh(ncell);
+    bulkExciton.initializeHamiltonian();
+    bulkExciton.BShamiltonian();
+    auto fullResults = bulkExciton.diagonalize("diag", nstates);
+    arma::vec fullEnergies = fullResults.eigval.subvec(0, nstates - 1);
+    arma::vec pairEnergies = bulkExciton.HK.diag();
+    int fullDimension = bulkExciton.HBS.n_rows;
+
+    // A window above every pair keeps the whole BSE
+    bulkExciton.setEnergyWindow(pairEnergies.max() + 1);
+    bulkExciton.BShamiltonian();
+    arma::vec wideEnergies = bulkExciton.diagonalize("diag", nstates).eigval.subvec(0, nstates - 1);
+
+    // A window 1 eV above the gap prunes the pairs far from the band edges
+    double window = pairEnergies.min() + 1;
+    bulkExciton.setEnergyWindow(window);
+    bulkExciton.BShamiltonian();
+    int prunedDimension = bulkExciton.HBS.n_rows;
+    auto prunedResults = bulkExciton.diagonalize("diag", nstates);
+    arma::vec prunedEnergies = prunedResults.eigval.subvec(0, nstates - 1);
+    arma::uvec outside = arma::find(pairEnergies > window);
+    double prunedWeight = arma::norm(prunedResults.eigvec.submat(outside, arma::regspace<arma::uvec>(0, nstates - 1)), "fro");
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    if(arma::abs(wideEnergies - fullEnergies).max() > 1E-10){
+        std::cout << "Wide window changes the spectrum. " << std::flush;
+        testPassed = false;
+    }
+    if(prunedDimension >= fullDimension || prunedDimension == 0){
+        std::cout << "Window does not prune the basis. " << std::flush;
+        testPassed = false;
+    }
+    if(prunedResults.eigvec.n_rows != (arma::uword)fullDimension || prunedWeight > 1E-12){
+        std::cout << "States not embedded in the full basis. " << std::flush;
+        testPassed = false;
+    }
+    // The lowest eigenvalues of a principal submatrix bound those of the full matrix from above
+    if(arma::any(prunedEnergies < fullEnergies - 1E-10)){
+        std::cout << "Pruned energies below the full ones. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
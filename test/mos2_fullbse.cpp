@@ -0,0 +1,78 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing full BSE in MoS2 nk=9 with SOC, complex product form against the dense problem... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 2;
+    int nrmbands = 0;
+    int ncell = 9;
+    int nstates = 8;
+    arma::rowvec parameters = {1., 5., 10.};
+    // Spin-orbit coupling makes the Hamiltonian complex, so the real arithmetic path is not available
+    std::string modelfile = "../models/MoS2.model";
+
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    std::vector<arma::vec> energies;
+    arma::cx_mat fullMatrix;
+    for(int run = 0; run < 2; run++){
+        xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+        bulkExciton.setExchange(true);
+        bulkExciton.setFullBSE(run == 1);
+
+        bulkExciton.brillouinZoneMesh(ncell);
+        bulkExciton.initializeHamiltonian();
+        bulkExciton.BShamiltonian();
+        auto results = bulkExciton.diagonalize("diag", nstates);
+        energies.push_back(results.eigval.subvec(0, nstates - 1));
+
+        if(run == 1){
+            const arma::cx_mat& A = bulkExciton.HBS;
+            const arma::cx_mat& B = bulkExciton.HBSCoupling;
+            fullMatrix = arma::join_cols(arma::join_rows(A, B),
+                                         arma::join_rows(arma::cx_mat(-arma::conj(B)), arma::cx_mat(-arma::conj(A))));
+        }
+    }
+
+    // Reference: positive eigenvalues of the non-Hermitian problem [[A, B], [-B*, -A*]]
+    arma::cx_vec denseEigval = arma::eig_gen(fullMatrix);
+    arma::vec positive = arma::sort(arma::vec(arma::real(denseEigval(arma::find(arma::real(denseEigval) > 0)))));
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    if(positive.n_elem < (arma::uword)nstates || arma::abs(energies[1] - positive.subvec(0, nstates - 1)).max() > 1E-6){
+        std::cout << "Product form and dense problem disagree. " << std::flush;
+        testPassed = false;
+    }
+    else if(arma::abs(arma::imag(denseEigval)).max() > 1E-6){
+        std::cout << "Complex excitation energies. " << std::flush;
+        testPassed = false;
+    }
+    else if(energies[1](0) > energies[0](0) + 1E-8){
+        std::cout << "Incorrect full BSE ground state. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
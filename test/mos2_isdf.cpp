@@ -0,0 +1,59 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+#ifndef constants
+#define PI 3.141592653589793
+#define ec 1.6021766E-19
+#define eps0 8.8541878E-12
+#endif
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing density fitting in MoS2 nk=9, full BSE against the exact kernel... " << std::flush;
+    std::cout.setstate(std::ios_base::failbit);
+
+    int nbands = 2;
+    int nrmbands = 0;
+    int ncell = 9;
+    int nstates = 6;
+    arma::rowvec parameters = {1., 5., 10.};
+    std::string modelfile = "../models/MoS2_nosoc.model";
+
+    xatu::SystemConfiguration config = xatu::SystemConfiguration(modelfile);
+    std::vector<arma::vec> energies;
+    for(int run = 0; run < 2; run++){
+        xatu::Exciton bulkExciton = xatu::Exciton(config, ncell, nbands, nrmbands, parameters);
+        bulkExciton.setExchange(true);
+        bulkExciton.setFullBSE(true);
+        // With a tight tolerance the fitted kernel must reproduce the exact one
+        bulkExciton.setDensityFitting(run == 1 ? 1E-10 : 0);
+
+        bulkExciton.brillouinZoneMesh(ncell);
+        bulkExciton.initializeHamiltonian();
+        bulkExciton.BShamiltonian();
+        auto results = bulkExciton.diagonalize("diag", nstates);
+        energies.push_back(results.eigval.subvec(0, nstates - 1));
+    }
+
+    std::cout.clear();
+    bool testPassed = true;
+
+    if(arma::abs(energies[0] - energies[1]).max() > 1E-6){
+        std::cout << "Fitted and exact kernels disagree. " << std::flush;
+        testPassed = false;
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
@@ -0,0 +1,49 @@
+#include <iostream>
+#include <armadillo>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <xatu.hpp>
+
+int main(int argc, char* argv[]){
+
+    std::cout << "Testing fixed-size motif kernels against the generic one... " << std::flush;
+
+    // Motifs of hBN, spinful hBN and MoS2 (orbitals of each atom)
+    std::vector<arma::uvec> motifs = {{1, 1}, {2, 2}, {10, 6, 6}};
+    bool testPassed = true;
+    arma::arma_rng::set_seed(0);
+    for(const auto& orbitals : motifs){
+        int natoms = orbitals.n_elem;
+        int basisdim = arma::accu(orbitals);
+        arma::uvec orbitalAtom(basisdim);
+        int it = 0;
+        for(int i = 0; i < natoms; i++){
+            for(arma::uword o = 0; o < orbitals(i); o++){
+                orbitalAtom(it++) = i;
+            }
+        }
+
+        arma::cx_vec c1 = arma::randn<arma::cx_vec>(basisdim), c2 = arma::randn<arma::cx_vec>(basisdim);
+        arma::cx_vec c3 = arma::randn<arma::cx_vec>(basisdim), c4 = arma::randn<arma::cx_vec>(basisdim);
+        arma::cx_mat motifFT = arma::randn<arma::cx_mat>(natoms, natoms);
+
+        std::complex<double> generic = xatu::motifContraction(c1.memptr(), c2.memptr(), c3.memptr(), c4.memptr(), motifFT, orbitalAtom);
+        std::complex<double> fixed = xatu::motifKernel(natoms, basisdim)(c1.memptr(), c2.memptr(), c3.memptr(), c4.memptr(),
+                                                                       motifFT, orbitalAtom);
+        if(std::abs(generic - fixed) > 1E-12*std::abs(generic)){
+            std::cout << "Kernels disagree for " << natoms << " atoms and " << basisdim << " orbitals. " << std::flush;
+            testPassed = false;
+        }
+    }
+
+    if (testPassed){
+        std::cout << "\033[1;32mPassed\033[0m" << std::endl;
+        return 0;
+    }
+    else{
+        std::cout << "\033[1;31mFailed\033[0m" << std::endl;
+        return 1;
+    }
+};
@@ -0,0 +1,36 @@
+# Arrays taken from an exciton are views of its memory, and must stay valid after rebuilding it. Requires the bindings
+# ('make python'); run from /test.
+import sys
+sys.path.insert(0, "../python")
+import numpy as np
+import xatu
+
+print("Testing NumPy arrays after rebuilding the exciton... ", end="", flush=True)
+
+config = xatu.SystemConfiguration("../models/hBN.model")
+exciton = xatu.Exciton(config, ncell=12, nbands=1, parameters=[1, 1, 10])
+exciton.setSilent()
+exciton.brillouinZoneMesh(12)
+exciton.initializeHamiltonian()
+exciton.BShamiltonian()
+result = exciton.diagonalize("diag", 8)
+
+stack, hbs, eigval = exciton.eigvecKStack, exciton.HBS, result.eigval
+stackBefore, hbsBefore, eigvalBefore = stack.copy(), hbs.copy(), eigval.copy()
+
+# The arrays are views of the C++ memory, not copies
+views = np.shares_memory(hbs, exciton.HBS) and np.shares_memory(stack, exciton.eigvecKStack)
+
+# Rebuilding on a different mesh reallocates the stacks and the BSE
+exciton.brillouinZoneMesh(15)
+exciton.initializeHamiltonian()
+exciton.BShamiltonian()
+exciton.diagonalize("diag", 8)
+
+passed = (views and np.array_equal(stack, stackBefore) and np.array_equal(hbs, hbsBefore) and
+          np.array_equal(eigval, eigvalBefore) and exciton.HBS.shape != hbs.shape)
+if passed:
+    print("\033[1;32mPassed\033[0m")
+else:
+    print("\033[1;31mFailed\033[0m")
+sys.exit(0 if passed else 1)
@@ -1,5 +1,9 @@
 #!/bin/bash
 TESTS=$(ls *.x)
+# Python tests only run if the bindings have been built
+if ls ../python/xatu*.so > /dev/null 2>&1; then
+    TESTS="$TESTS $(ls *.py)"
+fi
 NTESTS=$(echo $TESTS | wc -w)
 NSUC=0
 FAILED=()
@@ -9,7 +13,11 @@ echo "================="
 for binary in $TESTS
 do
     printf "\n\033[0;36mTest $binary\033[0m\n"
-    ./$binary
+    if [[ $binary == *.py ]]; then
+        python3 ./$binary
+    else
+        ./$binary
+    fi
     STATUS=(1 - $?)
     NSUC=$((NSUC + STATUS))
     if [[ $NSUC == 0 ]]; then